@@ -0,0 +1,44 @@
+# - Try to find LuaJIT
+# Once done this will define
+#
+#  LUAJIT_FOUND - system has LuaJIT
+#  LUAJIT_INCLUDE_DIR - the LuaJIT include directory
+#  LUAJIT_LIBRARIES - the libraries needed to use LuaJIT
+
+IF (LuaJIT_INCLUDE_DIR AND LuaJIT_LIBRARY)
+   SET(LuaJIT_FIND_QUIETLY TRUE)
+ENDIF (LuaJIT_INCLUDE_DIR AND LuaJIT_LIBRARY)
+
+FIND_PATH(LuaJIT_INCLUDE_DIR luajit.h
+    PATH_SUFFIXES luajit-2.1 luajit-2.0 luajit
+    HINTS $ENV{LUAJIT_DIR}
+)
+
+FIND_LIBRARY(LuaJIT_LIBRARY
+    NAMES luajit-5.1 luajit
+    HINTS $ENV{LUAJIT_DIR}
+)
+
+IF (LuaJIT_INCLUDE_DIR AND LuaJIT_LIBRARY)
+    SET(LUAJIT_FOUND TRUE)
+    SET(LUAJIT_INCLUDE_DIR ${LuaJIT_INCLUDE_DIR})
+    SET(LUAJIT_LIBRARIES ${LuaJIT_LIBRARY})
+    # LuaJIT needs libdl and libm on Unix when linked statically
+    IF (UNIX AND NOT APPLE)
+        SET(LUAJIT_LIBRARIES ${LUAJIT_LIBRARIES} dl m)
+    ENDIF()
+ELSE ()
+    SET(LUAJIT_FOUND FALSE)
+ENDIF ()
+
+IF (LUAJIT_FOUND)
+    IF (NOT LuaJIT_FIND_QUIETLY)
+        MESSAGE(STATUS "Found LuaJIT: ${LuaJIT_LIBRARY}")
+    ENDIF (NOT LuaJIT_FIND_QUIETLY)
+ELSE (LUAJIT_FOUND)
+    IF (LuaJIT_FIND_REQUIRED)
+        MESSAGE(FATAL_ERROR "Could NOT find LuaJIT")
+    ENDIF (LuaJIT_FIND_REQUIRED)
+ENDIF (LUAJIT_FOUND)
+
+MARK_AS_ADVANCED(LuaJIT_INCLUDE_DIR LuaJIT_LIBRARY)
@@ -0,0 +1,50 @@
+--[[
+
+ Measures the cost of the most frequently called script bindings. Choose the
+ benchmark at the debugging NPC, once on a server built against Lua 5.1 and
+ once on one built with -DWITH_LUAJIT=ON. On LuaJIT the C API versions of the
+ bindings that have FFI fast paths are measured as well.
+
+--]]
+
+local ITERATIONS = 100000
+
+local cases = {
+    { "posX", function(f, being, other) return f(being) end },
+    { "posY", function(f, being, other) return f(being) end },
+    { "being_type", function(f, being, other) return f(being) end },
+    { "being_get_modified_attribute",
+      function(f, being, other) return f(being, ATTR_STR) end },
+    { "get_distance", function(f, being, other) return f(being, other) end },
+}
+
+-- Returns the time per call in nanoseconds
+local function measure(call, f, being, other)
+    local sum = 0
+    local start = os.clock()
+    for i = 1, ITERATIONS do
+        sum = sum + call(f, being, other)
+    end
+    return (os.clock() - start) * 1e9 / ITERATIONS
+end
+
+-- Runs the benchmark with two beings and returns the results, one line per
+-- binding.
+function benchmark_bindings(being, other)
+    local engine = jit and jit.version or _VERSION
+    local lines = { "Bindings on " .. engine .. ", in ns per call:" }
+
+    for _, case in ipairs(cases) do
+        local name, call = case[1], case[2]
+        local line = string.format("%s: %.0f", name,
+                                   measure(call, _G[name], being, other))
+        if capi_bindings then
+            line = line .. string.format(" (C API: %.0f)",
+                measure(call, capi_bindings[name], being, other))
+        end
+        lines[#lines + 1] = line
+    end
+
+    INFO(table.concat(lines, " "))
+    return lines
+end
@@ -10,6 +10,7 @@ require "scripts/global_events"
 require "scripts/special_actions"
 require "scripts/crafting"
 require "scripts/attributes"
+require "scripts/benchmark"
 
 require "scripts/items/candy"
 require "scripts/monster/testmonster"
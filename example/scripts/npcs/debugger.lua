@@ -33,7 +33,8 @@ function npc1_talk(npc, ch)
                                "A Christmas party!",
                                "To make a donation.",
                                "Slowly count from one to ten.",
-                               "Tablepush Test")
+                               "Tablepush Test",
+                               "Benchmark the script bindings.")
   if v == 1 then
     npc_message(npc, ch, "Sorry, this is a heroic-fantasy game, I do not have any gun.")
 
@@ -63,16 +64,13 @@ function npc1_talk(npc, ch)
 
   elseif v == 4 then
     being_say(npc, "As you wish...")
-    schedule_in(2, function() being_say(npc, "One") end)
-    schedule_in(4, function() being_say(npc, "Two") end)
-    schedule_in(6, function() being_say(npc, "Three") end)
-    schedule_in(8, function() being_say(npc, "Four") end)
-    schedule_in(10, function() being_say(npc, "Five") end)
-    schedule_in(12, function() being_say(npc, "Six") end)
-    schedule_in(14, function() being_say(npc, "Seven") end)
-    schedule_in(16, function() being_say(npc, "Eight") end)
-    schedule_in(18, function() being_say(npc, "Nine") end)
-    schedule_in(20, function() being_say(npc, "Ten") end)
+    spawn_thread(function()
+      for _, number in ipairs({ "One", "Two", "Three", "Four", "Five",
+                                "Six", "Seven", "Eight", "Nine", "Ten" }) do
+        wait(20)
+        being_say(npc, number)
+      end
+    end)
 
   elseif v == 5 then
     function printTable (t)
@@ -93,6 +91,11 @@ function npc1_talk(npc, ch)
     print ("Table 5:");
     printTable (t5)
     print("---------------");
+
+  elseif v == 6 then
+    for _, line in ipairs(benchmark_bindings(ch, npc)) do
+      npc_message(npc, ch, line)
+    end
   end
 
   npc_message(npc, ch, "See you later!")
@@ -0,0 +1,95 @@
+-------------------------------------------------------------
+-- Mana Support Library FFI Bindings                       --
+--                                                         --
+-- Replaces some frequently called bindings by LuaJIT FFI  --
+-- calls, which avoid the stack traffic of the C API.      --
+--                                                         --
+----------------------------------------------------------------------------------
+--  Copyright 2012 The Mana Developers                                          --
+--                                                                              --
+--  This file is part of The Mana Server.                                       --
+--                                                                              --
+--  The Mana Server is free software; you can redistribute  it and/or modify it --
+--  under the terms of the GNU General  Public License as published by the Free --
+--  Software Foundation; either version 2 of the License, or any later version. --
+----------------------------------------------------------------------------------
+
+-- The server only provides the fast functions when built with LuaJIT and
+-- script_ffi is enabled.
+local fast = ffi_bindings
+ffi_bindings = nil
+if not fast then
+    return
+end
+
+local ok, ffi = pcall(require, "ffi")
+if not ok then
+    return
+end
+
+local cast = ffi.cast
+local type = type
+local getmetatable = getmetatable
+local select = select
+local null = fast.null
+
+local fast_pos_x = cast("int (*)(void *)", fast.posX)
+local fast_pos_y = cast("int (*)(void *)", fast.posY)
+local fast_being_type = cast("int (*)(void *)", fast.being_type)
+local fast_modified_attribute =
+    cast("double (*)(void *, int)", fast.being_get_modified_attribute)
+local fast_distance = cast("int (*)(void *, void *)", fast.get_distance)
+
+-- The C API functions stay available for the benchmark, and handle all the
+-- calls the fast paths do not, so that errors are reported as before.
+capi_bindings = {
+    posX = posX,
+    posY = posY,
+    being_type = being_type,
+    being_get_modified_attribute = being_get_modified_attribute,
+    get_distance = get_distance,
+}
+local capi = capi_bindings
+
+local function is_being(being)
+    return type(being) == "userdata" and being ~= null
+           and getmetatable(being) == nil
+end
+
+function posX(being)
+    if is_being(being) then
+        return fast_pos_x(being)
+    end
+    return capi.posX(being)
+end
+
+function posY(being)
+    if is_being(being) then
+        return fast_pos_y(being)
+    end
+    return capi.posY(being)
+end
+
+function being_type(being)
+    if is_being(being) then
+        return fast_being_type(being)
+    end
+    return capi.being_type(being)
+end
+
+function being_get_modified_attribute(being, attribute)
+    if is_being(being) and type(attribute) == "number" and attribute >= 1 then
+        return fast_modified_attribute(being, attribute)
+    end
+    return capi.being_get_modified_attribute(being, attribute)
+end
+
+function get_distance(...)
+    local being1, being2 = ...
+    if select("#", ...) == 2 and is_being(being1) and is_being(being2) then
+        return fast_distance(being1, being2)
+    end
+    return capi.get_distance(...)
+end
+
+INFO("Using the FFI bindings")
@@ -401,3 +401,6 @@ on_map_initialize(map_initialize)
 
 on_being_death(death_notification)
 on_being_remove(remove_notification)
+
+-- Replace hot bindings by FFI calls when running on LuaJIT
+require "scripts/lua/libmana-ffi"
@@ -269,9 +269,17 @@ class Character
         Character(const Character &);
         Character &operator=(const Character &);
 
-        double getAttrBase(AttributeMap::const_iterator &it) const
+        typedef AttributeMap::const_iterator AttributeIterator;
+
+        AttributeIterator getAttributeBegin() const
+        { return mAttributes.begin(); }
+        AttributeIterator getAttributeEnd() const
+        { return mAttributes.end(); }
+        int getAttrId(AttributeIterator &it) const
+        { return it->first; }
+        double getAttrBase(AttributeIterator &it) const
         { return it->second.base; }
-        double getAttrMod(AttributeMap::const_iterator &it) const
+        double getAttrMod(AttributeIterator &it) const
         { return it->second.modified; }
 
         Possessions mPossessions; //!< All the possesions of the character.
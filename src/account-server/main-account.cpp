@@ -351,6 +351,8 @@ int main(int argc, char *argv[])
 
     bool debugNetwork = Configuration::getBoolValue("net_debugMode", false);
     MessageOut::setDebugModeEnabled(debugNetwork);
+    MessageOut::setCompressionThreshold(
+            Configuration::getValue("net_compressionThreshold", 256));
 
     if (!AccountClientHandler::initialize(DEFAULT_ATTRIBUTEDB_FILE,
                                           options.port, accountHost) ||
@@ -59,13 +59,16 @@ typedef std::map<unsigned short, MapStatistics> ServerStatistics;
  */
 struct GameServer: NetComputer
 {
-    GameServer(ENetPeer *peer): NetComputer(peer), server(0), port(0) {}
+    GameServer(ENetPeer *peer):
+        NetComputer(peer), server(0), port(0),
+        tickP50(0), tickP99(0), tickMax(0) {}
 
     std::string name;
     std::string address;
     NetComputer *server;
     ServerStatistics maps;
     short port;
+    int tickP50, tickP99, tickMax;  /**< Recent world tick durations (us). */
 };
 
 static GameServer *getGameServerFromMap(int);
@@ -119,7 +122,10 @@ void GameServerHandler::process()
 
 NetComputer *ServerHandler::computerConnected(ENetPeer *peer)
 {
-    return new GameServer(peer);
+    GameServer *server = new GameServer(peer);
+    server->enableCompression(true,
+            Configuration::getBoolValue("net_interServerCompression", true));
+    return server;
 }
 
 void ServerHandler::computerDisconnected(NetComputer *comp)
@@ -163,6 +169,19 @@ static void registerGameClient(GameServer *s, const std::string &token,
     msg.writeInt32(ptr->getDatabaseID());
     msg.writeString(ptr->getName());
     serializeCharacterData(*ptr, msg);
+
+    // Send the quest variables along, so that scripts do not have to wait
+    // for each of them
+    std::map<std::string, std::string> questVars =
+            storage->getAllQuestVars(ptr->getDatabaseID());
+    msg.writeInt16(questVars.size());
+    for (std::map<std::string, std::string>::const_iterator
+         it = questVars.begin(), it_end = questVars.end(); it != it_end; ++it)
+    {
+        msg.writeString(it->first);
+        msg.writeString(it->second);
+    }
+
     s->send(msg);
 }
 
@@ -441,7 +460,11 @@ void ServerHandler::processMessage(NetComputer *comp, MessageIn &msg)
 
         case GAMSG_STATISTICS:
         {
-            while (msg.getUnreadLength())
+            server->tickP50 = msg.readInt32();
+            server->tickP99 = msg.readInt32();
+            server->tickMax = msg.readInt32();
+
+            while (msg.getUnreadLength() > 0)
             {
                 int mapId = msg.readInt16();
                 ServerStatistics::iterator i = server->maps.find(mapId);
@@ -639,6 +662,8 @@ void GameServerHandler::dumpStatistics(std::ostream &os)
 
         os << "<gameserver address=\"" << server->address << "\" port=\""
            << server->port << "\">\n";
+        os << "<ticks p50=\"" << server->tickP50 << "\" p99=\""
+           << server->tickP99 << "\" max=\"" << server->tickMax << "\"/>\n";
 
         for (ServerStatistics::const_iterator j = server->maps.begin(),
              j_end = server->maps.end(); j != j_end; ++j)
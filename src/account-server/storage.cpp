@@ -1589,6 +1589,38 @@ std::string Storage::getQuestVar(int id, const std::string &name)
     return std::string();
 }
 
+std::map<std::string, std::string> Storage::getAllQuestVars(int id)
+{
+    std::map<std::string, std::string> variables;
+
+    try
+    {
+        std::ostringstream query;
+        query << "select name, value from " << QUESTS_TBL_NAME
+              << " WHERE owner_id = ?";
+        if (mDb->prepareSql(query.str()))
+        {
+            mDb->bindValue(1, id);
+            const dal::RecordSet &results = mDb->processSql();
+
+            for (unsigned i = 0; i < results.rows(); ++i)
+                variables[results(i, 0)] = results(i, 1);
+        }
+        else
+        {
+            utils::throwError("(DALStorage:getAllQuestVars) "
+                              "SQL query preparation failure.");
+        }
+    }
+    catch (const dal::DbSqlQueryExecFailure &e)
+    {
+        utils::throwError("(DALStorage::getAllQuestVars) SQL query failure: ",
+                          e);
+    }
+
+    return variables;
+}
+
 std::string Storage::getWorldStateVar(const std::string &name, int mapId)
 {
     try
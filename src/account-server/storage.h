@@ -333,6 +333,13 @@ class Storage
          */
         std::string getQuestVar(int id, const std::string &);
 
+        /**
+         * Gets all the quest variables of a character.
+         *
+         * @param id character id.
+         */
+        std::map<std::string, std::string> getAllQuestVars(int id);
+
         /**
          * Sets the value of a quest variable.
          *
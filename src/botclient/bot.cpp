@@ -0,0 +1,577 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "botclient/bot.h"
+
+#include "common/manaserv_protocol.h"
+#include "net/messagein.h"
+#include "net/messageout.h"
+#include "net/netcomputer.h"
+#include "utils/logger.h"
+#include "utils/sha256.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef ENET_VERSION_CREATE
+#define ENET_CUTOFF ENET_VERSION_CREATE(1,3,0)
+#else
+#define ENET_CUTOFF 0xFFFFFFFF
+#endif
+
+using namespace ManaServ;
+
+/** Time given to the account server to list the existing characters. */
+static const unsigned CHARACTER_WAIT = 2000;
+
+/** Time after which a throttled login is attempted again. */
+static const unsigned LOGIN_RETRY = 1100;
+
+BotSettings::BotSettings():
+    registerAccounts(true),
+    encoding(0),
+    actionInterval(1000),
+    walkRadius(256),
+    walkWeight(6),
+    attackWeight(2),
+    chatWeight(1),
+    tradeWeight(1)
+{
+}
+
+BotStatistics::BotStatistics():
+    walkLatency(10000),
+    chatLatency(10000),
+    roundTrip(10000),
+    playing(0),
+    failures(0),
+    actions(0)
+{
+}
+
+Bot::Bot(int index, const BotSettings &settings, BotStatistics &stats):
+    mIndex(index),
+    mSettings(settings),
+    mStats(stats),
+    mState(CONNECTING),
+    mAccount(0),
+    mGame(0),
+    mAccountPeer(0),
+    mGamePeer(0),
+    mGamePort(0),
+    mEncoding(0),
+    mDeadline(0),
+    mWalkSent(0),
+    mSaySent(0),
+    mId(0)
+{
+    char name[16];
+    std::sprintf(name, "%05d", index);
+    mName = settings.namePrefix + name;
+}
+
+Bot::~Bot()
+{
+    delete mAccount;
+    delete mGame;
+}
+
+void Bot::start(ENetHost *accountHost, const ENetAddress &address,
+                unsigned now)
+{
+#if defined(ENET_VERSION) && ENET_VERSION >= ENET_CUTOFF
+    mAccountPeer = enet_host_connect(accountHost, &address, 1, 0);
+#else
+    mAccountPeer = enet_host_connect(accountHost, &address, 1);
+#endif
+    if (!mAccountPeer)
+    {
+        fail("no free peer to connect to the account server");
+        return;
+    }
+    mAccountPeer->data = this;
+    mDeadline = now;
+}
+
+void Bot::connected(ENetPeer *peer)
+{
+    if (peer == mAccountPeer)
+    {
+        mAccount = new NetComputer(peer);
+
+        if (mSettings.registerAccounts)
+        {
+            MessageOut msg(PAMSG_REGISTER);
+            msg.writeInt32(PROTOCOL_VERSION);
+            msg.writeString(mName);
+            msg.writeString(mSettings.password);
+            msg.writeString(mName + "@bots.example.com");
+            msg.writeString(std::string());
+            mAccount->send(msg);
+            mState = REGISTERING;
+        }
+        else
+        {
+            MessageOut msg(PAMSG_LOGIN_RNDTRGR);
+            msg.writeString(mName);
+            mAccount->send(msg);
+            mState = LOGGING_IN;
+            mDeadline = 0;
+        }
+    }
+    else if (peer == mGamePeer)
+    {
+        mGame = new NetComputer(peer);
+        if (mSettings.encoding & ENCODING_COMPRESSED)
+            mGame->enableCompression(false, false);
+
+        MessageOut msg(PGMSG_CONNECT);
+        msg.writeString(mToken, 32);
+        msg.writeInt8(mSettings.encoding);
+        mGame->send(msg);
+    }
+}
+
+void Bot::disconnected(ENetPeer *peer)
+{
+    if (peer == mAccountPeer)
+    {
+        mAccountPeer = 0;
+        if (mState < CONNECTING_GAME)
+            fail("disconnected by the account server");
+    }
+    else if (peer == mGamePeer)
+    {
+        mGamePeer = 0;
+        fail("disconnected by the game server");
+    }
+}
+
+void Bot::processMessage(ENetPeer *peer, MessageIn &msg, unsigned now)
+{
+    if (peer == mAccountPeer)
+        processAccountMessage(msg, now);
+    else if (peer == mGamePeer)
+        processGameMessage(msg, now);
+}
+
+MessageCompressor *Bot::getCompressor(ENetPeer *peer) const
+{
+    if (peer == mGamePeer && mGame)
+        return mGame->getCompressor();
+    return 0;
+}
+
+void Bot::processAccountMessage(MessageIn &msg, unsigned now)
+{
+    switch (msg.getId())
+    {
+        case APMSG_REGISTER_RESPONSE:
+        {
+            int error = msg.readInt8();
+            if (error == ERRMSG_OK)
+                sendCreate();
+            else if (error == REGISTER_EXISTS_USERNAME ||
+                     error == REGISTER_EXISTS_EMAIL)
+                sendLogin(std::string());   // Registered by an earlier run
+            else
+                fail("registration refused");
+        } break;
+
+        case APMSG_LOGIN_RNDTRGR_RESPONSE:
+            if (mState == LOGGING_IN)
+                sendLogin(msg.readString());
+            break;
+
+        case APMSG_LOGIN_RESPONSE:
+        {
+            int error = msg.readInt8();
+            if (error == ERRMSG_OK)
+            {
+                mState = WAITING_CHARACTER;
+                mDeadline = now + CHARACTER_WAIT;
+            }
+            else if (error == LOGIN_INVALID_TIME)
+            {
+                // Logins are throttled per address, try again later
+                mState = LOGGING_IN;
+                mDeadline = now + LOGIN_RETRY + std::rand() % LOGIN_RETRY;
+            }
+            else
+            {
+                fail("login refused");
+            }
+        } break;
+
+        case APMSG_CHAR_CREATE_RESPONSE:
+            if (msg.readInt8() != ERRMSG_OK)
+                fail("character creation refused");
+            break;
+
+        case APMSG_CHAR_INFO:
+            if (mState == WAITING_CHARACTER || mState == CREATING)
+            {
+                MessageOut select(PAMSG_CHAR_SELECT);
+                select.writeInt8(msg.readInt8());
+                mAccount->send(select);
+                mState = SELECTING;
+            }
+            break;
+
+        case APMSG_CHAR_SELECT_RESPONSE:
+            if (msg.readInt8() != ERRMSG_OK)
+            {
+                fail("character selection refused");
+                break;
+            }
+            mToken = msg.readString(32);
+            mGameHost = msg.readString();
+            mGamePort = msg.readInt16() & 0xFFFF;
+            mState = CONNECTING_GAME;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void Bot::processGameMessage(MessageIn &msg, unsigned now)
+{
+    switch (msg.getId())
+    {
+        case GPMSG_CONNECT_RESPONSE:
+            if (msg.readInt8() != ERRMSG_OK)
+            {
+                fail("game server refused the token");
+                break;
+            }
+            if (msg.getUnreadLength() > 0)
+                mEncoding = msg.readInt8();
+            mState = PLAYING;
+            mDeadline = now + std::rand() % mSettings.actionInterval;
+            ++mStats.playing;
+            break;
+
+        case GPMSG_PLAYER_MAP_CHANGE:
+            mBeings.clear();
+            mId = 0;
+            break;
+
+        case GPMSG_BEING_ENTER:
+        {
+            BeingInfo info;
+            info.type = msg.readInt8();
+            int id = msg.readInt16();
+            msg.readInt8(); // action
+            info.pos.x = msg.readInt16();
+            info.pos.y = msg.readInt16();
+            mBeings[id] = info;
+
+            if (info.type == OBJECT_CHARACTER)
+            {
+                msg.readInt8(); // direction
+                msg.readInt8(); // gender
+                if (msg.readString() == mName)
+                    mId = id;
+            }
+        } break;
+
+        case GPMSG_BEING_LEAVE:
+            mBeings.erase(msg.readInt16());
+            break;
+
+        case GPMSG_BEINGS_MOVE:
+            handleBeingsMove(msg, now);
+            break;
+
+        case GPMSG_SAY:
+            if (mSaySent && msg.readInt16() == mId &&
+                msg.readString() == mSayText)
+            {
+                mStats.chatLatency.add(now - mSaySent);
+                mSaySent = 0;
+            }
+            break;
+
+        case GPMSG_TRADE_REQUEST:
+        {
+            // Accept by requesting a trade with the same being
+            MessageOut reply(PGMSG_TRADE_REQUEST);
+            reply.writeInt16(msg.readInt16());
+            mGame->send(reply);
+        } break;
+
+        case GPMSG_TRADE_START:
+            mGame->send(MessageOut(PGMSG_TRADE_CONFIRM));
+            break;
+
+        case GPMSG_TRADE_BOTH_CONFIRM:
+            mGame->send(MessageOut(PGMSG_TRADE_AGREED));
+            break;
+
+        default:
+            break;
+    }
+}
+
+void Bot::handleBeingsMove(MessageIn &msg, unsigned now)
+{
+    const bool compact = mEncoding & ENCODING_COMPACT;
+    int id = 0;
+
+    while (msg.getUnreadLength() > 0)
+    {
+        if (compact)
+            id += msg.readVarInt();
+        else
+            id = msg.readInt16();
+
+        int flags = msg.readInt8();
+        Point &pos = mBeings[id].pos;
+
+        if (compact)
+        {
+            if (flags & MOVING_POSITION)
+            {
+                pos.x += msg.readVarInt();
+                pos.y += msg.readVarInt();
+            }
+            if (flags & MOVING_DESTINATION)
+            {
+                pos.x += msg.readVarInt();
+                pos.y += msg.readVarInt();
+            }
+        }
+        else
+        {
+            if (flags & MOVING_POSITION)
+            {
+                pos.x = msg.readInt16();
+                pos.y = msg.readInt16();
+            }
+            if (flags & MOVING_DESTINATION)
+            {
+                pos.x = msg.readInt16();
+                pos.y = msg.readInt16();
+            }
+        }
+
+        if (flags & MOVING_DESTINATION)
+            msg.readInt8(); // speed
+
+        if (id == mId && mWalkSent)
+        {
+            mStats.walkLatency.add(now - mWalkSent);
+            mWalkSent = 0;
+        }
+    }
+}
+
+void Bot::sendLogin(const std::string &salt)
+{
+    if (salt.empty())
+    {
+        MessageOut msg(PAMSG_LOGIN_RNDTRGR);
+        msg.writeString(mName);
+        mAccount->send(msg);
+        mState = LOGGING_IN;
+        mDeadline = 0;
+        return;
+    }
+
+    MessageOut msg(PAMSG_LOGIN);
+    msg.writeInt32(PROTOCOL_VERSION);
+    msg.writeString(mName);
+    msg.writeString(sha256(sha256(mSettings.password) + salt));
+    mAccount->send(msg);
+}
+
+void Bot::sendCreate()
+{
+    MessageOut msg(PAMSG_CHAR_CREATE);
+    msg.writeString(mName);
+    msg.writeInt8(mIndex % 2);      // hair style
+    msg.writeInt8(mIndex % 3);      // hair color
+    msg.writeInt8(mIndex % 2);      // gender
+    msg.writeInt8(1);               // slot
+    for (unsigned i = 0; i < mSettings.characterStats.size(); ++i)
+        msg.writeInt16(mSettings.characterStats[i]);
+    mAccount->send(msg);
+    mState = CREATING;
+}
+
+void Bot::fail(const std::string &reason)
+{
+    if (mState == FAILED)
+        return;
+
+    LOG_WARN("Bot " << mName << " failed: " << reason);
+    if (mState == PLAYING)
+        --mStats.playing;
+    ++mStats.failures;
+    mState = FAILED;
+    stop();
+}
+
+void Bot::update(ENetHost *gameHost, unsigned now)
+{
+    switch (mState)
+    {
+        case LOGGING_IN:
+            if (mDeadline && now >= mDeadline)
+                sendLogin(std::string());
+            break;
+
+        case WAITING_CHARACTER:
+            // No character was listed in time, so there is none
+            if (now >= mDeadline)
+                sendCreate();
+            break;
+
+        case CONNECTING_GAME:
+            if (!mGamePeer)
+            {
+                ENetAddress address;
+                enet_address_set_host(&address, mGameHost.c_str());
+                address.port = mGamePort;
+#if defined(ENET_VERSION) && ENET_VERSION >= ENET_CUTOFF
+                mGamePeer = enet_host_connect(gameHost, &address, 1, 0);
+#else
+                mGamePeer = enet_host_connect(gameHost, &address, 1);
+#endif
+                if (!mGamePeer)
+                {
+                    fail("no free peer to connect to the game server");
+                    break;
+                }
+                mGamePeer->data = this;
+            }
+            break;
+
+        case PLAYING:
+        {
+            if (now < mDeadline)
+                break;
+            mDeadline = now + mSettings.actionInterval;
+            mStats.roundTrip.add(mGamePeer->roundTripTime);
+            ++mStats.actions;
+
+            int total = mSettings.walkWeight + mSettings.attackWeight +
+                        mSettings.chatWeight + mSettings.tradeWeight;
+            if (total <= 0)
+                break;
+
+            int pick = std::rand() % total;
+            if ((pick -= mSettings.walkWeight) < 0)
+                walk(now);
+            else if ((pick -= mSettings.attackWeight) < 0)
+                attack();
+            else if ((pick -= mSettings.chatWeight) < 0)
+                chat(now);
+            else
+                trade();
+        } break;
+
+        default:
+            break;
+    }
+}
+
+void Bot::walk(unsigned now)
+{
+    Beings::const_iterator it = mBeings.find(mId);
+    if (!mId || it == mBeings.end())
+        return;
+
+    const int radius = mSettings.walkRadius;
+    MessageOut msg(PGMSG_WALK);
+    msg.writeInt16(std::max(0, it->second.pos.x +
+                            std::rand() % (2 * radius + 1) - radius));
+    msg.writeInt16(std::max(0, it->second.pos.y +
+                            std::rand() % (2 * radius + 1) - radius));
+    mGame->send(msg);
+
+    if (!mWalkSent)
+        mWalkSent = now;
+}
+
+void Bot::attack()
+{
+    if (int id = randomBeing(OBJECT_MONSTER))
+    {
+        MessageOut msg(PGMSG_ATTACK);
+        msg.writeInt16(id);
+        mGame->send(msg);
+    }
+}
+
+void Bot::chat(unsigned now)
+{
+    char suffix[16];
+    std::sprintf(suffix, " %u", now % 100000);
+    mSayText = mSettings.chatMessage + suffix;
+
+    MessageOut msg(PGMSG_SAY);
+    msg.writeString(mSayText);
+    mGame->send(msg);
+    mSaySent = now;
+}
+
+void Bot::trade()
+{
+    if (int id = randomBeing(OBJECT_CHARACTER))
+    {
+        MessageOut msg(PGMSG_TRADE_REQUEST);
+        msg.writeInt16(id);
+        mGame->send(msg);
+    }
+}
+
+int Bot::randomBeing(int type) const
+{
+    std::vector<int> candidates;
+    for (Beings::const_iterator it = mBeings.begin(), it_end = mBeings.end();
+         it != it_end; ++it)
+    {
+        if (it->second.type == type && it->first != mId)
+            candidates.push_back(it->first);
+    }
+
+    if (candidates.empty())
+        return 0;
+    return candidates[std::rand() % candidates.size()];
+}
+
+void Bot::stop()
+{
+    if (mGamePeer)
+    {
+        enet_peer_disconnect(mGamePeer, 0);
+        mGamePeer->data = 0;
+        mGamePeer = 0;
+    }
+    if (mAccountPeer)
+    {
+        enet_peer_disconnect(mAccountPeer, 0);
+        mAccountPeer->data = 0;
+        mAccountPeer = 0;
+    }
+}
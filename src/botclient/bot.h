@@ -0,0 +1,189 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOT_H
+#define BOT_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <enet/enet.h>
+
+#include "utils/percentiles.h"
+#include "utils/point.h"
+
+class MessageCompressor;
+class MessageIn;
+class NetComputer;
+
+/**
+ * Settings shared by all the bots, read from the bot_* options.
+ */
+struct BotSettings
+{
+    BotSettings();
+
+    std::string namePrefix;
+    std::string password;
+    std::vector<int> characterStats;
+    std::string chatMessage;
+    bool registerAccounts;      /**< Register before logging in. */
+    int encoding;               /**< ENCODING_* flags requested. */
+    int actionInterval;         /**< Milliseconds between two actions. */
+    int walkRadius;             /**< In pixels, around the current position. */
+    int walkWeight;
+    int attackWeight;
+    int chatWeight;
+    int tradeWeight;
+};
+
+/**
+ * Measurements gathered by all the bots together.
+ */
+struct BotStatistics
+{
+    BotStatistics();
+
+    utils::RollingPercentiles walkLatency;  /**< Walk to own move, in ms. */
+    utils::RollingPercentiles chatLatency;  /**< Say to own echo, in ms. */
+    utils::RollingPercentiles roundTrip;    /**< ENet round trip, in ms. */
+    int playing;
+    int failures;
+    int actions;
+};
+
+/**
+ * A fake player, going through the login sequence of a real client and then
+ * walking, attacking, chatting and trading at random.
+ */
+class Bot
+{
+    public:
+        enum State
+        {
+            CONNECTING,         /**< Waiting for the account server. */
+            REGISTERING,
+            LOGGING_IN,         /**< Waiting for the salt or the answer. */
+            WAITING_CHARACTER,  /**< Waiting for existing characters. */
+            CREATING,
+            SELECTING,
+            CONNECTING_GAME,
+            PLAYING,
+            FAILED
+        };
+
+        Bot(int index, const BotSettings &settings, BotStatistics &stats);
+
+        ~Bot();
+
+        /**
+         * Starts connecting to the account server.
+         */
+        void start(ENetHost *accountHost, const ENetAddress &address,
+                   unsigned now);
+
+        /**
+         * Called once the connection to one of the servers is established.
+         */
+        void connected(ENetPeer *peer);
+
+        /**
+         * Called when one of the servers closed the connection.
+         */
+        void disconnected(ENetPeer *peer);
+
+        void processMessage(ENetPeer *peer, MessageIn &msg, unsigned now);
+
+        /**
+         * Returns the compressor needed to read the messages coming from
+         * the given peer, or NULL when they are never compressed.
+         */
+        MessageCompressor *getCompressor(ENetPeer *peer) const;
+
+        /**
+         * Performs the periodic work of the bot, such as its next action.
+         */
+        void update(ENetHost *gameHost, unsigned now);
+
+        /**
+         * Disconnects from the servers.
+         */
+        void stop();
+
+        State getState() const
+        { return mState; }
+
+    private:
+        Bot(const Bot &);
+        Bot &operator=(const Bot &);
+
+        void processAccountMessage(MessageIn &msg, unsigned now);
+        void processGameMessage(MessageIn &msg, unsigned now);
+
+        void handleBeingsMove(MessageIn &msg, unsigned now);
+
+        void sendLogin(const std::string &salt);
+        void sendCreate();
+        void fail(const std::string &reason);
+
+        void walk(unsigned now);
+        void attack();
+        void chat(unsigned now);
+        void trade();
+
+        /** Returns a random being around, or 0 when there is none. */
+        int randomBeing(int type) const;
+
+        struct BeingInfo
+        {
+            BeingInfo(): type(-1) {}
+
+            int type;
+            Point pos;
+        };
+        typedef std::map<int, BeingInfo> Beings;
+
+        const int mIndex;
+        const BotSettings &mSettings;
+        BotStatistics &mStats;
+        std::string mName;
+
+        State mState;
+        NetComputer *mAccount;
+        NetComputer *mGame;
+        ENetPeer *mAccountPeer;
+        ENetPeer *mGamePeer;
+
+        std::string mToken;
+        std::string mGameHost;
+        int mGamePort;
+        int mEncoding;          /**< Encoding accepted by the game server. */
+
+        unsigned mDeadline;     /**< Time of the next step. */
+        unsigned mWalkSent;     /**< Time of the pending walk, or 0. */
+        unsigned mSaySent;      /**< Time of the pending say, or 0. */
+        std::string mSayText;
+
+        int mId;                /**< Public id of the own being, or 0. */
+        Beings mBeings;
+};
+
+#endif // BOT_H
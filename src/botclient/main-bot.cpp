@@ -0,0 +1,406 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "botclient/bot.h"
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "common/manaserv_protocol.h"
+#include "net/bandwidth.h"
+#include "net/messagein.h"
+#include "net/messageout.h"
+#include "utils/logger.h"
+#include "utils/string.h"
+#include "utils/timer.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <signal.h>
+#include <sstream>
+
+using utils::Logger;
+
+#define DEFAULT_LOG_FILE        "manaserv-botclient.log"
+
+#ifdef ENET_VERSION_CREATE
+#define ENET_CUTOFF ENET_VERSION_CREATE(1,3,0)
+#else
+#define ENET_CUTOFF 0xFFFFFFFF
+#endif
+
+static bool running = true;     /**< Determines if the bots keep running */
+
+BandwidthMonitor *gBandwidth;
+
+/** Callback used when SIGQUIT signal is received. */
+static void closeGracefully(int)
+{
+    running = false;
+}
+
+/**
+ * Returns the time in milliseconds, as used for the bot timings.
+ */
+static unsigned now()
+{
+    return (unsigned) (utils::getTimeInMicrosec() / 1000);
+}
+
+/**
+ * Creates a client host able to hold the given number of connections.
+ */
+static ENetHost *createHost(int peers)
+{
+#if defined(ENET_VERSION) && ENET_VERSION >= ENET_CUTOFF
+    return enet_host_create(NULL, peers, 0, 0, 0);
+#else
+    return enet_host_create(NULL, peers, 0, 0);
+#endif
+}
+
+/**
+ * Reads the bot_* options shared by all the bots.
+ */
+static void readSettings(BotSettings &settings)
+{
+    settings.namePrefix = Configuration::getValue("bot_namePrefix", "bot");
+    settings.password = Configuration::getValue("bot_password", "botpass");
+    settings.chatMessage = Configuration::getValue("bot_chatMessage",
+                                                   "Hello from a bot");
+    settings.registerAccounts = Configuration::getBoolValue("bot_register",
+                                                            true);
+
+    std::istringstream stats(Configuration::getValue("bot_characterStats",
+                                                     "17,17,17,17,16,16"));
+    std::string stat;
+    while (std::getline(stats, stat, ','))
+        settings.characterStats.push_back(utils::stringToInt(stat));
+
+    settings.encoding = 0;
+    if (Configuration::getBoolValue("bot_compactEncoding", true))
+        settings.encoding |= ManaServ::ENCODING_COMPACT;
+    if (Configuration::getBoolValue("bot_compression", true))
+        settings.encoding |= ManaServ::ENCODING_COMPRESSED;
+
+    settings.actionInterval =
+            std::max(1, Configuration::getValue("bot_actionInterval", 1000));
+    settings.walkRadius =
+            std::max(1, Configuration::getValue("bot_walkRadius", 256));
+    settings.walkWeight = Configuration::getValue("bot_walkWeight", 6);
+    settings.attackWeight = Configuration::getValue("bot_attackWeight", 2);
+    settings.chatWeight = Configuration::getValue("bot_chatWeight", 1);
+    settings.tradeWeight = Configuration::getValue("bot_tradeWeight", 1);
+}
+
+/**
+ * Handles the pending events of a host, dispatching them to the bots.
+ */
+static void processHost(ENetHost *host, unsigned time)
+{
+    ENetEvent event;
+    while (enet_host_service(host, &event, 0) > 0)
+    {
+        Bot *bot = static_cast<Bot *>(event.peer->data);
+
+        switch (event.type)
+        {
+            case ENET_EVENT_TYPE_CONNECT:
+                if (bot)
+                    bot->connected(event.peer);
+                break;
+
+            case ENET_EVENT_TYPE_RECEIVE:
+                if (bot && event.packet->dataLength >= 2)
+                {
+                    MessageIn msg((char *) event.packet->data,
+                                  event.packet->dataLength,
+                                  bot->getCompressor(event.peer));
+                    bot->processMessage(event.peer, msg, time);
+                }
+                enet_packet_destroy(event.packet);
+                break;
+
+            case ENET_EVENT_TYPE_DISCONNECT:
+                if (bot)
+                    bot->disconnected(event.peer);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+/**
+ * Appends the world tick durations of the game servers, as found in the
+ * statistics file written by the account server.
+ */
+static void reportServerTicks(std::ostream &os, const std::string &fileName)
+{
+    std::ifstream in(fileName.c_str());
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (line.compare(0, 6, "<ticks") == 0)
+            os << " server" << line.substr(6, line.size() - 8);
+    }
+}
+
+/**
+ * Logs the measurements of the last report interval.
+ */
+static void report(BotStatistics &stats, int started,
+                   const std::string &statisticsFile)
+{
+    std::ostringstream os;
+    os << "bots=" << started
+       << " playing=" << stats.playing
+       << " failed=" << stats.failures
+       << " actions=" << stats.actions
+       << " walk p50=" << stats.walkLatency.percentile(50)
+       << " p99=" << stats.walkLatency.percentile(99)
+       << " say p50=" << stats.chatLatency.percentile(50)
+       << " p99=" << stats.chatLatency.percentile(99)
+       << " rtt p50=" << stats.roundTrip.percentile(50)
+       << " p99=" << stats.roundTrip.percentile(99);
+
+    if (!statisticsFile.empty())
+        reportServerTicks(os, statisticsFile);
+
+    LOG_INFO(os.str());
+    std::cout << os.str() << std::endl;
+
+    stats.walkLatency.clear();
+    stats.chatLatency.clear();
+    stats.roundTrip.clear();
+    stats.actions = 0;
+}
+
+/**
+ * Show command line arguments
+ */
+static void printHelp()
+{
+    std::cout << "manaserv-botclient" << std::endl << std::endl
+              << "Options: " << std::endl
+              << "  -h --help          : Display this help" << std::endl
+              << "     --config <path> : Set the config path to use."
+              << " (Default: ./manaserv.xml)" << std::endl
+              << "     --verbosity <n> : Set the verbosity level" << std::endl
+              << "     --count <n>     : Set the number of bots" << std::endl;
+    exit(EXIT_NORMAL);
+}
+
+struct CommandLineOptions
+{
+    CommandLineOptions():
+        verbosity(Logger::Info),
+        verbosityChanged(false),
+        count(0)
+    {}
+
+    std::string configPath;
+
+    Logger::Level verbosity;
+    bool verbosityChanged;
+
+    int count;
+};
+
+/**
+ * Parse the command line arguments
+ */
+static void parseOptions(int argc, char *argv[], CommandLineOptions &options)
+{
+    const char *optString = "h";
+
+    const struct option longOptions[] =
+    {
+        { "help",       no_argument,       0, 'h' },
+        { "config",     required_argument, 0, 'c' },
+        { "verbosity",  required_argument, 0, 'v' },
+        { "count",      required_argument, 0, 'n' },
+        { 0, 0, 0, 0 }
+    };
+
+    while (optind < argc)
+    {
+        int result = getopt_long(argc, argv, optString, longOptions, NULL);
+
+        if (result == -1)
+            break;
+
+        switch (result)
+        {
+            default: // Unknown option.
+            case 'h':
+                printHelp();
+                break;
+            case 'c':
+                options.configPath = optarg;
+                break;
+            case 'v':
+                options.verbosity = static_cast<Logger::Level>(atoi(optarg));
+                options.verbosityChanged = true;
+                break;
+            case 'n':
+                options.count = atoi(optarg);
+                break;
+        }
+    }
+}
+
+/**
+ * Main function, connects the bots and lets them play.
+ */
+int main(int argc, char *argv[])
+{
+    CommandLineOptions options;
+    parseOptions(argc, argv, options);
+
+    if (!Configuration::initialize(options.configPath))
+    {
+        LOG_FATAL("Refusing to run without configuration!");
+        exit(EXIT_CONFIG_NOT_FOUND);
+    }
+
+#if (defined __USE_UNIX98 || defined __FreeBSD__)
+    signal(SIGQUIT, closeGracefully);
+#endif
+    signal(SIGINT, closeGracefully);
+    signal(SIGTERM, closeGracefully);
+
+    Logger::initialize(Configuration::getValue("log_botClientFile",
+                                               DEFAULT_LOG_FILE));
+    if (!options.verbosityChanged)
+        options.verbosity = static_cast<Logger::Level>(
+                            Configuration::getValue("log_botClientLogLevel",
+                                                    options.verbosity));
+    Logger::setVerbosity(options.verbosity);
+
+    gBandwidth = new BandwidthMonitor;
+    std::srand(std::time(NULL));
+
+    BotSettings settings;
+    readSettings(settings);
+
+    const int count = options.count > 0 ?
+            options.count : Configuration::getValue("bot_count", 100);
+    const unsigned rampUp = Configuration::getValue("bot_rampUp", 10000);
+    const unsigned duration = Configuration::getValue("bot_duration", 0);
+    const std::string statisticsFile =
+            Configuration::getValue("bot_statisticsFile", std::string());
+
+    if (enet_initialize() != 0)
+    {
+        LOG_FATAL("An error occurred while initializing ENet");
+        exit(EXIT_NET_EXCEPTION);
+    }
+
+    ENetHost *accountHost = createHost(count);
+    ENetHost *gameHost = createHost(count);
+    if (!accountHost || !gameHost)
+    {
+        LOG_FATAL("Unable to create the ENet client hosts.");
+        exit(EXIT_NET_EXCEPTION);
+    }
+
+    ENetAddress accountAddress;
+    enet_address_set_host(&accountAddress,
+                          Configuration::getValue("net_accountHost",
+                                                  "localhost").c_str());
+    accountAddress.port = Configuration::getValue(
+            "net_accountListenToClientPort", DEFAULT_SERVER_PORT);
+
+    LOG_INFO("Starting " << count << " bots over " << rampUp << " ms");
+
+    BotStatistics stats;
+    std::vector<Bot *> bots;
+    bots.reserve(count);
+
+    utils::Timer reportTimer(Configuration::getValue("bot_reportInterval",
+                                                     10000));
+    utils::Timer frameTimer(5);
+    reportTimer.start();
+    frameTimer.start();
+    const unsigned startTime = now();
+
+    while (running)
+    {
+        const unsigned time = now();
+        const unsigned elapsed = time - startTime;
+
+        // Spread the logins over the ramp up period
+        while ((int) bots.size() < count &&
+               (rampUp == 0 || elapsed >= rampUp * bots.size() / count))
+        {
+            Bot *bot = new Bot(bots.size(), settings, stats);
+            bot->start(accountHost, accountAddress, time);
+            bots.push_back(bot);
+        }
+
+        processHost(accountHost, time);
+        processHost(gameHost, time);
+
+        for (std::vector<Bot *>::iterator it = bots.begin(),
+             it_end = bots.end(); it != it_end; ++it)
+        {
+            (*it)->update(gameHost, time);
+        }
+
+        enet_host_flush(accountHost);
+        enet_host_flush(gameHost);
+
+        if (reportTimer.poll())
+            report(stats, bots.size(), statisticsFile);
+
+        if (duration && elapsed >= duration)
+            running = false;
+
+        frameTimer.sleep();
+    }
+
+    LOG_INFO("Stopping the bots...");
+    report(stats, bots.size(), statisticsFile);
+
+    for (std::vector<Bot *>::iterator it = bots.begin(),
+         it_end = bots.end(); it != it_end; ++it)
+    {
+        (*it)->stop();
+    }
+    enet_host_flush(accountHost);
+    enet_host_flush(gameHost);
+
+    for (std::vector<Bot *>::iterator it = bots.begin(),
+         it_end = bots.end(); it != it_end; ++it)
+    {
+        delete *it;
+    }
+
+    enet_host_destroy(accountHost);
+    enet_host_destroy(gameHost);
+    enet_deinitialize();
+    delete gBandwidth;
+
+    return EXIT_NORMAL;
+}
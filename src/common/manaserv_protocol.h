@@ -29,7 +29,7 @@
 namespace ManaServ {
 
 enum {
-    PROTOCOL_VERSION = 1,
+    PROTOCOL_VERSION = 2,
     SUPPORTED_DB_VERSION = 21
 };
 
@@ -42,7 +42,8 @@ enum ValueType {
     Int16,
     Int32,
     String,
-    Double
+    Double,
+    VarInt
 };
 
 /**
@@ -57,6 +58,7 @@ enum ValueType {
  * - GAMSG_*: from game server to account server
  *
  * Components: B byte, W word, D double word, S variable-size string
+ *             V zigzag varint (1-5 bytes, see ENCODING_COMPACT)
  *             C tile-based coordinates (B*3)
  *
  * Hosts:      P (player's client), A (account server), C (chat server),
@@ -93,8 +95,8 @@ enum {
     PAMSG_PASSWORD_CHANGE          = 0x0034, // S old password, S new password
     APMSG_PASSWORD_CHANGE_RESPONSE = 0x0035, // B error
 
-    PGMSG_CONNECT                  = 0x0050, // B*32 token
-    GPMSG_CONNECT_RESPONSE         = 0x0051, // B error
+    PGMSG_CONNECT                  = 0x0050, // B*32 token [, B encoding flags]
+    GPMSG_CONNECT_RESPONSE         = 0x0051, // B error [, B encoding flags]
     PCMSG_CONNECT                  = 0x0053, // B*32 token
     CPMSG_CONNECT_RESPONSE         = 0x0054, // B error
 
@@ -253,7 +255,7 @@ enum {
     GAMSG_REGISTER              = 0x0500, // S address, W port, S password, D items db revision
     AGMSG_REGISTER_RESPONSE     = 0x0501, // W item version, W password response, { S globalvar_key, S globalvar_value }
     AGMSG_ACTIVE_MAP            = 0x0502, // W map id, W Number of mapvar_key mapvar_value sent, { S mapvar_key, S mapvar_value }, W Number of map items, { D item Id, W amount, W posX, W posY }
-    AGMSG_PLAYER_ENTER          = 0x0510, // B*32 token, D id, S name, serialised character data
+    AGMSG_PLAYER_ENTER          = 0x0510, // B*32 token, D id, S name, serialised character data, W quest var count, { S name, S value }
     GAMSG_PLAYER_DATA           = 0x0520, // D id, serialised character data
     GAMSG_REDIRECT              = 0x0530, // D id
     AGMSG_REDIRECT_RESPONSE     = 0x0531, // D id, B*32 token, S game address, W game port
@@ -271,7 +273,7 @@ enum {
     GAMSG_BAN_PLAYER            = 0x0550, // D id, W duration
     GAMSG_CHANGE_PLAYER_LEVEL   = 0x0555, // D id, W level
     GAMSG_CHANGE_ACCOUNT_LEVEL  = 0x0556, // D id, W level
-    GAMSG_STATISTICS            = 0x0560, // { W map id, W entity nb, W monster nb, W player nb, { D character id }* }*
+    GAMSG_STATISTICS            = 0x0560, // D tick p50, D tick p99, D tick max (in microseconds), { W map id, W entity nb, W monster nb, W player nb, { D character id }* }*
     CGMSG_CHANGED_PARTY         = 0x0590, // D character id, D party id
     GCMSG_REQUEST_POST          = 0x05A0, // D character id
     CGMSG_POST_RESPONSE         = 0x05A1, // D receiver id, { S sender name, S letter, W num attachments { W attachment item id, W quantity } }
@@ -283,7 +285,8 @@ enum {
     GAMSG_ANNOUNCE              = 0x0603, // S text, W senderid, S sendername
 
     XXMSG_DEBUG_FLAG            = 0x8000, // Message in debug mode
-    XXMSG_INVALID               = 0x7FFF
+    XXMSG_COMPRESSED_FLAG       = 0x4000, // Payload after the id is deflated
+    XXMSG_INVALID               = 0x7FFF  // Never compressed
 };
 
 // Generic return values
@@ -389,6 +392,34 @@ enum {
     MOVING_DESTINATION = 2
 };
 
+/**
+ * Wire encoding flags, requested by the client in PGMSG_CONNECT and
+ * acknowledged by the game server in GPMSG_CONNECT_RESPONSE.
+ *
+ * With ENCODING_COMPACT, GPMSG_BEINGS_MOVE, GPMSG_BEINGS_DAMAGE and
+ * GPMSG_ITEMS use zigzag varints (V) instead of fixed width integers:
+ *
+ * GPMSG_BEINGS_MOVE   { V being id delta, B flags [, [V*2 position delta,]
+ *                       V*2 destination delta, B speed] }*
+ * GPMSG_BEINGS_DAMAGE { V being id delta, V amount }*
+ * GPMSG_ITEMS         { V item id, V*2 position delta }*
+ *
+ * Being ids are relative to the previous entry of the same message (starting
+ * at 0). Being positions are relative to the last coordinates sent to the
+ * client for that being, through GPMSG_BEING_ENTER or an earlier move entry.
+ * Item positions are relative to the previous item of the same message
+ * (starting at 0, 0).
+ *
+ * With ENCODING_COMPRESSED, messages above the configured size threshold
+ * are sent with XXMSG_COMPRESSED_FLAG set on their id and the rest of the
+ * message as raw deflate data, flushed with Z_SYNC_FLUSH. Every client
+ * message is compressed on its own.
+ */
+enum {
+    ENCODING_COMPACT = 1,
+    ENCODING_COMPRESSED = 2
+};
+
 // Chat errors return values
 enum {
     CHAT_USING_BAD_WORDS = 0x40,
@@ -34,6 +34,7 @@
 #include "net/messagein.h"
 #include "serialize/characterdata.h"
 #include "utils/logger.h"
+#include "utils/percentiles.h"
 #include "utils/tokendispenser.h"
 #include "utils/tokencollector.h"
 
@@ -77,6 +78,9 @@ bool AccountConnection::start(int gameServerPort)
 
     LOG_INFO("Connection established to the account server.");
 
+    setCompressionEnabled(
+            Configuration::getBoolValue("net_interServerCompression", true));
+
     const std::string gameServerName =
         Configuration::getValue("net_gameServerName", std::string());
     const std::string gameServerAddress =
@@ -186,19 +190,7 @@ void AccountConnection::processMessage(MessageIn &msg)
                     int posY = msg.readInt16();
 
                     if (ItemClass *ic = itemManager->getItem(itemId))
-                    {
-                        Entity *item = Item::create(m,
-                                                    Point(posX, posY),
-                                                    ic, amount);
-
-                        if (!GameState::insertOrDelete(item))
-                        {
-                            // The map is full.
-                            LOG_WARN("Couldn't add floor item(s) " << itemId
-                                     << " into map " << mapId);
-                            return;
-                        }
-                    }
+                        m->addFloorItem(ic, amount, posX, posY);
                 }
             }
         } break;
@@ -336,15 +328,19 @@ void AccountConnection::banCharacter(Character *ch, int duration)
     send(msg);
 }
 
-void AccountConnection::sendStatistics()
+void AccountConnection::sendStatistics(
+        const utils::RollingPercentiles &tickTimes)
 {
     MessageOut msg(GAMSG_STATISTICS);
+    msg.writeInt32(tickTimes.percentile(50));
+    msg.writeInt32(tickTimes.percentile(99));
+    msg.writeInt32(tickTimes.max());
     const MapManager::Maps &maps = MapManager::getMaps();
     for (MapManager::Maps::const_iterator i = maps.begin(),
          i_end = maps.end(); i != i_end; ++i)
     {
         MapComposite *m = i->second;
-        if (!m->isActive()) continue;
+        if (!m->isStarted()) continue;
         msg.writeInt16(i->first);
         int nbEntities = 0, nbMonsters = 0;
         typedef std::vector< Entity * > Entities;
@@ -24,6 +24,8 @@
 #include "net/messageout.h"
 #include "net/connection.h"
 
+namespace utils { class RollingPercentiles; }
+
 class Character;
 class MapComposite;
 
@@ -81,9 +83,10 @@ class AccountConnection : public Connection
         void banCharacter(Character *, int);
 
         /**
-         * Gathers statistics and sends them.
+         * Gathers statistics and sends them, together with the durations
+         * of the recent world ticks.
          */
-        void sendStatistics();
+        void sendStatistics(const utils::RollingPercentiles &tickTimes);
 
         /**
          * Send letter
@@ -55,7 +55,8 @@ class Actor : public Entity
             mPublicID(65535),
             mSize(0),
             mWalkMask(0),
-            mBlockType(BLOCKTYPE_NONE)
+            mBlockType(BLOCKTYPE_NONE),
+            mZoneIndex(0)
         {}
 
         ~Actor();
@@ -140,6 +141,16 @@ class Actor : public Entity
          */
         virtual void setMap(MapComposite *map);
 
+        /**
+         * Gets the position of the actor in the objects of its map zone.
+         * Only meaningful while the actor is on a map.
+         */
+        unsigned getZoneIndex() const
+        { return mZoneIndex; }
+
+        void setZoneIndex(unsigned index)
+        { mZoneIndex = index; }
+
     protected:
 
         /** Delay until move to next tile in miliseconds. */
@@ -156,6 +167,8 @@ class Actor : public Entity
 
         unsigned char mWalkMask;
         BlockType mBlockType;
+
+        unsigned mZoneIndex;        /**< Position in its map zone. */
 };
 
 #endif // ACTOR_H
@@ -21,6 +21,7 @@
 #include "attribute.h"
 #include "game-server/being.h"
 #include "utils/logger.h"
+#include <algorithm>
 #include <cassert>
 
 AttributeModifiersEffect::AttributeModifiersEffect(StackableType stackableType,
@@ -40,14 +41,7 @@ AttributeModifiersEffect::AttributeModifiersEffect(StackableType stackableType,
               << " and stackableType " << stackableType << ".");
 }
 
-AttributeModifiersEffect::~AttributeModifiersEffect()
-{
-    // ?
-    /*mStates.clear();*/
-    LOG_WARN("DELETION of attribute effect!");
-}
-
-bool AttributeModifiersEffect::add(unsigned short duration,
+bool AttributeModifiersEffect::add(int expires,
                                    double value,
                                    double prevLayerValue,
                                    int level)
@@ -56,7 +50,7 @@ bool AttributeModifiersEffect::add(unsigned short duration,
               " with a previous layer value of " << prevLayerValue << ". "
               "Current mod at this layer: " << mMod << ".");
     bool ret = false;
-    mStates.push_back(new AttributeModifierState(duration, value, level));
+    mStates.push_back(AttributeModifierState(expires, value, level));
     switch (mStackableType) {
     case Stackable:
         switch (mEffectType) {
@@ -127,10 +121,10 @@ bool AttributeModifiersEffect::add(unsigned short duration,
     return ret;
 }
 
-bool durationCompare(const AttributeModifierState *lhs,
-                     const AttributeModifierState *rhs)
+bool durationCompare(const AttributeModifierState &lhs,
+                     const AttributeModifierState &rhs)
 {
-    return lhs->mDuration < rhs->mDuration;
+    return lhs.mExpires < rhs.mExpires;
 }
 
 bool AttributeModifiersEffect::remove(double value, unsigned id,
@@ -138,22 +132,22 @@ bool AttributeModifiersEffect::remove(double value, unsigned id,
 {
     /* We need to find and check this entry exists, and erase the entry
        from the list too. */
+    /* Search only through those with a duration of 0. */
     if (!fullCheck)
-        mStates.sort(durationCompare); /* Search only through those with a duration of 0. */
+        std::stable_sort(mStates.begin(), mStates.end(), durationCompare);
     bool ret = false;
 
-    for (std::list< AttributeModifierState * >::iterator it = mStates.begin();
-         it != mStates.end() && (fullCheck || !(*it)->mDuration);)
+    for (std::vector<AttributeModifierState>::iterator it = mStates.begin();
+         it != mStates.end() && (fullCheck || !it->mExpires);)
     {
         /* Check for a match */
-        if ((*it)->mValue != value || (*it)->mId != id)
+        if (it->mValue != value || it->mId != id)
         {
             ++it;
             continue;
         }
 
-        delete *it;
-        mStates.erase(it++);
+        it = mStates.erase(it);
 
         /* If this is stackable, we need to update for every modifier affected */
         if (mStackableType == Stackable)
@@ -188,12 +182,12 @@ void AttributeModifiersEffect::updateMod(double value)
             else
             {
                 mMod = 1;
-                for (std::list< AttributeModifierState * >::const_iterator
+                for (std::vector<AttributeModifierState>::const_iterator
                      it = mStates.begin(),
                      it_end = mStates.end();
                     it != it_end;
                     ++it)
-                    mMod *= (*it)->mValue;
+                    mMod *= it->mValue;
             }
         }
         else LOG_ERROR("Attribute modifiers effect: unhandled type '"
@@ -204,13 +198,13 @@ void AttributeModifiersEffect::updateMod(double value)
         if (mMod == value)
         {
             mMod = 0;
-            for (std::list< AttributeModifierState * >::const_iterator
+            for (std::vector<AttributeModifierState>::const_iterator
                  it = mStates.begin(),
                  it_end = mStates.end();
                 it != it_end;
                 ++it)
-                if ((*it)->mValue > mMod)
-                    mMod = (*it)->mValue;
+                if (it->mValue > mMod)
+                    mMod = it->mValue;
         }
     }
     else
@@ -248,28 +242,29 @@ bool AttributeModifiersEffect::recalculateModifiedValue(double newPrevLayerValue
 }
 
 
-bool Attribute::add(unsigned short duration, double value,
+bool Attribute::add(int expires, double value,
                     unsigned layer, int id)
 {
     assert(mMods.size() > layer);
-    LOG_DEBUG("Adding modifier to attribute with duration " << duration
+    LOG_DEBUG("Adding modifier to attribute expiring at " << expires
               << ", value " << value
               << ", at layer " << layer
               << " with id " << id);
-    if (mMods.at(layer)->add(duration, value,
-                            (layer ? mMods.at(layer - 1)->getCachedModifiedValue()
-                                   : mBase)
-                            , id))
+    if (mMods[layer].add(expires, value,
+                         (layer ? mMods[layer - 1].getCachedModifiedValue()
+                                : mBase)
+                         , id))
     {
         while (++layer < mMods.size())
         {
-            if (!mMods.at(layer)->recalculateModifiedValue(
-                       mMods.at(layer - 1)->getCachedModifiedValue()))
+            if (!mMods[layer].recalculateModifiedValue(
+                       mMods[layer - 1].getCachedModifiedValue()))
             {
                 LOG_DEBUG("Modifier added, but modified value not changed.");
                 return false;
             }
         }
+        updateModified();
         LOG_DEBUG("Modifier added. Base value: " << mBase << ", new modified "
                   "value: " << getModifiedAttribute() << ".");
         return true;
@@ -282,93 +277,116 @@ bool Attribute::remove(double value, unsigned layer,
                        int lvl, bool fullcheck)
 {
     assert(mMods.size() > layer);
-    if (mMods.at(layer)->remove(value, lvl, fullcheck))
+    if (mMods[layer].remove(value, lvl, fullcheck))
     {
         for (; layer < mMods.size(); ++layer)
-            if (!mMods.at(layer)->recalculateModifiedValue(
-                        layer ? mMods.at(layer - 1)->getCachedModifiedValue()
+            if (!mMods[layer].recalculateModifiedValue(
+                        layer ? mMods[layer - 1].getCachedModifiedValue()
                               : mBase))
                return false;
+        updateModified();
         return true;
     }
     return false;
 }
 
-bool AttributeModifiersEffect::tick()
+bool AttributeModifiersEffect::expire(int tick)
 {
     bool ret = false;
-    std::list<AttributeModifierState *>::iterator it = mStates.begin();
+    std::vector<AttributeModifierState>::iterator it = mStates.begin();
     while (it != mStates.end())
     {
-        if ((*it)->tick())
+        if (it->hasExpired(tick))
         {
-            double value = (*it)->mValue;
+            double value = it->mValue;
             LOG_DEBUG("Modifier of value " << value << " expiring!");
-            delete *it;
-            mStates.erase(it++);
+            it = mStates.erase(it);
             updateMod(value);
             ret = true;
         }
-        ++it;
+        else
+        {
+            ++it;
+        }
     }
     return ret;
 }
 
+int AttributeModifiersEffect::getNextExpiry() const
+{
+    int next = 0;
+    for (std::vector<AttributeModifierState>::const_iterator
+         it = mStates.begin(), it_end = mStates.end(); it != it_end; ++it)
+    {
+        if (it->mExpires && (!next || it->mExpires < next))
+            next = it->mExpires;
+    }
+    return next;
+}
+
 Attribute::Attribute(const AttributeManager::AttributeInfo &info):
     mBase(0),
+    mModified(0),
     mMinValue(info.minimum),
     mMaxValue(info.maximum)
 {
     const std::vector<AttributeModifier> &modifiers = info.modifiers;
     LOG_DEBUG("Construction of new attribute with '" << modifiers.size()
         << "' layers.");
+    mMods.reserve(modifiers.size());
     for (unsigned i = 0; i < modifiers.size(); ++i)
     {
         LOG_DEBUG("Adding layer with stackable type "
                   << modifiers[i].stackableType
                   << " and effect type " << modifiers[i].effectType << ".");
-        mMods.push_back(new AttributeModifiersEffect(modifiers[i].stackableType,
-                                                     modifiers[i].effectType));
+        mMods.push_back(AttributeModifiersEffect(modifiers[i].stackableType,
+                                                 modifiers[i].effectType));
         LOG_DEBUG("Layer added.");
     }
     mBase = checkBounds(mBase);
+    updateModified();
 }
 
-Attribute::~Attribute()
-{
-//    for (std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin(),
-//         it_end = mMods.end(); it != it_end; ++it)
-//    {
-        // ?
-        //delete *it;
-//    }
-}
-
-bool Attribute::tick()
+bool Attribute::expire(int tick)
 {
     bool ret = false;
     double prev = mBase;
-    for (std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin(),
+    for (std::vector<AttributeModifiersEffect>::iterator it = mMods.begin(),
         it_end = mMods.end(); it != it_end; ++it)
     {
-        if ((*it)->tick())
+        if (it->expire(tick))
         {
-            LOG_DEBUG("Attribute layer " << mMods.begin() - it
+            LOG_DEBUG("Attribute layer " << it - mMods.begin()
                       << " has expiring modifiers.");
             ret = true;
         }
         if (ret)
-            if (!(*it)->recalculateModifiedValue(prev)) ret = false;
-        prev = (*it)->getCachedModifiedValue();
+            if (!it->recalculateModifiedValue(prev)) ret = false;
+        prev = it->getCachedModifiedValue();
     }
+    updateModified();
     return ret;
 }
 
+int Attribute::getNextExpiry() const
+{
+    int next = 0;
+    for (std::vector<AttributeModifiersEffect>::const_iterator
+         it = mMods.begin(), it_end = mMods.end(); it != it_end; ++it)
+    {
+        const int layerNext = it->getNextExpiry();
+        if (layerNext && (!next || layerNext < next))
+            next = layerNext;
+    }
+    return next;
+}
+
 void Attribute::clearMods()
 {
-    for (std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin(),
+    for (std::vector<AttributeModifiersEffect>::iterator it = mMods.begin(),
          it_end = mMods.end(); it != it_end; ++it)
-        (*it)->clearMods(mBase);
+        it->clearMods(mBase);
+    updateModified();
 }
 
 void Attribute::setBase(double base)
@@ -377,14 +395,15 @@ void Attribute::setBase(double base)
     LOG_DEBUG("Setting base attribute from " << mBase << " to " << base << ".");
     double prev = mBase = base;
 
-    std::vector<AttributeModifiersEffect *>::iterator it = mMods.begin();
+    std::vector<AttributeModifiersEffect>::iterator it = mMods.begin();
     while (it != mMods.end())
     {
-        if ((*it)->recalculateModifiedValue(prev))
-            prev = (*it++)->getCachedModifiedValue();
+        if (it->recalculateModifiedValue(prev))
+            prev = (it++)->getCachedModifiedValue();
         else
             break;
     }
+    updateModified();
 }
 
 void AttributeModifiersEffect::clearMods(double baseValue)
@@ -24,33 +24,34 @@
 #include "common/defines.h"
 #include "attributemanager.h"
 #include <vector>
-#include <list>
 
 class AttributeModifierState
 {
     public:
-        AttributeModifierState(unsigned short duration,
+        AttributeModifierState(int expires,
                                double value,
                                unsigned id)
-            : mDuration(duration)
+            : mExpires(expires)
             , mValue(value)
             , mId(id)
         {}
 
-        bool tick() { return mDuration ? !--mDuration : false; }
+        bool hasExpired(int tick) const
+        { return mExpires && mExpires <= tick; }
 
     private:
-        /** Number of ticks (0 means permanent, e.g. equipment). */
-        unsigned short mDuration;
-        const double mValue;   /**< Positive or negative amount. */
+        /** Tick at which the modifier expires (0 means permanent, e.g.
+            equipment). */
+        int mExpires;
+        double mValue;          /**< Positive or negative amount. */
         /**
          * Special purpose variable used to identify this effect to
          * dispells or similar. Exact usage depends on the effect,
          * origin, etc.
          */
-        const unsigned mId;
-        friend bool durationCompare(const AttributeModifierState*,
-                                    const AttributeModifierState*);
+        unsigned mId;
+        friend bool durationCompare(const AttributeModifierState &,
+                                    const AttributeModifierState &);
         friend class AttributeModifiersEffect;
 };
 
@@ -59,7 +60,6 @@ class AttributeModifiersEffect
     public:
         AttributeModifiersEffect(StackableType stackableType,
                                  ModifierEffectType effectType);
-        ~AttributeModifiersEffect();
 
         /**
          * Recalculates the value for this level.
@@ -69,7 +69,7 @@ class AttributeModifiersEffect
          * If this returns true, the cached values for *all* modifiers of a
          *     higher level must be recalculated, as well as the final
          */
-        bool add(unsigned short duration, double value,
+        bool add(int expires, double value,
                  double prevLayerValue, int level);
 
         /**
@@ -98,7 +98,17 @@ class AttributeModifiersEffect
 
         double getCachedModifiedValue() const { return mCacheVal; }
 
-        bool tick();
+        /**
+         * Removes the modifiers that expire at or before the given tick.
+         * @returns Whether any modifier was removed.
+         */
+        bool expire(int tick);
+
+        /**
+         * Returns the tick at which the next modifier expires, or 0 when
+         * all of them are permanent.
+         */
+        int getNextExpiry() const;
 
         /**
          * clearMods() - removes all modifications present in this layer.
@@ -109,8 +119,11 @@ class AttributeModifiersEffect
         void clearMods(double baseValue);
 
     private:
-        /** List of all modifications present at this level */
-        std::list<AttributeModifierState *> mStates;
+        /**
+         * All modifications present at this level, stored by value since
+         * there are rarely more than a few.
+         */
+        std::vector<AttributeModifierState> mStates;
         /**
          * Stores the value that results from mStates. This takes into
          * account all previous layers.
@@ -121,33 +134,34 @@ class AttributeModifiersEffect
          * 0 for additive modifiers and 1 for multiplicative modifiers.
          */
         double mMod;
-        const StackableType mStackableType;
-        const ModifierEffectType mEffectType;
+        StackableType mStackableType;
+        ModifierEffectType mEffectType;
 };
 
 /**
  * Represents some attribute of a being. Is has a base value and a modified
  * value, subject to modifiers that can be added and removed.
+ *
+ * The modifier layers are kept by value, and the modified value is cached,
+ * so that reading an attribute does not chase any pointers.
  */
 class Attribute
 {
     public:
         Attribute()
             : mBase(0)
+            , mModified(0)
             , mMinValue(0)
             , mMaxValue(0)
         {throw;} // DEBUG; Find improper constructions
 
         Attribute(const AttributeManager::AttributeInfo &info);
 
-        ~Attribute();
-
         void setBase(double base);
         double getBase() const { return mBase; }
 
         double getModifiedAttribute() const
-        { return mMods.empty() ? mBase :
-                                 (*mMods.rbegin())->getCachedModifiedValue(); }
+        { return mModified; }
 
         /*
          * add() and remove() are the standard functions used to add and
@@ -155,8 +169,7 @@ class Attribute
          */
 
         /**
-         * @param duration The amount of time before the modifier expires
-         *        naturally.
+         * @param expires The tick at which the modifier expires naturally.
          *        When set to 0, the effect does not expire.
          * @param value The value to be applied as the modifier.
          * @param layer The id of the layer with which this modifier is to be
@@ -164,7 +177,7 @@ class Attribute
          * @param id Used to identify this effect.
          * @return Whether the modified attribute value was changed.
          */
-        bool add(unsigned short duration, double value, unsigned layer, int id = 0);
+        bool add(int expires, double value, unsigned layer, int id = 0);
 
         /**
          * @param value The value of the modifier to be removed.
@@ -186,9 +199,16 @@ class Attribute
         void clearMods();
 
         /**
-         * tick() processes all timers associated with modifiers for this attribute.
+         * Removes the modifiers that expire at or before the given tick.
+         * @returns Whether the modified attribute value was changed.
+         */
+        bool expire(int tick);
+
+        /**
+         * Returns the tick at which the next modifier of this attribute
+         * expires, or 0 when none of them does.
          */
-        bool tick();
+        int getNextExpiry() const;
 
     private:
         /**
@@ -197,10 +217,18 @@ class Attribute
          */
         double checkBounds(double baseValue);
 
+        /**
+         * Updates the cached modified value from the last layer.
+         */
+        void updateModified()
+        { mModified = mMods.empty() ? mBase :
+                                      mMods.back().getCachedModifiedValue(); }
+
         double mBase; // The attribute base value
+        double mModified; // The value of the last layer
         double mMinValue; // The min authorized base and derived attribute value
         double mMaxValue; // The max authorized base and derived attribute value
-        std::vector<AttributeModifiersEffect *> mMods;
+        std::vector<AttributeModifiersEffect> mMods;
 };
 
 #endif // ATTRIBUTE_H
@@ -26,17 +26,24 @@
 
 void AttributeManager::initialize()
 {
-    reload();
+    XML::Document doc(mAttributeReferenceFile);
+    load(doc.rootNode());
+}
+
+void AttributeManager::initialize(xmlNodePtr rootNode)
+{
+    load(rootNode);
 }
 
-void AttributeManager::reload()
+void AttributeManager::load(xmlNodePtr rootNode)
 {
     mTagMap.clear();
     mAttributeMap.clear();
     for (unsigned i = 0; i < MaxScope; ++i)
         mAttributeScopes[i].clear();
 
-    readAttributesFile();
+    readAttributesFile(rootNode);
+    buildLayouts();
 
     LOG_DEBUG("attribute map:");
     LOG_DEBUG("Stackable is " << Stackable << ", NonStackable is " << NonStackable
@@ -112,11 +119,31 @@ const std::string *AttributeManager::getTag(const ModifierLocation &location) co
     return 0;
 }
 
-void AttributeManager::readAttributesFile()
+void AttributeManager::buildLayouts()
 {
-    XML::Document doc(mAttributeReferenceFile);
-    xmlNodePtr node = doc.rootNode();
+    for (unsigned type = 0; type < MaxScope; ++type)
+    {
+        AttributeScope attributes = mAttributeScopes[BeingScope];
+        attributes.insert(mAttributeScopes[type].begin(),
+                          mAttributeScopes[type].end());
+
+        AttributeLayout &layout = mLayouts[type];
+        layout = AttributeLayout();
+        for (AttributeScope::const_iterator it = attributes.begin(),
+             it_end = attributes.end(); it != it_end; ++it)
+        {
+            const unsigned id = it->first;
+            if (id >= layout.indices.size())
+                layout.indices.resize(id + 1, -1);
+            layout.indices[id] = layout.ids.size();
+            layout.ids.push_back(id);
+            layout.infos.push_back(it->second);
+        }
+    }
+}
 
+void AttributeManager::readAttributesFile(xmlNodePtr node)
+{
     if (!node || !xmlStrEqual(node->name, BAD_CAST "attributes"))
     {
         LOG_FATAL("Attribute Manager: " << mAttributeReferenceFile
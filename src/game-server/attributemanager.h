@@ -105,6 +105,22 @@ class AttributeManager
             std::vector<struct AttributeModifier> modifiers;
         };
 
+        /**
+         * The attributes of the beings of a scope, each with a compact
+         * index, so that beings can keep their attributes in an array.
+         */
+        struct AttributeLayout
+        {
+            /** Attribute ids by index, in increasing order. */
+            std::vector<int> ids;
+            std::vector<const AttributeInfo *> infos;
+            /** Indices by attribute id, -1 when not in the layout. */
+            std::vector<int> indices;
+
+            int getIndex(unsigned id) const
+            { return id < indices.size() ? indices[id] : -1; }
+        };
+
         AttributeManager(const std::string &file) :
             mAttributeReferenceFile(file)
         {}
@@ -115,9 +131,13 @@ class AttributeManager
         void initialize();
 
         /**
-         * Reloads attribute reference file.
+         * Loads the attributes from the root node of an already parsed
+         * reference file.
+         *
+         * The beings refer to the layouts and attribute infos, so there is
+         * no way to reload them in place. A reload creates a new manager.
          */
-        void reload();
+        void initialize(xmlNodePtr rootNode);
 
         const std::vector<AttributeModifier> *getAttributeInfo(int id) const;
 
@@ -126,6 +146,13 @@ class AttributeManager
 
         const AttributeScope &getAttributeScope(ScopeType) const;
 
+        /**
+         * Returns the layout of the attributes of the given scope. The
+         * character and monster layouts include the being scope.
+         */
+        const AttributeLayout &getLayout(ScopeType type) const
+        { return mLayouts[type]; }
+
         bool isAttributeDirectlyModifiable(int id) const;
 
         ModifierLocation getLocation(const std::string &tag) const;
@@ -133,9 +160,11 @@ class AttributeManager
         const std::string *getTag(const ModifierLocation &location) const;
 
     private:
-        void readAttributesFile();
+        void load(xmlNodePtr rootNode);
+        void readAttributesFile(xmlNodePtr node);
         void readAttributeNode(xmlNodePtr attributeNode);
         void readModifierNode(xmlNodePtr modifierNode, int attributeId);
+        void buildLayouts();
 
         // Attribute id -> { modifiable, min, max, { stackable type, effect type }[] }
         typedef std::map<int, AttributeInfo> AttributeMap;
@@ -144,6 +173,7 @@ class AttributeManager
         typedef std::map<std::string, ModifierLocation> TagMap;
 
         AttributeScope mAttributeScopes[MaxScope];
+        AttributeLayout mLayouts[MaxScope];
         AttributeMap mAttributeMap;
         TagMap mTagMap;
 
@@ -18,6 +18,7 @@
  *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <cassert>
 
 #include "game-server/being.h"
@@ -30,6 +31,7 @@
 #include "game-server/mapcomposite.h"
 #include "game-server/effect.h"
 #include "game-server/skillmanager.h"
+#include "game-server/state.h"
 #include "game-server/statuseffect.h"
 #include "game-server/statusmanager.h"
 #include "utils/logger.h"
@@ -47,22 +49,12 @@ Being::Being(EntityType type):
     mGender(GENDER_UNSPECIFIED),
     mCurrentAttack(0),
     mDirection(DOWN),
-    mEmoteId(0)
+    mEmoteId(0),
+    mAsleep(false),
+    mExpiryTimer(this, &Being::expire),
+    mRegenerationTimer(this, &Being::regenerate)
 {
-    const AttributeManager::AttributeScope &attr = attributeManager->getAttributeScope(BeingScope);
-    LOG_DEBUG("Being creation: initialisation of " << attr.size() << " attributes.");
-    for (AttributeManager::AttributeScope::const_iterator it1 = attr.begin(),
-         it1_end = attr.end();
-        it1 != it1_end;
-        ++it1)
-    {
-        if (mAttributes.count(it1->first))
-            LOG_WARN("Redefinition of attribute '" << it1->first << "'!");
-        LOG_DEBUG("Attempting to create attribute '" << it1->first << "'.");
-        mAttributes.insert(std::make_pair(it1->first,
-                                          Attribute(*it1->second)));
-
-    }
+    initializeAttributes(BeingScope);
 
     signal_inserted.connect(sigc::mem_fun(this, &Being::inserted));
 
@@ -79,6 +71,21 @@ Being::Being(EntityType type):
 #endif
 }
 
+void Being::initializeAttributes(ScopeType scope)
+{
+    mAttributeLayout = &attributeManager->getLayout(scope);
+
+    const std::vector<const AttributeManager::AttributeInfo *> &infos =
+            mAttributeLayout->infos;
+    LOG_DEBUG("Being creation: initialisation of " << infos.size()
+              << " attributes.");
+
+    mAttributes.clear();
+    mAttributes.reserve(infos.size());
+    for (unsigned i = 0; i < infos.size(); ++i)
+        mAttributes.push_back(Attribute(*infos[i]));
+}
+
 void Being::triggerEmote(int id)
 {
     mEmoteId = id;
@@ -92,6 +99,8 @@ int Being::damage(Actor * /* source */, const Damage &damage)
     if (mAction == DEAD)
         return 0;
 
+    wakeUp();
+
     int HPloss = damage.base;
     if (damage.delta)
         HPloss += rand() * (damage.delta + 1) / RAND_MAX;
@@ -138,11 +147,11 @@ int Being::damage(Actor * /* source */, const Damage &damage)
     if (HPloss > 0)
     {
         mHitsTaken.push_back(HPloss);
-        Attribute &HP = mAttributes.at(ATTR_HP);
+        Attribute &HP = getAttributeRef(ATTR_HP);
         LOG_DEBUG("Being " << getPublicID() << " suffered " << HPloss
                   << " damage. HP: "
                   << HP.getModifiedAttribute() << "/"
-                  << mAttributes.at(ATTR_MAX_HP).getModifiedAttribute());
+                  << getModifiedAttribute(ATTR_MAX_HP));
         setAttribute(ATTR_HP, HP.getBase() - HPloss);
         // No HP regen after being hit if this is set.
         mHealthRegenerationTimeout.setSoft(
@@ -158,8 +167,8 @@ int Being::damage(Actor * /* source */, const Damage &damage)
 
 void Being::heal()
 {
-    Attribute &hp = mAttributes.at(ATTR_HP);
-    Attribute &maxHp = mAttributes.at(ATTR_MAX_HP);
+    Attribute &hp = getAttributeRef(ATTR_HP);
+    Attribute &maxHp = getAttributeRef(ATTR_MAX_HP);
     if (maxHp.getModifiedAttribute() == hp.getModifiedAttribute())
         return; // Full hp, do nothing.
 
@@ -170,8 +179,8 @@ void Being::heal()
 
 void Being::heal(int gain)
 {
-    Attribute &hp = mAttributes.at(ATTR_HP);
-    Attribute &maxHp = mAttributes.at(ATTR_MAX_HP);
+    Attribute &hp = getAttributeRef(ATTR_HP);
+    Attribute &maxHp = getAttributeRef(ATTR_MAX_HP);
     if (maxHp.getModifiedAttribute() == hp.getModifiedAttribute())
         return; // Full hp, do nothing.
 
@@ -258,6 +267,7 @@ void Being::removeAttack(AttackInfo *attackInfo)
 
 void Being::setDestination(const Point &dst)
 {
+    wakeUp();
     mDst = dst;
     raiseUpdateFlags(UPDATEFLAG_NEW_DESTINATION);
     mPath.clear();
@@ -499,6 +509,7 @@ int Being::performAttack(Being *target, const Damage &dmg)
 
 void Being::setAction(BeingAction action)
 {
+    wakeUp();
     mAction = action;
     if (action != ATTACK && // The players are informed about these actions
         action != WALK)     // by other messages
@@ -510,14 +521,17 @@ void Being::setAction(BeingAction action)
 void Being::applyModifier(unsigned attr, double value, unsigned layer,
                           unsigned duration, unsigned id)
 {
-    mAttributes.at(attr).add(duration, value, layer, id);
+    const int expires = duration ? GameState::getCurrentTick() + duration : 0;
+    getAttributeRef(attr).add(expires, value, layer, id);
+    if (expires)
+        scheduleExpiry(expires);
     updateDerivedAttributes(attr);
 }
 
 bool Being::removeModifier(unsigned attr, double value, unsigned layer,
                            unsigned id, bool fullcheck)
 {
-    bool ret = mAttributes.at(attr).remove(value, layer, id, fullcheck);
+    bool ret = getAttributeRef(attr).remove(value, layer, id, fullcheck);
     updateDerivedAttributes(attr);
     return ret;
 }
@@ -529,8 +543,8 @@ void Being::setGender(BeingGender gender)
 
 void Being::setAttribute(unsigned id, double value)
 {
-    AttributeMap::iterator ret = mAttributes.find(id);
-    if (ret == mAttributes.end())
+    Attribute *attribute = findAttribute(id);
+    if (!attribute)
     {
         /*
          * The attribute does not yet exist, so we must attempt to create it.
@@ -542,34 +556,34 @@ void Being::setAttribute(unsigned id, double value)
     }
     else
     {
-        ret->second.setBase(value);
+        attribute->setBase(value);
         updateDerivedAttributes(id);
     }
 }
 
 double Being::getAttribute(unsigned id) const
 {
-    AttributeMap::const_iterator ret = mAttributes.find(id);
-    if (ret == mAttributes.end())
+    const Attribute *attribute = findAttribute(id);
+    if (!attribute)
     {
         LOG_DEBUG("Being::getAttribute: Attribute "
                   << id << " not found! Returning 0.");
         return 0;
     }
-    return ret->second.getBase();
+    return attribute->getBase();
 }
 
 
 double Being::getModifiedAttribute(unsigned id) const
 {
-    AttributeMap::const_iterator ret = mAttributes.find(id);
-    if (ret == mAttributes.end())
+    const Attribute *attribute = findAttribute(id);
+    if (!attribute)
     {
         LOG_DEBUG("Being::getModifiedAttribute: Attribute "
                   << id << " not found! Returning 0.");
         return 0;
     }
-    return ret->second.getModifiedAttribute();
+    return attribute->getModifiedAttribute();
 }
 
 void Being::setModAttribute(unsigned, double)
@@ -583,7 +597,7 @@ void Being::recalculateBaseAttribute(unsigned attr)
 {
     LOG_DEBUG("Being: Received update attribute recalculation request for "
               << attr << ".");
-    if (!mAttributes.count(attr))
+    if (!checkAttributeExists(attr))
     {
         LOG_DEBUG("Being::recalculateBaseAttribute: " << attr << " not found!");
         return;
@@ -619,6 +633,10 @@ void Being::updateDerivedAttributes(unsigned attr)
     case ATTR_MAX_HP:
     case ATTR_HP:
         raiseUpdateFlags(UPDATEFLAG_HEALTHCHANGE);
+        scheduleRegeneration();
+        break;
+    case ATTR_HP_REGEN:
+        scheduleRegeneration();
         break;
     case ATTR_MOVE_SPEED_TPS:
         // Does not make a lot of sense to have in the scripts.
@@ -644,10 +662,13 @@ void Being::applyStatusEffect(int id, int timer)
 
     if (StatusEffect *statusEffect = StatusManager::getStatus(id))
     {
+        wakeUp();
+
         Status newStatus;
         newStatus.status = statusEffect;
-        newStatus.time = timer;
+        newStatus.expires = GameState::getCurrentTick() + timer;
         mStatus[id] = newStatus;
+        scheduleExpiry(newStatus.expires);
     }
     else
     {
@@ -662,37 +683,104 @@ void Being::removeStatusEffect(int id)
 
 bool Being::hasStatusEffect(int id) const
 {
-    StatusEffects::const_iterator it = mStatus.begin();
-    while (it != mStatus.end())
-    {
-        if (it->second.status->getId() == id)
-            return true;
-        it++;
-    }
-    return false;
+    return getStatusEffectTime(id) > 0;
 }
 
 unsigned Being::getStatusEffectTime(int id) const
 {
     StatusEffects::const_iterator it = mStatus.find(id);
-    if (it != mStatus.end()) return it->second.time;
-    else return 0;
+    if (it == mStatus.end())
+        return 0;
+
+    const int remaining = it->second.expires - GameState::getCurrentTick();
+    return remaining > 0 ? remaining : 0;
 }
 
 void Being::setStatusEffectTime(int id, int time)
 {
     StatusEffects::iterator it = mStatus.find(id);
-    if (it != mStatus.end()) it->second.time = time;
+    if (it == mStatus.end())
+        return;
+
+    it->second.expires = GameState::getCurrentTick() + time;
+    scheduleExpiry(it->second.expires);
 }
 
-void Being::update()
+void Being::scheduleExpiry(int tick)
+{
+    if (!mExpiryTimer.isScheduled() || tick < mExpiryTimer.getDue())
+        GameState::getTimerWheel().schedule(&mExpiryTimer, tick);
+}
+
+void Being::expire(int tick)
+{
+    int next = 0;
+
+    for (unsigned i = 0; i < mAttributes.size(); ++i)
+    {
+        if (mAttributes[i].expire(tick))
+            updateDerivedAttributes(mAttributeLayout->ids[i]);
+    }
+
+    // The attribute updates may have added new modifiers
+    for (unsigned i = 0; i < mAttributes.size(); ++i)
+    {
+        const int expires = mAttributes[i].getNextExpiry();
+        if (expires && (!next || expires < next))
+            next = expires;
+    }
+
+    StatusEffects::iterator it = mStatus.begin();
+    while (it != mStatus.end())
+    {
+        if (it->second.expires <= tick)
+        {
+            mStatus.erase(it++);
+            continue;
+        }
+
+        if (!next || it->second.expires < next)
+            next = it->second.expires;
+        ++it;
+    }
+
+    if (next)
+        scheduleExpiry(next);
+}
+
+void Being::scheduleRegeneration()
+{
+    if (mRegenerationTimer.isScheduled())
+        return;
+
+    const int hp = getModifiedAttribute(ATTR_HP);
+    const int maxHp = getModifiedAttribute(ATTR_MAX_HP);
+    int delay = 1;
+
+    if (hp == maxHp)
+        return;
+
+    if (hp < maxHp)
+    {
+        if (mAction == DEAD || getModifiedAttribute(ATTR_HP_REGEN) <= 0)
+            return;
+
+        delay = std::max(1, mHealthRegenerationTimeout.remaining());
+    }
+
+    GameState::getTimerWheel().schedule(&mRegenerationTimer,
+                                        GameState::getCurrentTick() + delay);
+}
+
+void Being::regenerate(int)
 {
     int oldHP = getModifiedAttribute(ATTR_HP);
     int newHP = oldHP;
     int maxHP = getModifiedAttribute(ATTR_MAX_HP);
 
     // Regenerate HP
-    if (mAction != DEAD && mHealthRegenerationTimeout.expired())
+    if (mAction != DEAD && newHP < maxHP &&
+        mHealthRegenerationTimeout.expired())
     {
         mHealthRegenerationTimeout.set(TICKS_PER_HP_REGENERATION);
         newHP += getModifiedAttribute(ATTR_HP_REGEN);
@@ -709,33 +797,22 @@ void Being::update()
         raiseUpdateFlags(UPDATEFLAG_HEALTHCHANGE);
     }
 
-    // Update lifetime of effects.
-    for (AttributeMap::iterator it = mAttributes.begin();
-         it != mAttributes.end();
-         ++it)
-    {
-        if (it->second.tick())
-            updateDerivedAttributes(it->first);
-    }
+    // Wait for the next regeneration or for the timeout to pass
+    scheduleRegeneration();
+}
 
-    // Update and run status effects
-    StatusEffects::iterator it = mStatus.begin();
-    while (it != mStatus.end())
-    {
-        it->second.time--;
-        if (it->second.time > 0 && mAction != DEAD)
-            it->second.status->tick(this, it->second.time);
+void Being::update()
+{
+    // Run the status effects, they are removed by expire()
+    if (mAction == DEAD)
+        mStatus.clear();
 
-        if (it->second.time <= 0 || mAction == DEAD)
-        {
-            StatusEffects::iterator removeIt = it;
-            it++; // bring this iterator to the safety of the next element
-            mStatus.erase(removeIt);
-        }
-        else
-        {
-            it++;
-        }
+    for (StatusEffects::iterator it = mStatus.begin(), it_end = mStatus.end();
+         it != it_end; ++it)
+    {
+        const int remaining = it->second.expires - GameState::getCurrentTick();
+        if (remaining > 0)
+            it->second.status->tick(this, remaining);
     }
 
     // Check if being died
@@ -747,6 +824,23 @@ void Being::update()
     Actor::update();
 }
 
+void Being::fallAsleep()
+{
+    mAsleep = true;
+
+    // Sleeping beings do not move, so they stay in their zone
+    mOld = getPosition();
+}
+
+void Being::wakeUp()
+{
+    if (!mAsleep)
+        return;
+
+    mAsleep = false;
+    getMap()->wakeUp(this);
+}
+
 void Being::inserted(Entity *)
 {
     // Reset the old position, since after insertion it is important that it is
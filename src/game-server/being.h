@@ -21,6 +21,7 @@
 #ifndef BEING_H
 #define BEING_H
 
+#include <cassert>
 #include <string>
 #include <vector>
 #include <list>
@@ -31,17 +32,16 @@
 #include "game-server/attribute.h"
 #include "game-server/attack.h"
 #include "game-server/timeout.h"
+#include "game-server/timerwheel.h"
 
 class Being;
 class MapComposite;
 class StatusEffect;
 
-typedef std::map< unsigned, Attribute > AttributeMap;
-
 struct Status
 {
     StatusEffect *status;
-    unsigned time;  // Number of ticks
+    int expires;    // Tick at which the effect ends
 };
 
 typedef std::map< int, Status > StatusEffects;
@@ -217,7 +217,7 @@ class Being : public Actor
          */
 
         bool checkAttributeExists(unsigned id) const
-        { return mAttributes.count(id); }
+        { return mAttributeLayout->getIndex(id) >= 0; }
 
         /**
          * Adds a modifier to one attribute.
@@ -263,7 +263,8 @@ class Being : public Actor
         bool hasStatusEffect(int id) const;
 
         /**
-         * Returns the time of the status effect if in effect, or 0 if not
+         * Returns the remaining time of the status effect if in effect, or 0
+         * if not
          */
         unsigned getStatusEffectTime(int id) const;
 
@@ -316,6 +317,30 @@ class Being : public Actor
         int getLastEmote() const
         { return mEmoteId; }
 
+        /**
+         * Returns whether the being has nothing to do until a character
+         * comes near or something happens to it.
+         */
+        virtual bool isIdle() const
+        { return false; }
+
+        /**
+         * Returns whether the being is left out of the map updates.
+         */
+        bool isAsleep() const
+        { return mAsleep; }
+
+        /**
+         * Leaves the being out of the map updates until it is woken up.
+         * Called by the map for idle beings without characters around.
+         */
+        void fallAsleep();
+
+        /**
+         * Lets the map update the being again when it was asleep.
+         */
+        void wakeUp();
+
     protected:
         /**
          * Performs an attack
@@ -329,10 +354,45 @@ class Being : public Actor
         void updateDirection(const Point &currentPos,
                              const Point &destPos);
 
+        /**
+         * Creates the attributes of the given scope, replacing the current
+         * ones. Called from the constructor of the subclasses.
+         */
+        void initializeAttributes(ScopeType scope);
+
+        /**
+         * Returns the attribute with the given id, or NULL when the being
+         * does not have it.
+         */
+        Attribute *findAttribute(unsigned id)
+        {
+            const int index = mAttributeLayout->getIndex(id);
+            return index < 0 ? 0 : &mAttributes[index];
+        }
+
+        const Attribute *findAttribute(unsigned id) const
+        {
+            const int index = mAttributeLayout->getIndex(id);
+            return index < 0 ? 0 : &mAttributes[index];
+        }
+
+        /**
+         * Returns the attribute with the given id, which the being must have.
+         */
+        Attribute &getAttributeRef(unsigned id)
+        {
+            Attribute *attribute = findAttribute(id);
+            assert(attribute);
+            return *attribute;
+        }
+
         static const int TICKS_PER_HP_REGENERATION = 100;
 
         BeingAction mAction;
-        AttributeMap mAttributes;
+
+        /** Ids and creation info of the attributes, by index. */
+        const AttributeManager::AttributeLayout *mAttributeLayout;
+        std::vector<Attribute> mAttributes;     /**< By layout index. */
         Attacks mAttacks;
         StatusEffects mStatus;
         Being *mTarget;
@@ -351,6 +411,30 @@ class Being : public Actor
          */
         void inserted(Entity *);
 
+        /**
+         * Schedules the expiry timer at the given tick, unless it is already
+         * due earlier.
+         */
+        void scheduleExpiry(int tick);
+
+        /**
+         * Called by the expiry timer. Removes the modifiers and status
+         * effects that have run out, and schedules the next expiry.
+         */
+        void expire(int tick);
+
+        /**
+         * Schedules the regeneration timer when the hit points are not at
+         * their maximum and there is something to regenerate.
+         */
+        void scheduleRegeneration();
+
+        /**
+         * Called by the regeneration timer. Regenerates hit points once the
+         * regeneration timeout has passed, and caps them at the maximum.
+         */
+        void regenerate(int tick);
+
         Path mPath;
         BeingDirection mDirection;   /**< Facing direction. */
 
@@ -363,6 +447,15 @@ class Being : public Actor
         /** The last being emote Id. Used when triggering a being emoticon. */
         int mEmoteId;
 
+        /** Left out of the map updates until woken up. */
+        bool mAsleep;
+
+        /** Due when the first modifier or status effect runs out. */
+        MemberTimer<Being> mExpiryTimer;
+
+        /** Due when the hit points are to be regenerated or capped. */
+        MemberTimer<Being> mRegenerationTimer;
+
         /** Called when derived attributes need to get calculated */
         static Script::Ref mRecalculateDerivedAttributesCallback;
 
@@ -71,6 +71,7 @@ static bool executeCallback(Script::Ref function, Character *character)
 
 Character::Character(MessageIn &msg):
     Being(OBJECT_CHARACTER),
+    questCacheComplete(false),
     mClient(NULL),
     mConnected(true),
     mTransactionHandler(NULL),
@@ -88,13 +89,7 @@ Character::Character(MessageIn &msg):
     mNpcThread(0),
     mKnuckleAttackInfo(0)
 {
-    const AttributeManager::AttributeScope &attr =
-                           attributeManager->getAttributeScope(CharacterScope);
-    LOG_DEBUG("Character creation: initialisation of "
-              << attr.size() << " attributes.");
-    for (AttributeManager::AttributeScope::const_iterator it1 = attr.begin(),
-         it1_end = attr.end(); it1 != it1_end; ++it1)
-        mAttributes.insert(std::make_pair(it1->first, Attribute(*it1->second)));
+    initializeAttributes(CharacterScope);
 
     setWalkMask(Map::BLOCKMASK_WALL);
     setBlockType(BLOCKTYPE_CHARACTER);
@@ -103,6 +98,16 @@ Character::Character(MessageIn &msg):
     mDatabaseID = msg.readInt32();
     setName(msg.readString());
     deserializeCharacterData(*this, msg);
+
+    // The quest variables are sent along, saving a request for each of them
+    int questVarCount = msg.readInt16();
+    for (int i = 0; i < questVarCount; ++i)
+    {
+        std::string name = msg.readString();
+        questCache[name] = msg.readString();
+    }
+    questCacheComplete = true;
+
     mOld = getPosition();
     Inventory(this).initialize();
     modifiedAllAttribute();
@@ -176,7 +181,9 @@ void Character::update()
     StatusEffects::iterator it = mStatus.begin();
     while (it != mStatus.end())
     {
-        mStatusEffects[it->first] = it->second.time;
+        // Removed effects stay until their expiry runs
+        if (unsigned time = getStatusEffectTime(it->first))
+            mStatusEffects[it->first] = time;
         it++;
     }
 }
@@ -206,7 +213,7 @@ void Character::respawn()
         return;
 
     // No script respawn callback set - fall back to hardcoded logic
-    mAttributes[ATTR_HP].setBase(mAttributes[ATTR_MAX_HP].getModifiedAttribute());
+    getAttributeRef(ATTR_HP).setBase(getModifiedAttribute(ATTR_MAX_HP));
     updateDerivedAttributes(ATTR_HP);
     // Warp back to spawn point.
     int spawnMap = Configuration::getValue("char_respawnMap", 1);
@@ -453,12 +460,10 @@ void Character::sendStatus()
 void Character::modifiedAllAttribute()
 {
     LOG_DEBUG("Marking all attributes as changed, requiring recalculation.");
-    for (AttributeMap::iterator it = mAttributes.begin(),
-         it_end = mAttributes.end();
-        it != it_end; ++it)
+    for (unsigned i = 0; i < mAttributes.size(); ++i)
     {
-        recalculateBaseAttribute(it->first);
-        updateDerivedAttributes(it->first);
+        recalculateBaseAttribute(mAttributeLayout->ids[i]);
+        updateDerivedAttributes(mAttributeLayout->ids[i]);
     }
 }
 
@@ -467,7 +472,7 @@ void Character::recalculateBaseAttribute(unsigned attr)
     // `attr' may or may not have changed. Recalculate the base value.
     LOG_DEBUG("Received update attribute recalculation request at Character "
               "for " << attr << ".");
-    if (!mAttributes.count(attr))
+    if (!checkAttributeExists(attr))
         return;
 
     if (attr == ATTR_STR && mKnuckleAttackInfo)
@@ -683,25 +688,37 @@ void Character::startNpcThread(Script::Thread *thread, int npcId)
 
     mNpcThread = thread;
     mTalkNpcId = npcId;
+    thread->signal_finished.connect(
+            sigc::mem_fun(this, &Character::npcThreadFinished));
 
     resumeNpcThread();
 }
 
 void Character::resumeNpcThread()
 {
-    Script *script = ScriptManager::currentState();
+    Script *script = mNpcThread->mScript;
 
     assert(script->getCurrentThread() == mNpcThread);
 
-    if (script->resume())
+    script->resume();
+}
+
+void Character::npcThreadFinished(Script::Thread *thread)
+{
+    if (thread != mNpcThread)
+        return;
+
+    // The threads of the script states are also ended when the server
+    // shuts down, after the game handler is gone
+    if (gameHandler)
     {
         MessageOut msg(GPMSG_NPC_CLOSE);
         msg.writeInt16(mTalkNpcId);
         gameHandler->sendTo(this, msg);
-
-        mTalkNpcId = 0;
-        mNpcThread = 0;
     }
+
+    mTalkNpcId = 0;
+    mNpcThread = 0;
 }
 
 void Character::addAttack(AttackInfo *attackInfo)
@@ -276,6 +276,12 @@ class Character : public Being
          */
         std::map< std::string, std::string > questCache;
 
+        /**
+         * Whether the quest cache holds all the quest variables of the
+         * character, so that a variable missing from it is known to be empty.
+         */
+        bool questCacheComplete;
+
         /**
          * Gives a skill a specific amount of exp and checks if a levelup
          * occured.
@@ -434,10 +440,25 @@ class Character : public Being
     private:
         bool specialUseCheck(SpecialMap::iterator it);
 
-        double getAttrBase(AttributeMap::const_iterator it) const
-        { return it->second.getBase(); }
-        double getAttrMod(AttributeMap::const_iterator it) const
-        { return it->second.getModifiedAttribute(); }
+        /**
+         * Sends the NPC close message to the player. Connected to the
+         * signal_finished of the NPC thread, which may also finish after
+         * having been resumed by the script scheduler.
+         */
+        void npcThreadFinished(Script::Thread *thread);
+
+        typedef unsigned AttributeIterator;
+
+        AttributeIterator getAttributeBegin() const
+        { return 0; }
+        AttributeIterator getAttributeEnd() const
+        { return mAttributes.size(); }
+        int getAttrId(AttributeIterator index) const
+        { return mAttributeLayout->ids[index]; }
+        double getAttrBase(AttributeIterator index) const
+        { return mAttributes[index].getBase(); }
+        double getAttrMod(AttributeIterator index) const
+        { return mAttributes[index].getModifiedAttribute(); }
 
         Character(const Character &);
         Character &operator=(const Character &);
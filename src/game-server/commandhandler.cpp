@@ -25,6 +25,7 @@
 #include "game-server/character.h"
 #include "game-server/effect.h"
 #include "game-server/gamehandler.h"
+#include "game-server/hotreload.h"
 #include "game-server/inventory.h"
 #include "game-server/item.h"
 #include "game-server/itemmanager.h"
@@ -34,13 +35,19 @@
 #include "game-server/monstermanager.h"
 #include "game-server/specialmanager.h"
 #include "game-server/state.h"
+#include "game-server/tickprofiler.h"
+#include "game-server/tickscheduler.h"
 
+#include "scripting/luaallocator.h"
+#include "scripting/script.h"
 #include "scripting/scriptmanager.h"
+#include "scripting/scriptscheduler.h"
 
 #include "common/configuration.h"
 #include "common/permissionmanager.h"
 #include "common/transaction.h"
 
+#include "utils/percentiles.h"
 #include "utils/string.h"
 
 struct CmdRef
@@ -86,6 +93,8 @@ static void handleGiveSpecial(Character*, std::string&);
 static void handleTakeSpecial(Character*, std::string&);
 static void handleRechargeSpecial(Character*, std::string&);
 static void handleListSpecials(Character*, std::string&);
+static void handleProfile(Character*, std::string&);
+static void handleScriptMemory(Character*, std::string&);
 
 static CmdRef const cmdRef[] =
 {
@@ -167,6 +176,13 @@ static CmdRef const cmdRef[] =
         "<setname>_<specialname>", &handleRechargeSpecial},
     {"listspecials", "<character>",
         "Lists the specials of the character.", &handleListSpecials},
+    {"profile", "[map]",
+        "Shows how long the phases of the world tick took over the last "
+        "minute, for the whole server or for the given map (# for the "
+        "current one)", &handleProfile},
+    {"scriptmem", "",
+        "Shows the memory used by the scripts and the number of script "
+        "threads", &handleScriptMemory},
     {NULL, NULL, NULL, NULL}
 
 };
@@ -811,11 +827,11 @@ static void handleRecall(Character *player, std::string &args)
     GameState::warp(other, map, pos.x, pos.y);
 }
 
-static void handleReload(Character *, std::string &)
+static void handleReload(Character *player, std::string &)
 {
-    // reload the items and monsters
-    itemManager->reload();
-    monsterManager->reload();
+    // Swapped in between two ticks, the definitions are still in use now
+    HotReload::requestReload(HotReload::DB_ALL);
+    say("Reloading the databases.", player);
 }
 
 static void handleBan(Character *player, std::string &args)
@@ -1698,6 +1714,90 @@ static void handleListSpecials(Character *player, std::string &args)
     }
 }
 
+static void handleProfile(Character *player, std::string &args)
+{
+    std::string mapstr = getArgument(args);
+    int mapId = 0;
+
+    if (mapstr == "#")
+    {
+        mapId = player->getMap()->getID();
+    }
+    else if (!mapstr.empty())
+    {
+        MapComposite *map = utils::isNumeric(mapstr) ?
+                MapManager::getMap(utils::stringToInt(mapstr)) :
+                MapManager::getMap(mapstr);
+        if (!map)
+        {
+            say("Invalid map", player);
+            return;
+        }
+        mapId = map->getID();
+    }
+
+    say(mapId ? "Tick phases of map " + utils::toString(mapId) +
+                " (p50/p99/max in microseconds):"
+              : "Tick phases (p50/p99/max in microseconds):", player);
+
+    for (int i = 0; i < TickProfiler::PHASE_COUNT; ++i)
+    {
+        TickProfiler::Phase phase = static_cast<TickProfiler::Phase>(i);
+        const utils::RollingPercentiles *times =
+                TickProfiler::getTimes(phase, mapId);
+        if (!times || times->size() == 0)
+            continue;
+
+        std::stringstream str;
+        str << TickProfiler::getPhaseName(phase) << ": "
+            << times->percentile(50) << " / " << times->percentile(99)
+            << " / " << times->max();
+        say(str.str(), player);
+    }
+
+    if (!mapId)
+    {
+        double time, monsters;
+        TickProfiler::getMonsterUpdateAverages(time, monsters);
+        std::stringstream str;
+        str << "Monster update callbacks: " << time << " us per call, "
+            << monsters << " monsters per call";
+        say(str.str(), player);
+        say("Scheduler " + TickScheduler::summary(), player);
+    }
+}
+
+static void handleScriptMemory(Character *player, std::string &)
+{
+    Script *script = ScriptManager::currentState();
+
+    std::stringstream str;
+    str << "Script memory: " << script->getMemoryUsage() / 1024
+        << " KB, peak: " << script->getPeakMemoryUsage() / 1024
+        << " KB, threads: " << script->getThreadCount()
+        << ", waiting: " << script->getScheduler()->getWaitingCount();
+    say(str.str(), player);
+
+    str.str(std::string());
+    str << "Lua pool: " << LuaAllocator::getPoolSize() / 1024
+        << " KB reserved, " << LuaAllocator::getPoolFree() / 1024
+        << " KB free";
+    say(str.str(), player);
+
+    const std::vector<Script *> &states = ScriptManager::getStates();
+    if (states.size() > 1)
+    {
+        size_t mapMemory = 0;
+        for (size_t i = 1; i < states.size(); ++i)
+            mapMemory += states[i]->getMemoryUsage();
+
+        str.str(std::string());
+        str << "Map states: " << states.size() - 1 << ", using "
+            << mapMemory / 1024 << " KB";
+        say(str.str(), player);
+    }
+}
+
 void CommandHandler::handleCommand(Character *player,
                                    const std::string &command)
 {
@@ -0,0 +1,407 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "game-server/compiledmap.h"
+
+#include "game-server/map.h"
+#include "utils/logger.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+ * The file starts with the magic and version, followed by:
+ *
+ *   u64 size, u64 mtime       stamp of the XML map file
+ *   u32 width, height         in tiles
+ *   u32 tile width, height    in pixels
+ *   u8[]                      walls, one bit per tile, row by row
+ *   u32 count, string pairs   map properties
+ *   u32 count, objects        name, type, x, y, width, height, then a
+ *                             u32 count of string pairs as properties
+ *
+ * Numbers are little endian and strings are a u32 length followed by the
+ * characters. The version is to be raised on any change to the layout.
+ */
+static const char MAGIC[4] = { 'M', 'S', 'C', 'M' };
+static const uint32_t VERSION = 1;
+
+/** Maps are refused beyond this size, as a guard against corrupt files. */
+static const uint32_t MAX_TILES = 1 << 24;
+
+/**
+ * Read-only view of a whole file, memory-mapped where possible.
+ */
+class MappedFile
+{
+    public:
+        MappedFile(const std::string &path);
+        ~MappedFile();
+
+        const unsigned char *data() const { return mData; }
+        size_t size() const { return mSize; }
+
+    private:
+        MappedFile(const MappedFile &);
+        MappedFile &operator=(const MappedFile &);
+
+        const unsigned char *mData;
+        size_t mSize;
+#ifdef _WIN32
+        std::string mBuffer;
+#endif
+};
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path):
+    mData(0),
+    mSize(0)
+{
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+        return;
+
+    mBuffer.assign(std::istreambuf_iterator<char>(file),
+                   std::istreambuf_iterator<char>());
+    mData = reinterpret_cast<const unsigned char*>(mBuffer.data());
+    mSize = mBuffer.size();
+}
+
+MappedFile::~MappedFile()
+{
+}
+#else
+MappedFile::MappedFile(const std::string &path):
+    mData(0),
+    mSize(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        void *data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            mData = static_cast<const unsigned char*>(data);
+            mSize = info.st_size;
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (mData)
+        munmap(const_cast<unsigned char*>(mData), mSize);
+}
+#endif
+
+/**
+ * Bounds checked decoding of the mapped file. Once a read runs past the
+ * end, all further reads return zeros and good() returns false.
+ */
+class Reader
+{
+    public:
+        Reader(const unsigned char *data, size_t size):
+            mData(data),
+            mSize(size),
+            mPos(0),
+            mGood(true)
+        {}
+
+        bool good() const { return mGood; }
+        bool atEnd() const { return mPos == mSize; }
+
+        const unsigned char *skip(size_t length)
+        {
+            if (!mGood || length > mSize - mPos)
+            {
+                mGood = false;
+                return 0;
+            }
+            const unsigned char *p = mData + mPos;
+            mPos += length;
+            return p;
+        }
+
+        uint32_t readU32()
+        {
+            const unsigned char *p = skip(4);
+            if (!p)
+                return 0;
+            return p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+        }
+
+        uint64_t readU64()
+        {
+            uint64_t low = readU32();
+            return low | (uint64_t(readU32()) << 32);
+        }
+
+        std::string readString()
+        {
+            uint32_t length = readU32();
+            const unsigned char *p = skip(length);
+            if (!p)
+                return std::string();
+            return std::string(reinterpret_cast<const char*>(p), length);
+        }
+
+    private:
+        const unsigned char *mData;
+        size_t mSize;
+        size_t mPos;
+        bool mGood;
+};
+
+static void writeU32(std::string &out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        out += char((value >> (8 * i)) & 0xff);
+}
+
+static void writeU64(std::string &out, uint64_t value)
+{
+    writeU32(out, uint32_t(value));
+    writeU32(out, uint32_t(value >> 32));
+}
+
+static void writeString(std::string &out, const std::string &value)
+{
+    writeU32(out, value.size());
+    out += value;
+}
+
+bool CompiledMap::getStamp(const std::string &path, SourceStamp &stamp)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+
+    stamp.size = info.st_size;
+    stamp.modified = info.st_mtime;
+    return true;
+}
+
+std::string CompiledMap::getPath(const std::string &tmxPath)
+{
+    std::string::size_type dot = tmxPath.rfind('.');
+    std::string::size_type slash = tmxPath.find_last_of("/\\");
+    if (dot == std::string::npos ||
+            (slash != std::string::npos && dot < slash))
+        return tmxPath + ".cmap";
+
+    return tmxPath.substr(0, dot) + ".cmap";
+}
+
+Map *CompiledMap::read(const std::string &path, const SourceStamp &stamp)
+{
+    MappedFile file(path);
+    if (!file.data())
+        return 0;
+
+    Reader reader(file.data(), file.size());
+    const unsigned char *magic = reader.skip(sizeof(MAGIC));
+    if (!magic || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            reader.readU32() != VERSION)
+    {
+        LOG_WARN("Ignoring compiled map " << path << " of another version.");
+        return 0;
+    }
+
+    const uint64_t size = reader.readU64();
+    const uint64_t modified = reader.readU64();
+    if (size != stamp.size || modified != stamp.modified)
+    {
+        LOG_INFO("Ignoring outdated compiled map " << path << ".");
+        return 0;
+    }
+
+    const uint32_t width = reader.readU32();
+    const uint32_t height = reader.readU32();
+    const uint32_t tileWidth = reader.readU32();
+    const uint32_t tileHeight = reader.readU32();
+    if (!reader.good() || width == 0 || height == 0 ||
+            width > MAX_TILES / height || tileWidth == 0 || tileHeight == 0)
+    {
+        LOG_ERROR("Corrupt compiled map " << path << ".");
+        return 0;
+    }
+
+    const unsigned char *walls = reader.skip((width * height + 7) / 8);
+    if (!walls)
+    {
+        LOG_ERROR("Corrupt compiled map " << path << ".");
+        return 0;
+    }
+
+    Map *map = new Map(width, height, tileWidth, tileHeight);
+
+    for (uint32_t y = 0, i = 0; y < height; ++y)
+    {
+        for (uint32_t x = 0; x < width; ++x, ++i)
+        {
+            if (walls[i / 8] & (1 << (i % 8)))
+                map->blockTile(x, y, BLOCKTYPE_WALL);
+        }
+    }
+
+    for (uint32_t count = reader.readU32(); count && reader.good(); --count)
+    {
+        const std::string key = reader.readString();
+        const std::string value = reader.readString();
+        map->setProperty(key, value);
+    }
+
+    for (uint32_t count = reader.readU32(); count && reader.good(); --count)
+    {
+        const std::string name = reader.readString();
+        const std::string type = reader.readString();
+        Rectangle rect;
+        rect.x = int32_t(reader.readU32());
+        rect.y = int32_t(reader.readU32());
+        rect.w = int32_t(reader.readU32());
+        rect.h = int32_t(reader.readU32());
+
+        MapObject *object = new MapObject(rect, name, type);
+        for (uint32_t properties = reader.readU32();
+             properties && reader.good(); --properties)
+        {
+            const std::string key = reader.readString();
+            const std::string value = reader.readString();
+            object->addProperty(key, value);
+        }
+        map->addObject(object);
+    }
+
+    if (!reader.good() || !reader.atEnd())
+    {
+        LOG_ERROR("Corrupt compiled map " << path << ".");
+        delete map;
+        return 0;
+    }
+
+    return map;
+}
+
+bool CompiledMap::write(const Map *map, const std::string &path,
+                        const SourceStamp &stamp)
+{
+    const int width = map->getWidth();
+    const int height = map->getHeight();
+
+    std::string out(MAGIC, sizeof(MAGIC));
+    writeU32(out, VERSION);
+    writeU64(out, stamp.size);
+    writeU64(out, stamp.modified);
+    writeU32(out, width);
+    writeU32(out, height);
+    writeU32(out, map->getTileWidth());
+    writeU32(out, map->getTileHeight());
+
+    std::string walls((width * height + 7) / 8, '\0');
+    for (int y = 0, i = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x, ++i)
+        {
+            if (!map->getWalk(x, y, Map::BLOCKMASK_WALL))
+                walls[i / 8] |= char(1 << (i % 8));
+        }
+    }
+    out += walls;
+
+    typedef std::map<std::string, std::string> Properties;
+    const Properties &properties = map->getProperties();
+    writeU32(out, properties.size());
+    for (Properties::const_iterator it = properties.begin(),
+         it_end = properties.end(); it != it_end; ++it)
+    {
+        writeString(out, it->first);
+        writeString(out, it->second);
+    }
+
+    const std::vector<MapObject*> &objects = map->getObjects();
+    writeU32(out, objects.size());
+    for (std::vector<MapObject*>::const_iterator it = objects.begin(),
+         it_end = objects.end(); it != it_end; ++it)
+    {
+        const MapObject *object = *it;
+        const Rectangle &bounds = object->getBounds();
+        writeString(out, object->getName());
+        writeString(out, object->getType());
+        writeU32(out, bounds.x);
+        writeU32(out, bounds.y);
+        writeU32(out, bounds.w);
+        writeU32(out, bounds.h);
+
+        typedef utils::NameMap<std::string> ObjectProperties;
+        const ObjectProperties &objectProperties = object->getProperties();
+        uint32_t count = 0;
+        for (ObjectProperties::const_iterator i = objectProperties.begin(),
+             i_end = objectProperties.end(); i != i_end; ++i)
+            ++count;
+
+        writeU32(out, count);
+        for (ObjectProperties::const_iterator i = objectProperties.begin(),
+             i_end = objectProperties.end(); i != i_end; ++i)
+        {
+            writeString(out, i->first);
+            writeString(out, i->second);
+        }
+    }
+
+    // Write under a temporary name first, so that a compiler that is
+    // stopped halfway does not leave a truncated map behind.
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary.c_str(),
+                           std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.write(out.data(), out.size()))
+        {
+            LOG_ERROR("Could not write compiled map " << temporary);
+            return false;
+        }
+    }
+
+    std::remove(path.c_str());
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        LOG_ERROR("Could not write compiled map " << path);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
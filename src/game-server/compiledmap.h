@@ -0,0 +1,78 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef COMPILEDMAP_H
+#define COMPILEDMAP_H
+
+#include <stdint.h>
+#include <string>
+
+class Map;
+
+/**
+ * Binary form of a map, written next to its XML map file by
+ * manaserv-mapcompiler. It holds only what the server uses from the map:
+ * the tile dimensions, the walls, the map properties and the objects.
+ *
+ * Loading a compiled map memory-maps it and copies the walls straight into
+ * the map, without parsing XML or inflating layers. The compiled map records
+ * the size and modification time of the XML map file it was made from, and
+ * is ignored once those no longer match.
+ */
+namespace CompiledMap
+{
+    /**
+     * Identifies the version of the XML map file a compiled map was made
+     * from.
+     */
+    struct SourceStamp
+    {
+        uint64_t size;
+        uint64_t modified;
+    };
+
+    /**
+     * Gets the stamp of the file at the given path.
+     * @return whether the file exists.
+     */
+    bool getStamp(const std::string &path, SourceStamp &stamp);
+
+    /**
+     * Returns the path of the compiled map of the given XML map file.
+     */
+    std::string getPath(const std::string &tmxPath);
+
+    /**
+     * Reads a compiled map.
+     * @return the map, or 0 when the file is missing, corrupt or not made
+     *         from the XML map file with the given stamp.
+     */
+    Map *read(const std::string &path, const SourceStamp &stamp);
+
+    /**
+     * Writes a compiled map of the given map.
+     * @return whether the file was written.
+     */
+    bool write(const Map *map, const std::string &path,
+               const SourceStamp &stamp);
+}
+
+#endif // COMPILEDMAP_H
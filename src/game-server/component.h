@@ -34,6 +34,15 @@ enum ComponentType
     ComponentTypeCount
 };
 
+/**
+ * Returns whether the components of the given type are updated by their map,
+ * in one loop for the whole type, rather than by their entity.
+ */
+inline bool isPooledComponent(ComponentType type)
+{
+    return type == CT_SpawnArea || type == CT_TriggerArea;
+}
+
 /**
  * A component of an entity.
  */
@@ -0,0 +1,94 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef COMPONENTPOOL_H
+#define COMPONENTPOOL_H
+
+#include "game-server/entity.h"
+
+#include <vector>
+
+/**
+ * The components of one type on a map, kept in a dense array and updated
+ * in one loop instead of through every entity.
+ *
+ * The components stay owned by their entity, since they may hand out
+ * their address, for example to signals.
+ */
+template <class T>
+class ComponentPool
+{
+    public:
+        /**
+         * Adds the component of the given entity, when it has one.
+         */
+        void add(Entity *entity)
+        {
+            if (T *component = entity->getComponent<T>())
+            {
+                mComponents.push_back(component);
+                mEntities.push_back(entity);
+            }
+        }
+
+        /**
+         * Removes the component of the given entity, when it has one. The
+         * last component takes its place.
+         */
+        void remove(Entity *entity)
+        {
+            for (unsigned i = 0; i < mEntities.size(); ++i)
+            {
+                if (mEntities[i] != entity)
+                    continue;
+
+                mComponents[i] = mComponents.back();
+                mEntities[i] = mEntities.back();
+                mComponents.pop_back();
+                mEntities.pop_back();
+                return;
+            }
+        }
+
+        /**
+         * Updates all the components. The components added meanwhile are
+         * updated as well.
+         */
+        void update()
+        {
+            // Call the update of the component type directly, without going
+            // through the virtual call
+            for (unsigned i = 0; i < mComponents.size(); ++i)
+                mComponents[i]->T::update(*mEntities[i]);
+        }
+
+        unsigned size() const
+        { return mComponents.size(); }
+
+        T *get(unsigned index) const
+        { return mComponents[index]; }
+
+    private:
+        std::vector<T *> mComponents;
+        std::vector<Entity *> mEntities;    /**< Owner of every component. */
+};
+
+#endif // COMPONENTPOOL_H
@@ -36,11 +36,12 @@ Entity::~Entity()
 }
 
 /**
- * Updates the internal status. By default, calls update on all its components.
+ * Updates the internal status. By default, calls update on all its components
+ * that are not updated by the map.
  */
 void Entity::update()
 {
     for (int i = 0; i < ComponentTypeCount; ++i)
-        if (mComponents[i])
+        if (mComponents[i] && !isPooledComponent(ComponentType(i)))
             mComponents[i]->update(*this);
 }
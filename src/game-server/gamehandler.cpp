@@ -132,52 +132,21 @@ void GameHandler::updateCharacter(int charid, int partyid)
     }
 }
 
-static Actor *findActorNear(Actor *p, int id)
-{
-    MapComposite *map = p->getMap();
-    const Point &ppos = p->getPosition();
-    // See map.h for tiles constants
-    const int pixelDist = DEFAULT_TILE_LENGTH * TILES_TO_BE_NEAR;
-    for (ActorIterator i(map->getAroundPointIterator(ppos, pixelDist)); i; ++i)
-    {
-        Actor *a = *i;
-        if (a->getPublicID() != id)
-            continue;
-        return ppos.inRangeOf(a->getPosition(), pixelDist) ? a : 0;
-    }
-    return 0;
-}
-
 static Being *findBeingNear(Actor *p, int id)
 {
-    MapComposite *map = p->getMap();
-    const Point &ppos = p->getPosition();
+    Being *b = p->getMap()->getBeing(id);
     // See map.h for tiles constants
     const int pixelDist = DEFAULT_TILE_LENGTH * TILES_TO_BE_NEAR;
-    for (BeingIterator i(map->getAroundPointIterator(ppos, pixelDist)); i; ++i)
-    {
-        Being *b = *i;
-        if (b->getPublicID() != id)
-            continue;
-        return ppos.inRangeOf(b->getPosition(), pixelDist) ? b : 0;
-    }
+    if (b && p->getPosition().inRangeOf(b->getPosition(), pixelDist))
+        return b;
     return 0;
 }
 
 static Character *findCharacterNear(Actor *p, int id)
 {
-    MapComposite *map = p->getMap();
-    const Point &ppos = p->getPosition();
-    // See map.h for tiles constants
-    const int pixelDist = DEFAULT_TILE_LENGTH * TILES_TO_BE_NEAR;
-    for (CharacterIterator i(map->getAroundPointIterator(ppos,
-                                                         pixelDist)); i; ++i)
-    {
-        Character *c = *i;
-        if (c->getPublicID() != id)
-            continue;
-        return ppos.inRangeOf(c->getPosition(), pixelDist) ? c : 0;
-    }
+    Being *b = findBeingNear(p, id);
+    if (b && b->getType() == OBJECT_CHARACTER)
+        return static_cast< Character * >(b);
     return 0;
 }
 
@@ -191,6 +160,17 @@ void GameHandler::processMessage(NetComputer *computer, MessageIn &message)
             return;
 
         std::string magic_token = message.readString(MAGIC_TOKEN_LENGTH);
+
+        // Older clients do not send encoding flags
+        if (message.getUnreadLength() > 0)
+        {
+            client.encoding = message.readInt8() &
+                    (ENCODING_COMPACT | ENCODING_COMPRESSED);
+        }
+
+        if (client.encoding & ENCODING_COMPRESSED)
+            client.enableCompression(false);
+
         client.status = CLIENT_QUEUED; // Before the addPendingClient
         mTokenCollector.addPendingClient(magic_token, &client);
         return;
@@ -363,6 +343,7 @@ void GameHandler::tokenMatched(GameClient *computer, Character *character)
 {
     computer->character = character;
     computer->status = CLIENT_CONNECTED;
+    computer->sentPositions.clear();
 
     character->setClient(computer);
 
@@ -380,6 +361,7 @@ void GameHandler::tokenMatched(GameClient *computer, Character *character)
     character->triggerLoginCallback();
 
     result.writeInt8(ERRMSG_OK);
+    result.writeInt8(computer->encoding);
     computer->send(result);
 
     // Force sending the whole character to the client.
@@ -446,15 +428,13 @@ void GameHandler::handleSay(GameClient &client, MessageIn &message)
 void GameHandler::handleNpc(GameClient &client, MessageIn &message)
 {
     int id = message.readInt16();
-    Actor *actor = findActorNear(client.character, id);
-    if (!actor || actor->getType() != OBJECT_NPC)
+    Being *npc = findBeingNear(client.character, id);
+    if (!npc || npc->getType() != OBJECT_NPC)
     {
         sendNpcError(client, id, "Not close enough to NPC\n");
         return;
     }
 
-    Being *npc = static_cast<Being*>(actor);
-
     switch (message.getId())
     {
         case PGMSG_NPC_SELECT:
@@ -26,6 +26,8 @@
 #include "net/netcomputer.h"
 #include "utils/tokencollector.h"
 
+#include <map>
+
 enum
 {
     CLIENT_LOGIN = 0,
@@ -37,9 +39,17 @@ enum
 struct GameClient: NetComputer
 {
     GameClient(ENetPeer *peer)
-      : NetComputer(peer), character(NULL), status(CLIENT_LOGIN) {}
+      : NetComputer(peer), character(NULL), status(CLIENT_LOGIN),
+        encoding(0) {}
     Character *character;
     int status;
+    int encoding;   /**< Negotiated ENCODING_* flags. */
+
+    /**
+     * Last coordinates sent to this client for each visible being, used as
+     * reference for position deltas in compact encoding.
+     */
+    std::map< int, Point > sentPositions;
 };
 
 /**
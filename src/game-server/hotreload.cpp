@@ -0,0 +1,570 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "game-server/hotreload.h"
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "common/resourcemanager.h"
+#include "game-server/attributemanager.h"
+#include "game-server/itemmanager.h"
+#include "game-server/monstermanager.h"
+#include "game-server/specialmanager.h"
+#include "game-server/statusmanager.h"
+#include "scripting/script.h"
+#include "scripting/scriptmanager.h"
+#include "utils/logger.h"
+#include "utils/threadpool.h"
+#include "utils/timer.h"
+#include "utils/xml.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Time without further changes before the changed files are reloaded, in
+ * microseconds. Editors tend to write a file in several steps.
+ */
+static const uint64_t RELOAD_DELAY = 500 * 1000;
+
+static unsigned pendingDatabases;
+static std::set<std::string> pendingScripts;
+static uint64_t lastChange;
+
+/**
+ * Parses a database file away from the tick thread.
+ */
+class ParseJob : public utils::Job
+{
+    public:
+        ParseJob(const std::string &file):
+            mFile(file),
+            mDocument(0)
+        {}
+
+        ~ParseJob()
+        { delete mDocument; }
+
+        void run()
+        { mDocument = new XML::Document(mFile); }
+
+        const std::string &getFile() const
+        { return mFile; }
+
+        xmlNodePtr getRootNode()
+        { return mDocument->rootNode(); }
+
+    private:
+        std::string mFile;
+        XML::Document *mDocument;
+};
+
+/**
+ * Compiles a script file away from the tick thread.
+ */
+class CompileJob : public utils::Job
+{
+    public:
+        CompileJob(const Script *script, const std::string &file):
+            mScript(script),
+            mFile(file),
+            mCompiled(false)
+        {}
+
+        void run()
+        { mCompiled = mScript->compileFile(mFile, mChunk); }
+
+        const std::string &getFile() const
+        { return mFile; }
+
+        /**
+         * Returns the compiled chunk, or NULL when the file could not be
+         * compiled.
+         */
+        const std::string *getChunk() const
+        { return mCompiled ? &mChunk : 0; }
+
+    private:
+        const Script *mScript;
+        std::string mFile;
+        std::string mChunk;
+        bool mCompiled;
+};
+
+/** Created on the first reload. */
+static utils::ThreadPool *parsePool;
+
+/** The reload in progress, waiting for its files to be parsed. */
+static std::vector<ParseJob *> parseJobs;
+static std::vector<CompileJob *> compileJobs;
+static unsigned reloadingDatabases;
+static uint64_t reloadStart;
+
+/** Definitions that were replaced, which entities may still refer to. */
+static std::vector<AttributeManager *> retiredAttributes;
+static std::vector<ItemManager *> retiredItems;
+static std::vector<MonsterManager *> retiredMonsters;
+static std::vector<SpecialManager *> retiredSpecials;
+
+#ifdef __linux__
+static int inotifyFd = -1;
+
+/** Path in the search path of the directory of every watch. */
+static std::map<int, std::string> watchPrefixes;
+
+static void addWatch(const std::string &directory, const std::string &prefix)
+{
+    const int wd = inotify_add_watch(inotifyFd, directory.c_str(),
+                                     IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0)
+    {
+        LOG_WARN("Hot reload: Could not watch " << directory);
+        return;
+    }
+
+    watchPrefixes[wd] = prefix;
+}
+
+/**
+ * Watches a directory and all the directories below it, since inotify
+ * watches are not recursive.
+ */
+static void addWatchRecursive(const std::string &directory,
+                              const std::string &prefix)
+{
+    addWatch(directory, prefix);
+
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        return;
+
+    while (struct dirent *entry = readdir(dir))
+    {
+        const std::string name = entry->d_name;
+        if (name.empty() || name[0] == '.')
+            continue;
+
+        const std::string path = directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+            addWatchRecursive(path, prefix + name + "/");
+    }
+    closedir(dir);
+}
+
+/**
+ * Returns the directory of the given file in the search path.
+ */
+static std::string realDirectory(const std::string &file)
+{
+    const std::string path = ResourceManager::resolve(file);
+    return path.substr(0, path.find_last_of('/'));
+}
+#endif // __linux__
+
+static unsigned databaseOf(const std::string &file)
+{
+    if (file == DEFAULT_ATTRIBUTEDB_FILE)
+        return HotReload::DB_ATTRIBUTES;
+    if (file == DEFAULT_ITEMSDB_FILE || file == DEFAULT_EQUIPDB_FILE)
+        return HotReload::DB_ITEMS;
+    if (file == DEFAULT_MONSTERSDB_FILE)
+        return HotReload::DB_MONSTERS;
+    if (file == DEFAULT_STATUSDB_FILE)
+        return HotReload::DB_STATUS;
+    if (file == DEFAULT_SPECIALSDB_FILE)
+        return HotReload::DB_SPECIALS;
+    return 0;
+}
+
+static void fileChanged(const std::string &file)
+{
+    const std::string luaExtension = ".lua";
+
+    if (unsigned database = databaseOf(file))
+        pendingDatabases |= database;
+    else if (file.size() > luaExtension.size() &&
+             file.compare(file.size() - luaExtension.size(),
+                          luaExtension.size(), luaExtension) == 0)
+        pendingScripts.insert(file);
+    else
+        return;
+
+    LOG_DEBUG("Hot reload: " << file << " changed");
+    lastChange = utils::getTimeInMicrosec();
+}
+
+static void pollChanges()
+{
+#ifdef __linux__
+    if (inotifyFd < 0)
+        return;
+
+    char buffer[4096]
+            __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+    for (;;)
+    {
+        const ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            if (length < 0 && errno != EAGAIN)
+                LOG_WARN("Hot reload: Could not read the file changes");
+            return;
+        }
+
+        for (char *p = buffer; p < buffer + length;)
+        {
+            const struct inotify_event *event =
+                    reinterpret_cast<const struct inotify_event *>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            std::map<int, std::string>::const_iterator it =
+                    watchPrefixes.find(event->wd);
+            if (it != watchPrefixes.end() && event->len)
+                fileChanged(it->second + event->name);
+        }
+    }
+#endif
+}
+
+typedef std::map<std::string, xmlNodePtr> RootNodes;
+
+/**
+ * Returns the root node of the parsed database file, or NULL when it could
+ * not be parsed, so that a file that is being edited does not replace
+ * working definitions with nothing.
+ */
+static xmlNodePtr validRootNode(const RootNodes &rootNodes,
+                                const std::string &file)
+{
+    RootNodes::const_iterator it = rootNodes.find(file);
+    if (it != rootNodes.end() && it->second)
+        return it->second;
+
+    LOG_ERROR("Hot reload: Keeping the current definitions of " << file);
+    return 0;
+}
+
+/**
+ * Adds the databases that refer to the given ones.
+ */
+static unsigned withDependents(unsigned databases)
+{
+    // The items refer to attributes, and the monsters to both
+    if (databases & HotReload::DB_ATTRIBUTES)
+        databases |= HotReload::DB_ITEMS | HotReload::DB_MONSTERS;
+    if (databases & HotReload::DB_ITEMS)
+        databases |= HotReload::DB_MONSTERS;
+    return databases;
+}
+
+static void addFilesOf(unsigned databases, std::vector<std::string> &files)
+{
+    if (databases & HotReload::DB_ATTRIBUTES)
+        files.push_back(DEFAULT_ATTRIBUTEDB_FILE);
+    if (databases & HotReload::DB_ITEMS)
+    {
+        files.push_back(DEFAULT_ITEMSDB_FILE);
+        files.push_back(DEFAULT_EQUIPDB_FILE);
+    }
+    if (databases & HotReload::DB_MONSTERS)
+        files.push_back(DEFAULT_MONSTERSDB_FILE);
+    if (databases & HotReload::DB_STATUS)
+        files.push_back(DEFAULT_STATUSDB_FILE);
+    if (databases & HotReload::DB_SPECIALS)
+        files.push_back(DEFAULT_SPECIALSDB_FILE);
+}
+
+static void reloadDatabases(unsigned databases, const RootNodes &rootNodes)
+{
+    if (databases & HotReload::DB_ATTRIBUTES)
+    {
+        if (xmlNodePtr rootNode = validRootNode(rootNodes,
+                                                DEFAULT_ATTRIBUTEDB_FILE))
+        {
+            AttributeManager *attributes =
+                    new AttributeManager(DEFAULT_ATTRIBUTEDB_FILE);
+            attributes->initialize(rootNode);
+            retiredAttributes.push_back(attributeManager);
+            attributeManager = attributes;
+        }
+    }
+
+    if (databases & HotReload::DB_ITEMS)
+    {
+        xmlNodePtr itemsRootNode = validRootNode(rootNodes,
+                                                 DEFAULT_ITEMSDB_FILE);
+        xmlNodePtr equipRootNode = validRootNode(rootNodes,
+                                                 DEFAULT_EQUIPDB_FILE);
+        if (itemsRootNode && equipRootNode)
+        {
+            ItemManager *items = new ItemManager(DEFAULT_ITEMSDB_FILE,
+                                                 DEFAULT_EQUIPDB_FILE);
+            items->initialize(itemsRootNode, equipRootNode);
+            items->copyCallbacks(*itemManager);
+            retiredItems.push_back(itemManager);
+            itemManager = items;
+        }
+    }
+
+    if (databases & HotReload::DB_MONSTERS)
+    {
+        if (xmlNodePtr rootNode = validRootNode(rootNodes,
+                                                DEFAULT_MONSTERSDB_FILE))
+        {
+            MonsterManager *monsters =
+                    new MonsterManager(DEFAULT_MONSTERSDB_FILE);
+            monsters->initialize(rootNode);
+            monsters->copyCallbacks(*monsterManager);
+            retiredMonsters.push_back(monsterManager);
+            monsterManager = monsters;
+        }
+    }
+
+    // Status effects are reloaded in place
+    if (databases & HotReload::DB_STATUS)
+    {
+        if (xmlNodePtr rootNode = validRootNode(rootNodes,
+                                                DEFAULT_STATUSDB_FILE))
+            StatusManager::reload(rootNode);
+    }
+
+    if (databases & HotReload::DB_SPECIALS)
+    {
+        if (xmlNodePtr rootNode = validRootNode(rootNodes,
+                                                DEFAULT_SPECIALSDB_FILE))
+        {
+            SpecialManager *specials =
+                    new SpecialManager(DEFAULT_SPECIALSDB_FILE);
+            specials->initialize(rootNode);
+            specials->copyCallbacks(*specialManager);
+            retiredSpecials.push_back(specialManager);
+            specialManager = specials;
+        }
+    }
+}
+
+static void reloadScripts(const std::vector<CompileJob *> &jobs)
+{
+    Script *script = ScriptManager::currentState();
+
+    for (std::vector<CompileJob *>::const_iterator it = jobs.begin(),
+         it_end = jobs.end(); it != it_end; ++it)
+    {
+        const std::string &file = (*it)->getFile();
+        LOG_INFO("Hot reload: Reloading script " << file);
+
+        // Loading the source again reports why it did not compile
+        if (const std::string *chunk = (*it)->getChunk())
+            script->loadCompiledFile(file, *chunk);
+        else
+            script->loadFile(file);
+    }
+}
+
+template<typename T>
+static void deleteAll(std::vector<T *> &objects)
+{
+    for (typename std::vector<T *>::iterator it = objects.begin(),
+         it_end = objects.end(); it != it_end; ++it)
+    {
+        delete *it;
+    }
+    objects.clear();
+}
+
+void HotReload::initialize()
+{
+    if (!Configuration::getBoolValue("game_hotReload", false))
+        return;
+
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        LOG_WARN("Hot reload: Could not watch the data directory");
+        return;
+    }
+
+    const char *databases[] = {
+        DEFAULT_ATTRIBUTEDB_FILE,
+        DEFAULT_ITEMSDB_FILE,
+        DEFAULT_EQUIPDB_FILE,
+        DEFAULT_MONSTERSDB_FILE,
+        DEFAULT_STATUSDB_FILE,
+        DEFAULT_SPECIALSDB_FILE
+    };
+
+    std::set<std::string> directories;
+    for (unsigned i = 0; i < sizeof(databases) / sizeof(databases[0]); ++i)
+        directories.insert(realDirectory(databases[i]));
+
+    for (std::set<std::string>::const_iterator it = directories.begin(),
+         it_end = directories.end(); it != it_end; ++it)
+    {
+        addWatch(*it, std::string());
+    }
+
+    const std::string scripts = ResourceManager::resolve("scripts");
+    if (!scripts.empty())
+        addWatchRecursive(scripts, "scripts/");
+
+    LOG_INFO("Hot reload: Watching " << watchPrefixes.size()
+             << " directories");
+#else
+    LOG_WARN("Hot reload: Watching the data directory is only supported on "
+             "Linux, use @reload instead.");
+#endif
+}
+
+void HotReload::deinitialize()
+{
+#ifdef __linux__
+    if (inotifyFd >= 0)
+    {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+    watchPrefixes.clear();
+#endif
+
+    delete parsePool;
+    parsePool = 0;
+    deleteAll(parseJobs);
+    deleteAll(compileJobs);
+
+    deleteAll(retiredAttributes);
+    deleteAll(retiredItems);
+    deleteAll(retiredMonsters);
+    deleteAll(retiredSpecials);
+}
+
+void HotReload::requestReload(unsigned databases)
+{
+    pendingDatabases |= databases;
+    lastChange = 0;
+}
+
+/**
+ * Starts parsing the files of the pending databases and compiling the
+ * pending scripts on the parse pool.
+ */
+static void startReload()
+{
+    if (!parsePool)
+    {
+        // libxml2 has to be set up before parsing on other threads. A pool
+        // of a single thread would parse on the calling thread instead.
+        xmlInitParser();
+        parsePool = new utils::ThreadPool(2);
+    }
+
+    reloadStart = utils::getTimeInMicrosec();
+    reloadingDatabases = withDependents(pendingDatabases);
+    pendingDatabases = 0;
+
+    std::vector<std::string> files;
+    addFilesOf(reloadingDatabases, files);
+    for (std::vector<std::string>::const_iterator it = files.begin(),
+         it_end = files.end(); it != it_end; ++it)
+    {
+        parseJobs.push_back(new ParseJob(*it));
+        parsePool->add(parseJobs.back());
+    }
+
+    const Script *script = ScriptManager::currentState();
+    for (std::set<std::string>::const_iterator it = pendingScripts.begin(),
+         it_end = pendingScripts.end(); it != it_end; ++it)
+    {
+        if (!script->isLoadedFile(*it))
+        {
+            LOG_DEBUG("Hot reload: Ignoring " << *it
+                      << ", it was not loaded outside of a map");
+            continue;
+        }
+
+        compileJobs.push_back(new CompileJob(script, *it));
+        parsePool->add(compileJobs.back());
+    }
+    pendingScripts.clear();
+}
+
+/**
+ * Builds the databases from the parsed files and swaps them in, then runs
+ * the compiled scripts.
+ */
+static void finishReload()
+{
+    const uint64_t start = utils::getTimeInMicrosec();
+
+    RootNodes rootNodes;
+    for (std::vector<ParseJob *>::const_iterator it = parseJobs.begin(),
+         it_end = parseJobs.end(); it != it_end; ++it)
+    {
+        rootNodes[(*it)->getFile()] = (*it)->getRootNode();
+    }
+
+    reloadDatabases(reloadingDatabases, rootNodes);
+    reloadScripts(compileJobs);
+
+    deleteAll(parseJobs);
+    deleteAll(compileJobs);
+    reloadingDatabases = 0;
+
+    const uint64_t end = utils::getTimeInMicrosec();
+    LOG_INFO("Hot reload: Done in " << (end - reloadStart) / 1000
+             << " ms, " << (end - start) / 1000 << " ms between ticks");
+}
+
+void HotReload::update()
+{
+    pollChanges();
+
+    if (parseJobs.empty() && compileJobs.empty())
+    {
+        if (!pendingDatabases && pendingScripts.empty())
+            return;
+
+        if (utils::getTimeInMicrosec() - lastChange < RELOAD_DELAY)
+            return;
+
+        startReload();
+
+        // Every pending script may have been ignored
+        if (parseJobs.empty() && compileJobs.empty())
+            return;
+    }
+
+    // Everything is swapped in at once, when all the files are processed
+    if (parsePool->isDone())
+        finishReload();
+}
@@ -0,0 +1,79 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef HOTRELOAD_H
+#define HOTRELOAD_H
+
+/**
+ * Reloads the XML databases and Lua scripts while the server runs.
+ *
+ * On Linux the data directory is watched with inotify. Changed files are
+ * picked up once they have not changed for a moment. The database files are
+ * parsed on a thread pool while the world keeps running. Once all of them
+ * are parsed, the new definitions are built from them and swapped in
+ * between two ticks; building them refers to the other databases, so that
+ * part stays on the tick thread. The definitions they replace are kept
+ * alive until shutdown, so that the entities referring to them stay valid.
+ * Script callbacks registered on items, monsters, specials and status
+ * effects are carried over.
+ *
+ * A changed Lua file is run again in the script state when it was loaded
+ * outside of a map. It is compiled on the thread pool too, only running it
+ * happens between ticks. Functions looked up by name pick up the change,
+ * while callbacks that were already handed out keep the old function.
+ */
+namespace HotReload
+{
+    enum Database
+    {
+        DB_ATTRIBUTES   = 1 << 0,
+        DB_ITEMS        = 1 << 1,
+        DB_MONSTERS     = 1 << 2,
+        DB_STATUS       = 1 << 3,
+        DB_SPECIALS     = 1 << 4,
+        DB_ALL          = (1 << 5) - 1
+    };
+
+    /**
+     * Starts watching the data directory when game_hotReload is enabled.
+     */
+    void initialize();
+
+    /**
+     * Stops watching and deletes the replaced definitions. To be called
+     * once all entities are gone.
+     */
+    void deinitialize();
+
+    /**
+     * Reloads the given databases in the next call to update(), whether or
+     * not their files changed.
+     */
+    void requestReload(unsigned databases);
+
+    /**
+     * Looks for changed files, starts parsing them and swaps in the
+     * definitions that finished parsing. Only to be called between ticks.
+     */
+    void update();
+}
+
+#endif // HOTRELOAD_H
@@ -250,6 +250,13 @@ class ItemClass
         Script::Ref getEventCallback(const std::string &event) const
         { return mEventCallbacks.value(event); }
 
+        /**
+         * Takes over the script callbacks of the definition this one
+         * replaces.
+         */
+        void copyEventCallbacks(const ItemClass &other)
+        { mEventCallbacks = other.mEventCallbacks; }
+
         void addAttack(AttackInfo *attackInfo, ItemTriggerType applyTrigger,
                        ItemTriggerType dispellTrigger);
 
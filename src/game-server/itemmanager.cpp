@@ -40,10 +40,18 @@ void ItemManager::reload()
 }
 
 void ItemManager::initialize()
+{
+    XML::Document equipDoc(mEquipSlotsFile);
+    XML::Document itemsDoc(mItemsFile);
+    initialize(itemsDoc.rootNode(), equipDoc.rootNode());
+}
+
+void ItemManager::initialize(xmlNodePtr itemsRootNode,
+                             xmlNodePtr equipRootNode)
 {
     mVisibleEquipSlotCount = 0;
-    readEquipSlotsFile();
-    readItemsFile();
+    readEquipSlotsFile(equipRootNode);
+    readItemsFile(itemsRootNode);
 }
 
 void ItemManager::deinitialize()
@@ -65,6 +73,16 @@ void ItemManager::deinitialize()
     mItemClassesByName.clear();
 }
 
+void ItemManager::copyCallbacks(const ItemManager &previous)
+{
+    for (ItemClasses::iterator i = mItemClasses.begin(),
+         i_end = mItemClasses.end(); i != i_end; ++i)
+    {
+        if (ItemClass *item = previous.getItem(i->first))
+            i->second->copyEventCallbacks(*item);
+    }
+}
+
 ItemClass *ItemManager::getItem(int itemId) const
 {
     ItemClasses::const_iterator i = mItemClasses.find(itemId);
@@ -99,11 +117,8 @@ bool ItemManager::isEquipSlotVisible(unsigned id) const
     return i != mEquipSlotsInfo.end() ? i->second->visibleSlot : false;
 }
 
-void ItemManager::readEquipSlotsFile()
+void ItemManager::readEquipSlotsFile(xmlNodePtr rootNode)
 {
-    XML::Document doc(mEquipSlotsFile);
-    xmlNodePtr rootNode = doc.rootNode();
-
     if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "equip-slots"))
     {
         LOG_ERROR("Item Manager: Error while parsing equip slots database ("
@@ -172,11 +187,8 @@ void ItemManager::readEquipSlotsFile()
              << totalCapacity << "' slots.");
 }
 
-void ItemManager::readItemsFile()
+void ItemManager::readItemsFile(xmlNodePtr rootNode)
 {
-    XML::Document doc2(mItemsFile);
-    xmlNodePtr rootNode = doc2.rootNode();
-
     if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "items"))
     {
         LOG_ERROR("Item Manager: Error while parsing item database ("
@@ -66,6 +66,12 @@ class ItemManager
          */
         void initialize();
 
+        /**
+         * Loads the items and equip slots from the root nodes of already
+         * parsed reference files.
+         */
+        void initialize(xmlNodePtr itemsRootNode, xmlNodePtr equipRootNode);
+
         /**
          * Reloads item reference file.
          */
@@ -76,6 +82,12 @@ class ItemManager
          */
         void deinitialize();
 
+        /**
+         * Gives the item classes the script callbacks of the items with the
+         * same id in a previously loaded database.
+         */
+        void copyCallbacks(const ItemManager &previous);
+
         /**
          * Gets the ItemClass having the given ID.
          */
@@ -105,10 +117,10 @@ class ItemManager
 
     private:
         /** Loads the equip slots that a character has available to them. */
-        void readEquipSlotsFile();
+        void readEquipSlotsFile(xmlNodePtr rootNode);
 
         /** Loads the main item database. */
-        void readItemsFile();
+        void readItemsFile(xmlNodePtr rootNode);
         void readItemNode(xmlNodePtr itemNode);
         void readEquipNode(xmlNodePtr equipNode, ItemClass *item);
         void readEffectNode(xmlNodePtr effectNode, ItemClass *item);
@@ -26,6 +26,7 @@
 #include "game-server/accountconnection.h"
 #include "game-server/attributemanager.h"
 #include "game-server/gamehandler.h"
+#include "game-server/hotreload.h"
 #include "game-server/emotemanager.h"
 #include "game-server/itemmanager.h"
 #include "game-server/mapmanager.h"
@@ -35,6 +36,8 @@
 #include "game-server/statusmanager.h"
 #include "game-server/postman.h"
 #include "game-server/state.h"
+#include "game-server/tickprofiler.h"
+#include "game-server/tickscheduler.h"
 #include "net/bandwidth.h"
 #include "net/connectionhandler.h"
 #include "net/messageout.h"
@@ -68,8 +71,6 @@ using utils::Logger;
 #define DEFAULT_LOG_FILE                    "manaserv-game.log"
 #define DEFAULT_MAIN_SCRIPT_FILE            "scripts/main.lua"
 
-static int const WORLD_TICK_SKIP = 2; /** tolerance for lagging behind in world calculation) **/
-
 /** Timer for world ticks */
 static utils::Timer worldTimer(WORLD_TICK_MS);
 static int currentTick = 0;     /**< Current world time in ticks */
@@ -138,6 +139,9 @@ static void initializeServer()
     emoteManager->initialize();
     StatusManager::initialize(DEFAULT_STATUSDB_FILE);
     PermissionManager::initialize(DEFAULT_PERMISSION_FILE);
+    TickProfiler::initialize();
+    TickScheduler::initialize();
+    HotReload::initialize();
 
     std::string mainScript = Configuration::getValue("script_mainFile",
                                                      DEFAULT_MAIN_SCRIPT_FILE);
@@ -194,6 +198,7 @@ static void deinitializeServer()
     delete emoteManager; emoteManager = 0;
     MapManager::deinitialize();
     StatusManager::deinitialize();
+    HotReload::deinitialize();
     ScriptManager::deinitialize();
 
     PHYSFS_deinit();
@@ -345,6 +350,8 @@ int main(int argc, char *argv[])
 
     bool debugNetwork = Configuration::getBoolValue("net_debugMode", false);
     MessageOut::setDebugModeEnabled(debugNetwork);
+    MessageOut::setCompressionThreshold(
+            Configuration::getValue("net_compressionThreshold", 256));
 
     // Make an initial attempt to connect to the account server
     // Try again after longer and longer intervals when connection fails.
@@ -373,26 +380,30 @@ int main(int argc, char *argv[])
     // Account connection lost flag
     bool accountServerLost = false;
 
+    // Periodic sync with the account server is due
+    bool syncPending = false;
+
     while (running)
     {
         int elapsedTicks = worldTimer.poll();
 
         if (elapsedTicks == 0)
         {
+            HotReload::update();
+            ScriptManager::collectGarbage(TickScheduler::getIdleBudget());
             worldTimer.sleep();
             continue;
         }
 
-        if (elapsedTicks > WORLD_TICK_SKIP)
-        {
-            LOG_WARN("Skipping "<< elapsedTicks - 1 << " ticks.");
-            elapsedTicks = 1;
-        }
+        // Run the missed ticks back to back, up to a limit
+        elapsedTicks = TickScheduler::ticksToRun(elapsedTicks);
 
         while (elapsedTicks > 0)
         {
+            const uint64_t tickStart = utils::getTimeInMicrosec();
             currentTick++;
             elapsedTicks--;
+            TickScheduler::beginTick(currentTick, elapsedTicks > 0);
 
             // Print world time at 10 second intervals to show we're alive
             if (currentTick % 100 == 0)
@@ -403,20 +414,38 @@ int main(int argc, char *argv[])
                 accountServerLost = false;
 
                 // Handle all messages that are in the message queues
-                accountHandler->process();
+                {
+                    TickProfiler::ScopedTimer timer(TickProfiler::PHASE_ACCOUNT);
+                    accountHandler->process();
+                }
+
+                // force sending changes to the account server every 10 secs.
+                if (currentTick % 100 == 0)
+                    syncPending = true;
 
-                if (currentTick % 100 == 0) {
+                if (syncPending &&
+                    !TickScheduler::defer(TickScheduler::WORK_SYNC))
+                {
                     accountHandler->syncChanges(true);
-                    // force sending changes to the account server every 10 secs.
+                    syncPending = false;
                 }
 
                 if (currentTick % 300 == 0)
                 {
-                    accountHandler->sendStatistics();
+                    accountHandler->sendStatistics(
+                        *TickProfiler::getTimes(TickProfiler::PHASE_TICK));
                     LOG_INFO("Total Account Output: " << gBandwidth->totalInterServerOut() << " Bytes");
                     LOG_INFO("Total Account Input: " << gBandwidth->totalInterServerIn() << " Bytes");
                     LOG_INFO("Total Client Output: " << gBandwidth->totalClientOut() << " Bytes");
                     LOG_INFO("Total Client Input: " << gBandwidth->totalClientIn() << " Bytes");
+                    if (gBandwidth->totalCompressedRaw() > 0)
+                        LOG_INFO("Total Compressed Output: " << gBandwidth->totalCompressedRaw()
+                                 << " to " << gBandwidth->totalCompressed() << " Bytes");
+                    if (gBandwidth->totalDecompressedRaw() > 0)
+                        LOG_INFO("Total Compressed Input: " << gBandwidth->totalDecompressed()
+                                 << " to " << gBandwidth->totalDecompressedRaw() << " Bytes");
+                    LOG_INFO("Total Compression Time: " << gBandwidth->totalCompressionTime() / 1000 << " ms");
+                    LOG_INFO("Tick scheduler " << TickScheduler::summary());
                 }
             }
             else
@@ -435,11 +464,22 @@ int main(int argc, char *argv[])
                     accountHandler->start(options.port);
                 }
             }
-            gameHandler->process();
+            {
+                TickProfiler::ScopedTimer timer(TickProfiler::PHASE_NETWORK);
+                gameHandler->process();
+            }
             // Update all active objects/beings
             GameState::update(currentTick);
             // Send potentially urgent outgoing messages
-            gameHandler->flush();
+            {
+                TickProfiler::ScopedTimer timer(TickProfiler::PHASE_FLUSH);
+                gameHandler->flush();
+            }
+
+            const int tickTime = utils::getTimeInMicrosec() - tickStart;
+            TickProfiler::record(TickProfiler::PHASE_TICK, 0, tickTime);
+            TickProfiler::endTick(currentTick);
+            TickScheduler::endTick(tickTime);
         }
     }
 
@@ -103,6 +103,7 @@ class Location
 Map::Map(int width, int height, int tileWidth, int tileHeight):
     mWidth(width), mHeight(height),
     mTileWidth(tileWidth), mTileHeight(tileHeight),
+    mBlockmasks(width * height),
     mMetaTiles(width * height)
 {
 }
@@ -121,6 +122,7 @@ void Map::setSize(int width, int height)
     mWidth = width;
     mHeight = height;
 
+    mBlockmasks.resize(width * height);
     mMetaTiles.resize(width * height);
 }
 
@@ -134,70 +136,47 @@ const std::string &Map::getProperty(const std::string &key) const
     return i->second;
 }
 
-void Map::blockTile(int x, int y, BlockType type)
+/**
+ * Returns the blockmask bit of a block type.
+ */
+static unsigned char blockmaskOf(BlockType type)
 {
-    if (type == BLOCKTYPE_NONE || !contains(x, y))
-        return;
-
-    MetaTile &metaTile = mMetaTiles[x + y * mWidth];
-
-    if (metaTile.occupation[type] < UINT_MAX &&
-        (++metaTile.occupation[type]) > 0)
+    switch (type)
     {
-        switch (type)
-        {
-            case BLOCKTYPE_WALL:
-                metaTile.blockmask |= BLOCKMASK_WALL;
-                break;
-            case BLOCKTYPE_CHARACTER:
-                metaTile.blockmask |= BLOCKMASK_CHARACTER;
-                break;
-            case BLOCKTYPE_MONSTER:
-                metaTile.blockmask |= BLOCKMASK_MONSTER;
-                break;
-            default:
-                // Nothing to do.
-                break;
-        }
+        case BLOCKTYPE_WALL:
+            return Map::BLOCKMASK_WALL;
+        case BLOCKTYPE_CHARACTER:
+            return Map::BLOCKMASK_CHARACTER;
+        case BLOCKTYPE_MONSTER:
+            return Map::BLOCKMASK_MONSTER;
+        default:
+            return 0;
     }
 }
 
-void Map::freeTile(int x, int y, BlockType type)
+void Map::blockTile(int x, int y, BlockType type)
 {
     if (type == BLOCKTYPE_NONE || !contains(x, y))
         return;
 
-    MetaTile &metaTile = mMetaTiles[x + y * mWidth];
-    assert(metaTile.occupation[type] > 0);
+    const int index = x + y * mWidth;
+    unsigned short &occupation = mMetaTiles[index].occupation[type];
 
-    if (!(--metaTile.occupation[type]))
-    {
-        switch (type)
-        {
-            case BLOCKTYPE_WALL:
-                metaTile.blockmask &= (BLOCKMASK_WALL xor 0xff);
-                break;
-            case BLOCKTYPE_CHARACTER:
-                metaTile.blockmask &= (BLOCKMASK_CHARACTER xor 0xff);
-                break;
-            case BLOCKTYPE_MONSTER:
-                metaTile.blockmask &= (BLOCKMASK_MONSTER xor 0xff);
-                break;
-            default:
-                // nothing
-                break;
-        }
-    }
+    if (occupation < USHRT_MAX && ++occupation > 0)
+        mBlockmasks[index] |= blockmaskOf(type);
 }
 
-bool Map::getWalk(int x, int y, char walkmask) const
+void Map::freeTile(int x, int y, BlockType type)
 {
-    // You can't walk outside of the map
-    if (!contains(x, y))
-        return false;
+    if (type == BLOCKTYPE_NONE || !contains(x, y))
+        return;
+
+    const int index = x + y * mWidth;
+    unsigned short &occupation = mMetaTiles[index].occupation[type];
+    assert(occupation > 0);
 
-    // Check if the tile is walkable
-    return !(mMetaTiles[x + y * mWidth].blockmask & walkmask);
+    if (!--occupation)
+        mBlockmasks[index] &= ~blockmaskOf(type);
 }
 
 Path Map::findPath(int startX, int startY,
@@ -270,22 +249,27 @@ Path FindPath::operator() (int startX, int startY,
                 if ((dx == 0 && dy == 0) || !map->contains(x, y))
                     continue;
 
-                PathInfo *newTile = getInfo(x, y);
-
-                // Skip if the tile is on the closed list or is not walkable
-                if (newTile->whichList == mOnClosedList
-                        || !map->getWalk(x, y, walkmask))
+                // Skip if the tile is not walkable. This only reads the
+                // blockmasks, which are much smaller than the path infos.
+                if (map->getBlockmask(x, y) & walkmask)
                     continue;
 
                 // When taking a diagonal step, verify that we can skip the
-                // corner.
+                // corner. Both tiles are within the map when the new one is.
                 if (dx != 0 && dy != 0)
                 {
-                    if (!map->getWalk(curr.x, curr.y + dy, walkmask)
-                            || !map->getWalk(curr.x + dx, curr.y, walkmask))
+                    if ((map->getBlockmask(curr.x, curr.y + dy) & walkmask)
+                            || (map->getBlockmask(curr.x + dx, curr.y)
+                                & walkmask))
                         continue;
                 }
 
+                PathInfo *newTile = getInfo(x, y);
+
+                // Skip if the tile is on the closed list
+                if (newTile->whichList == mOnClosedList)
+                    continue;
+
                 // Calculate G cost for this route, ~sqrt(2) for moving diagonal
                 int Gcost = currInfo->Gcost +
                     (dx == 0 || dy == 0 ? basicCost : basicCost * 362 / 256);
@@ -42,22 +42,20 @@ enum BlockType
 };
 
 /**
- * A meta tile stores additional information about a location on a tile map.
- * This is information that doesn't need to be repeated for each tile in each
- * layer of the map.
+ * A meta tile counts how many things of each block type occupy a location on
+ * a tile map. The resulting walkability is kept apart, in the blockmasks of
+ * the map, so that path finding only has to go through a byte per tile.
  */
 class MetaTile
 {
     public:
         MetaTile()
-            : blockmask(0)
         {
             for (unsigned i = 0; i < NB_BLOCKTYPES; ++i)
                 occupation[i] = 0;
         }
 
-        unsigned occupation[NB_BLOCKTYPES];
-        char blockmask;          /**< walkability bitfield */
+        unsigned short occupation[NB_BLOCKTYPES];
 };
 
 class MapObject
@@ -83,6 +81,9 @@ class MapObject
         const std::string &getProperty(const std::string &key) const
         { return mProperties.value(key); }
 
+        const utils::NameMap<std::string> &getProperties() const
+        { return mProperties; }
+
         const std::string &getName() const
         { return mName; }
 
@@ -135,7 +136,16 @@ class Map
         /**
          * Gets walkability for a tile with a blocking bitmask
          */
-        bool getWalk(int x, int y, char walkmask = BLOCKMASK_WALL) const;
+        bool getWalk(int x, int y,
+                     unsigned char walkmask = BLOCKMASK_WALL) const
+        { return contains(x, y) && !(getBlockmask(x, y) & walkmask); }
+
+        /**
+         * Returns the block types occupying a tile within the map, as a
+         * combination of the BLOCKMASK_* values.
+         */
+        unsigned char getBlockmask(int x, int y) const
+        { return mBlockmasks[x + y * mWidth]; }
 
         /**
          * Tells if a tile location is within the map range.
@@ -178,6 +188,12 @@ class Map
         void setProperty(const std::string &key, const std::string &val)
         { mProperties[key] = val; }
 
+        /**
+         * Returns all the general map properties.
+         */
+        const std::map<std::string, std::string> &getProperties() const
+        { return mProperties; }
+
         /**
          * Adds an object.
          */
@@ -211,6 +227,7 @@ class Map
         int mTileWidth, mTileHeight;
         std::map<std::string, std::string> mProperties;
 
+        std::vector<unsigned char> mBlockmasks;
         std::vector<MetaTile> mMetaTiles;
         std::vector<MapObject*> mMapObjects;
 };
@@ -26,12 +26,17 @@
 #include "common/configuration.h"
 #include "common/resourcemanager.h"
 #include "game-server/character.h"
+#include "game-server/item.h"
 #include "game-server/mapcomposite.h"
 #include "game-server/map.h"
 #include "game-server/mapmanager.h"
 #include "game-server/mapreader.h"
+#include "game-server/monster.h"
 #include "game-server/monstermanager.h"
+#include "game-server/quest.h"
 #include "game-server/spawnareacomponent.h"
+#include "game-server/state.h"
+#include "game-server/tickprofiler.h"
 #include "game-server/triggerareacomponent.h"
 #include "scripting/script.h"
 #include "scripting/scriptmanager.h"
@@ -52,91 +57,76 @@
    in dealing with zone changes. */
 static int const zoneDiam = 256;
 
+/**
+ * Puts an actor at the given position of the objects of a zone.
+ */
+static void place(std::vector< Actor * > &objects, unsigned pos, Actor *obj)
+{
+    objects[pos] = obj;
+    obj->setZoneIndex(pos);
+}
+
 void MapZone::insert(Actor *obj)
 {
+    // Make room at the end of every partition the actor is part of, by
+    // moving the first actor of the next partition to the end of it
+    unsigned pos = objects.size();
+    objects.push_back(obj);
+
     int type = obj->getType();
     switch (type)
     {
         case OBJECT_CHARACTER:
-        {
-            if (nbCharacters != nbMovingObjects)
-            {
-                if (nbMovingObjects != objects.size())
-                {
-                    objects.push_back(objects[nbMovingObjects]);
-                    objects[nbMovingObjects] = objects[nbCharacters];
-                }
-                else
-                {
-                    objects.push_back(objects[nbCharacters]);
-                }
-                objects[nbCharacters] = obj;
-                ++nbCharacters;
-                ++nbMovingObjects;
-                break;
-            }
-            ++nbCharacters;
-        } // no break!
         case OBJECT_MONSTER:
         case OBJECT_NPC:
         {
-            if (nbMovingObjects != objects.size())
+            if (nbMovingObjects != pos)
             {
-                objects.push_back(objects[nbMovingObjects]);
-                objects[nbMovingObjects] = obj;
-                ++nbMovingObjects;
-                break;
+                place(objects, pos, objects[nbMovingObjects]);
+                pos = nbMovingObjects;
             }
             ++nbMovingObjects;
-        } // no break!
+
+            if (type != OBJECT_CHARACTER)
+                break;
+
+            if (nbCharacters != pos)
+            {
+                place(objects, pos, objects[nbCharacters]);
+                pos = nbCharacters;
+            }
+            ++nbCharacters;
+        } break;
         default:
-        {
-            objects.push_back(obj);
             break;
-        }
     }
+
+    place(objects, pos, obj);
 }
 
 void MapZone::remove(Actor *obj)
 {
-    std::vector< Actor * >::iterator i_beg = objects.begin(), i, i_end;
-    int type = obj->getType();
-    switch (type)
-    {
-        case OBJECT_CHARACTER:
-        {
-            i = i_beg;
-            i_end = objects.begin() + nbCharacters;
-        } break;
-        case OBJECT_MONSTER:
-        case OBJECT_NPC:
-        {
-            i = objects.begin() + nbCharacters;
-            i_end = objects.begin() + nbMovingObjects;
-        } break;
-        default:
-        {
-            i = objects.begin() + nbMovingObjects;
-            i_end = objects.end();
-            break;
-        }
-    }
-    i = std::find(i, i_end, obj);
-    assert(i != i_end);
-    unsigned pos = i - i_beg;
+    unsigned pos = obj->getZoneIndex();
+    assert(pos < objects.size() && objects[pos] == obj);
+
+    // Fill the hole with the last actor of the partition, and that one's
+    // place with the last actor of the next partition
     if (pos < nbCharacters)
     {
-        objects[pos] = objects[nbCharacters - 1];
-        pos = nbCharacters - 1;
         --nbCharacters;
+        if (pos != nbCharacters)
+            place(objects, pos, objects[nbCharacters]);
+        pos = nbCharacters;
     }
     if (pos < nbMovingObjects)
     {
-        objects[pos] = objects[nbMovingObjects - 1];
-        pos = nbMovingObjects - 1;
         --nbMovingObjects;
+        if (pos != nbMovingObjects)
+            place(objects, pos, objects[nbMovingObjects]);
+        pos = nbMovingObjects;
     }
-    objects[pos] = objects[objects.size() - 1];
+    if (pos != objects.size() - 1)
+        place(objects, pos, objects.back());
     objects.pop_back();
 }
 
@@ -153,7 +143,8 @@ static void addZone(MapRegion &r, unsigned z)
 ZoneIterator::ZoneIterator(const MapRegion &r, const MapContent *m)
   : region(r), pos(0), map(m)
 {
-    current = &map->zones[r.empty() ? 0 : r[0]];
+    // Nothing to iterate over on a map that is not started
+    current = map ? &map->zones[r.empty() ? 0 : r[0]] : NULL;
 }
 
 void ZoneIterator::operator++()
@@ -272,89 +263,13 @@ void ActorIterator::operator++()
 }
 
 
-/******************************************************************************
- * ObjectBucket
- *****************************************************************************/
-
-ObjectBucket::ObjectBucket()
-  : free(256), next_object(0)
-{
-    for (unsigned i = 0; i < 256 / int_bitsize; ++i)
-    {
-        // An occupied ID is represented by zero in the bitmap.
-        bitmap[i] = ~0u;
-    }
-}
-
-int ObjectBucket::allocate()
-{
-    // Any free ID in the bucket?
-    if (!free)
-    {
-        LOG_INFO("No free id in bucket");
-        return -1;
-    }
-
-    int freeBucket = -1;
-    // See if the the next_object bucket is free
-    if (bitmap[next_object] != 0)
-    {
-        freeBucket = next_object;
-    }
-    else
-    {
-        /* next_object was not free. Check the whole bucket until one ID is found,
-           starting from the IDs around next_object. */
-        for (unsigned i = 0; i < 256 / int_bitsize; ++i)
-        {
-            // Check to see if this subbucket is free
-            if (bitmap[i] != 0)
-            {
-                freeBucket = i;
-                break;
-            }
-        }
-    }
-
-    assert(freeBucket >= 0);
-
-    // One of them is free. Find it by looking bit-by-bit.
-    int b = bitmap[freeBucket];
-    int j = 0;
-    while (!(b & 1))
-    {
-        b >>= 1;
-        ++j;
-    }
-    // Flip that bit to on, and return the value
-    bitmap[freeBucket] &= ~(1 << j);
-    j += freeBucket * int_bitsize;
-    next_object = freeBucket;
-    --free;
-    return j;
-}
-
-void ObjectBucket::deallocate(int i)
-{
-    assert(!(bitmap[i / int_bitsize] & (1 << (i % int_bitsize))));
-    bitmap[i / int_bitsize] |= 1 << (i % int_bitsize);
-    ++free;
-}
-
-
 /******************************************************************************
  * MapContent
  *****************************************************************************/
 
 MapContent::MapContent(Map *map)
-  : last_bucket(0), zones(NULL)
+  : zones(NULL)
 {
-    buckets[0] = new ObjectBucket;
-    buckets[0]->allocate(); // Skip ID 0
-    for (int i = 1; i < 256; ++i)
-    {
-        buckets[i] = NULL;
-    }
     mapWidth = (map->getWidth() * map->getTileWidth() + zoneDiam - 1)
                / zoneDiam;
     mapHeight = (map->getHeight() * map->getTileHeight() + zoneDiam - 1)
@@ -364,58 +279,27 @@ MapContent::MapContent(Map *map)
 
 MapContent::~MapContent()
 {
-    for (int i = 0; i < 256; ++i)
-    {
-        delete buckets[i];
-    }
     delete[] zones;
 }
 
 bool MapContent::allocate(Actor *obj)
 {
-    // First, try allocating from the last used bucket.
-    ObjectBucket *b = buckets[last_bucket];
-    int i = b->allocate();
-    if (i >= 0)
+    int id = publicIds.allocate(obj);
+    if (id < 0)
     {
-        b->objects[i] = obj;
-        obj->setPublicID(last_bucket * 256 + i);
-        return true;
-    }
-
-    /* If the last used bucket is already full, scan all the buckets for an
-       empty place. If none is available, create a new bucket. */
-    for (i = 0; i < 256; ++i)
-    {
-        b = buckets[i];
-        if (!b)
-        {
-            /* Buckets are created in order. If there is nothing at position i,
-               there will not be anything in the next positions. So create a
-               new bucket. */
-            b = new ObjectBucket;
-            buckets[i] = b;
-            LOG_DEBUG("New bucket created");
-        }
-        int j = b->allocate();
-        if (j >= 0)
-        {
-            last_bucket = i;
-            b->objects[j] = obj;
-            obj->setPublicID(last_bucket * 256 + j);
-            return true;
-        }
+        // All the IDs are currently used, fail.
+        LOG_ERROR("unable to allocate id");
+        return false;
     }
 
-    // All the IDs are currently used, fail.
-    LOG_ERROR("unable to allocate id");
-    return false;
+    obj->setPublicID(id);
+    return true;
 }
 
 void MapContent::deallocate(Actor *obj)
 {
-    unsigned short id = obj->getPublicID();
-    buckets[id / 256]->deallocate(id % 256);
+    assert(publicIds.get(obj->getPublicID()) == obj);
+    publicIds.deallocate(obj->getPublicID());
 }
 
 void MapContent::fillRegion(MapRegion &r, const Point &p, int radius) const
@@ -458,16 +342,17 @@ MapZone& MapContent::getZone(const Point &pos) const
  * MapComposite
  *****************************************************************************/
 
-Script::Ref MapComposite::mInitializeCallback;
-Script::Ref MapComposite::mUpdateCallback;
-
 MapComposite::MapComposite(int id, const std::string &name):
     mActive(false),
     mMap(0),
     mContent(0),
     mName(name),
     mID(id),
-    mPvPRules(PVP_NONE)
+    mPvPRules(PVP_NONE),
+    mIdleSleep(true),
+    mCharacterCount(0),
+    mEmptySince(0),
+    mScript(0)
 {
 }
 
@@ -475,6 +360,14 @@ MapComposite::~MapComposite()
 {
     delete mMap;
     delete mContent;
+
+    // The entities on the map refer to the script state
+    ScriptManager::destroyState(mScript);
+}
+
+Script *MapComposite::getScript() const
+{
+    return mScript ? mScript : ScriptManager::currentState();
 }
 
 bool MapComposite::readMap()
@@ -492,6 +385,17 @@ bool MapComposite::activate()
     if (!mMap)
         return false;
 
+    mActive = true;
+    return true;
+}
+
+void MapComposite::start()
+{
+    assert(isActive() && !isStarted());
+
+    if (ScriptManager::usePerMapStates())
+        mScript = ScriptManager::createState();
+
     initializeContent();
 
     std::string sPvP = mMap->getProperty("pvp");
@@ -503,26 +407,131 @@ bool MapComposite::activate()
     else
         mPvPRules = PVP_NONE;
 
-    mActive = true;
+    mIdleSleep = Configuration::getBoolValue("game_idleSleep", true);
+    mEmptySince = GameState::getCurrentTick();
+
+    // Scripts of the global state may schedule work on this map as well
+    Script *scripts[] = { ScriptManager::currentState(), mScript };
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        Script *s = scripts[i];
+        if (!s)
+            continue;
+
+        Script::Ref callback = s->getMapInitializeCallback();
+        if (!callback.isValid())
+        {
+            LOG_WARN("No callback for map initialization found");
+            continue;
+        }
 
-    if (!mInitializeCallback.isValid())
+        s->prepare(callback);
+        s->execute(this);
+    }
+
+    std::vector<FloorItem> floorItems;
+    floorItems.swap(mFloorItems);
+    for (std::vector<FloorItem>::const_iterator it = floorItems.begin(),
+         it_end = floorItems.end(); it != it_end; ++it)
     {
-        LOG_WARN("No callback for map initialization found");
+        createFloorItem(*it);
     }
-    else
+}
+
+/**
+ * Forgets the variable callbacks of a script state that is going away.
+ */
+template<class Callbacks>
+static void forgetCallbacks(Callbacks &callbacks, Script *script)
+{
+    for (typename Callbacks::iterator it = callbacks.begin();
+         it != callbacks.end();)
     {
-        Script *s = ScriptManager::currentState();
-        s->prepare(mInitializeCallback);
-        s->execute(this);
+        if (it->second.script == script)
+            callbacks.erase(it++);
+        else
+            ++it;
     }
+}
 
-    return true;
+void MapComposite::stop()
+{
+    assert(isStarted());
+
+    const std::vector< Entity * > &entities = mContent->entities;
+    for (std::vector< Entity * >::const_iterator it = entities.begin(),
+         it_end = entities.end(); it != it_end; ++it)
+    {
+        if ((*it)->getType() != OBJECT_ITEM)
+            continue;
+
+        Actor *actor = static_cast< Actor * >(*it);
+        ItemComponent *item = actor->getComponent<ItemComponent>();
+        const Point &pos = actor->getPosition();
+        FloorItem floorItem = { item->getItemClass(), item->getAmount(),
+                                pos.x, pos.y };
+        mFloorItems.push_back(floorItem);
+    }
+
+    // The beings go first, spawn areas are told when their monsters leave
+    for (int beings = 1; beings >= 0; --beings)
+    {
+        std::vector< Entity * > doomed;
+        for (std::vector< Entity * >::const_iterator it = entities.begin(),
+             it_end = entities.end(); it != it_end; ++it)
+        {
+            if ((*it)->canMove() == bool(beings))
+                doomed.push_back(*it);
+        }
+
+        for (std::vector< Entity * >::const_iterator it = doomed.begin(),
+             it_end = doomed.end(); it != it_end; ++it)
+        {
+            GameState::remove(*it);
+            delete *it;
+        }
+    }
+
+    delete mContent;
+    mContent = 0;
+
+    if (mScript)
+    {
+        forgetCallbacks(mMapVariableCallbacks, mScript);
+        forgetCallbacks(mWorldVariableCallbacks, mScript);
+        forgetQuestCallbacks(mScript);
+        ScriptManager::destroyState(mScript);
+        mScript = 0;
+    }
+}
+
+void MapComposite::addFloorItem(ItemClass *itemClass, int amount,
+                                int x, int y)
+{
+    FloorItem item = { itemClass, amount, x, y };
+    if (isStarted())
+        createFloorItem(item);
+    else
+        mFloorItems.push_back(item);
+}
+
+void MapComposite::createFloorItem(const FloorItem &item)
+{
+    Entity *entity = Item::create(this, Point(item.x, item.y),
+                                  item.itemClass, item.amount);
+    if (!GameState::insertOrDelete(entity))
+    {
+        // The map is full.
+        LOG_WARN("Couldn't add floor item(s) "
+                 << item.itemClass->getDatabaseID() << " into map " << mID);
+    }
 }
 
 ZoneIterator MapComposite::getAroundPointIterator(const Point &p, int radius) const
 {
     MapRegion r;
-    mContent->fillRegion(r, p, radius);
+    if (mContent)
+        mContent->fillRegion(r, p, radius);
     return ZoneIterator(r, mContent);
 }
 
@@ -536,7 +545,8 @@ ZoneIterator MapComposite::getAroundActorIterator(Actor *obj, int radius) const
 ZoneIterator MapComposite::getInsideRectangleIterator(const Rectangle &p) const
 {
     MapRegion r;
-    mContent->fillRegion(r, p);
+    if (mContent)
+        mContent->fillRegion(r, p);
     return ZoneIterator(r, mContent);
 }
 
@@ -565,6 +575,24 @@ ZoneIterator MapComposite::getAroundBeingIterator(Being *obj, int radius) const
     return ZoneIterator(r2, mContent);
 }
 
+/**
+ * Returns whether the entity has to be updated by itself, which is not the
+ * case for invisible entities only having pooled components.
+ */
+static bool needsUpdate(Entity *entity)
+{
+    if (entity->isVisible())
+        return true;
+
+    for (int i = 0; i < ComponentTypeCount; ++i)
+    {
+        const ComponentType type = ComponentType(i);
+        if (entity->getComponent(type) && !isPooledComponent(type))
+            return true;
+    }
+    return false;
+}
+
 bool MapComposite::insert(Entity *ptr)
 {
     if (ptr->isVisible())
@@ -575,16 +603,54 @@ bool MapComposite::insert(Entity *ptr)
         }
 
         Actor *obj = static_cast< Actor * >(ptr);
-        mContent->getZone(obj->getPosition()).insert(obj);
+        MapZone &zone = mContent->getZone(obj->getPosition());
+        zone.insert(obj);
+
+        if (ptr->getType() == OBJECT_CHARACTER)
+        {
+            wakeBeingsAround(&zone - mContent->zones);
+            ++mCharacterCount;
+        }
     }
 
     ptr->setMap(this);
     mContent->entities.push_back(ptr);
+    mContent->spawnAreas.add(ptr);
+    mContent->triggerAreas.add(ptr);
+
+    if (needsUpdate(ptr))
+        mContent->awake.push_back(ptr);
+    if (ptr->canMove())
+        mContent->moved.push_back(static_cast< Being * >(ptr));
     return true;
 }
 
 void MapComposite::remove(Entity *ptr)
 {
+    // A sleeping being is not in the awake list until woken up
+    if (ptr->canMove())
+        static_cast< Being * >(ptr)->wakeUp();
+
+    std::vector< Entity * > &awake = mContent->awake;
+    std::vector< Entity * >::iterator it =
+            std::find(awake.begin(), awake.end(), ptr);
+    if (it != awake.end())
+        awake.erase(it);
+
+    mContent->spawnAreas.remove(ptr);
+    mContent->triggerAreas.remove(ptr);
+
+    if (ptr->canMove())
+    {
+        Being *being = static_cast< Being * >(ptr);
+        std::vector< Being * > &moved = mContent->moved;
+        moved.erase(std::remove(moved.begin(), moved.end(), being),
+                    moved.end());
+
+        for (unsigned i = 0; i < mContent->triggerAreas.size(); ++i)
+            mContent->triggerAreas.get(i)->remove(being);
+    }
+
     for (std::vector<Entity*>::iterator i = mContent->entities.begin(),
          i_end = mContent->entities.end(); i != i_end; ++i)
     {
@@ -611,59 +677,151 @@ void MapComposite::remove(Entity *ptr)
         {
             mContent->deallocate(static_cast< Being * >(ptr));
         }
+
+        if (ptr->getType() == OBJECT_CHARACTER && !--mCharacterCount)
+            mEmptySince = GameState::getCurrentTick();
     }
 }
 
 void MapComposite::update()
 {
+    // Entities may be woken up while the others are updated, so the awake
+    // list may grow during the loops below
+    std::vector< Entity * > &awake = mContent->awake;
+
     // Update object status
-    const std::vector< Entity * > &entities = getEverything();
-    for (std::vector< Entity * >::const_iterator it = entities.begin(),
-         it_end = entities.end(); it != it_end; ++it)
     {
-        (*it)->update();
+        TickProfiler::ScopedTimer timer(TickProfiler::PHASE_ENTITIES, mID);
+        for (unsigned i = 0; i < awake.size(); ++i)
+        {
+            awake[i]->update();
+        }
+
+        mContent->spawnAreas.update();
     }
 
-    if (mUpdateCallback.isValid())
+    Monster::dispatchBatchedUpdates(this);
+
     {
-        Script *s = ScriptManager::currentState();
-        s->prepare(mUpdateCallback);
-        s->push(mID);
-        s->execute(this);
+        TickProfiler::ScopedTimer timer(TickProfiler::PHASE_SCRIPT, mID);
+
+        if (mScript)
+            mScript->update();
+
+        Script *scripts[] = { ScriptManager::currentState(), mScript };
+        for (unsigned i = 0; i < 2; ++i)
+        {
+            Script *s = scripts[i];
+            if (!s || !s->getMapUpdateCallback().isValid())
+                continue;
+
+            s->prepare(s->getMapUpdateCallback());
+            s->push(mID);
+            s->execute(this);
+        }
     }
 
     // Move objects around and update zones.
-    for (BeingIterator it(getWholeMapIterator()); it; ++it)
+    for (unsigned i = 0; i < awake.size(); ++i)
     {
-        (*it)->move();
+        if (awake[i]->canMove())
+            static_cast< Being * >(awake[i])->move();
     }
 
-    for (int i = 0; i < mContent->mapHeight * mContent->mapWidth; ++i)
-    {
-        mContent->zones[i].destinations.clear();
-    }
+    // Only the zones that beings left during the previous update have
+    // destinations to forget
+    std::vector< unsigned > &departedZones = mContent->departedZones;
+    for (unsigned i = 0; i < departedZones.size(); ++i)
+        mContent->zones[departedZones[i]].destinations.clear();
+    departedZones.clear();
 
-    // Cannot use a WholeMap iterator as objects will change zones under its feet.
-    for (std::vector< Entity * >::iterator i = mContent->entities.begin(),
-         i_end = mContent->entities.end(); i != i_end; ++i)
+    // Cannot use a WholeMap iterator as objects will change zones under its
+    // feet. Sleeping beings do not move.
+    for (unsigned i = 0; i < awake.size(); ++i)
     {
-        if (!(*i)->canMove())
+        if (!awake[i]->canMove())
             continue;
 
-        Being *obj = static_cast< Being * >(*i);
+        Being *obj = static_cast< Being * >(awake[i]);
 
         const Point &pos1 = obj->getOldPosition(),
                     &pos2 = obj->getPosition();
 
+        if (pos1 != pos2)
+            mContent->moved.push_back(obj);
+
         MapZone &src = mContent->getZone(pos1),
                 &dst = mContent->getZone(pos2);
         if (&src != &dst)
         {
+            if (src.destinations.empty())
+                departedZones.push_back(&src - mContent->zones);
             addZone(src.destinations, &dst - mContent->zones);
             src.remove(obj);
             dst.insert(obj);
+
+            if (obj->getType() == OBJECT_CHARACTER)
+                wakeBeingsAround(&dst - mContent->zones);
         }
     }
+
+    // Trigger areas only look at the beings that moved
+    {
+        TickProfiler::ScopedTimer timer(TickProfiler::PHASE_ENTITIES, mID);
+        mContent->triggerAreas.update();
+        mContent->moved.clear();
+    }
+
+    if (mIdleSleep)
+        sleepIdleBeings();
+}
+
+void MapComposite::wakeUp(Being *being)
+{
+    mContent->awake.push_back(being);
+}
+
+void MapComposite::wakeBeingsAround(unsigned zone)
+{
+    const int visualRange = Configuration::getValue("game_visualRange", 448);
+
+    // Every position from which the zone is within the visual range
+    const int x = zone % mContent->mapWidth * zoneDiam;
+    const int y = zone / mContent->mapWidth * zoneDiam;
+    Rectangle r;
+    r.x = std::max(0, x - visualRange);
+    r.y = std::max(0, y - visualRange);
+    r.w = x + zoneDiam + visualRange - r.x;
+    r.h = y + zoneDiam + visualRange - r.y;
+
+    for (BeingIterator it(getInsideRectangleIterator(r)); it; ++it)
+    {
+        (*it)->wakeUp();
+    }
+}
+
+void MapComposite::sleepIdleBeings()
+{
+    const int visualRange = Configuration::getValue("game_visualRange", 448);
+
+    std::vector< Entity * > &awake = mContent->awake;
+    unsigned kept = 0;
+    for (unsigned i = 0; i < awake.size(); ++i)
+    {
+        Entity *entity = awake[i];
+        if (entity->canMove())
+        {
+            Being *being = static_cast< Being * >(entity);
+            if (being->isIdle() &&
+                !CharacterIterator(getAroundActorIterator(being, visualRange)))
+            {
+                being->fallAsleep();
+                continue;
+            }
+        }
+        awake[kept++] = entity;
+    }
+    awake.resize(kept);
 }
 
 const std::vector< Entity * > &MapComposite::getEverything() const
@@ -671,6 +829,18 @@ const std::vector< Entity * > &MapComposite::getEverything() const
     return mContent->entities;
 }
 
+const std::vector< Being * > &MapComposite::getMovedBeings() const
+{
+    return mContent->moved;
+}
+
+Being *MapComposite::getBeing(int publicId) const
+{
+    if (!mContent)
+        return NULL;
+    return static_cast< Being * >(mContent->publicIds.get(publicId));
+}
+
 
 std::string MapComposite::getVariable(const std::string &key) const
 {
@@ -695,12 +865,12 @@ void MapComposite::setVariable(const std::string &key, const std::string &value)
     }
 }
 
-static void callVariableCallback(Script::Ref &function, const std::string &key,
+static void callVariableCallback(Script *s, Script::Ref &function,
+                                 const std::string &key,
                                  const std::string &value, MapComposite *map)
 {
     if (function.isValid())
     {
-        Script *s = ScriptManager::currentState();
         s->prepare(function);
         s->push(key);
         s->push(value);
@@ -711,21 +881,23 @@ static void callVariableCallback(Script::Ref &function, const std::string &key,
 void MapComposite::callMapVariableCallback(const std::string &key,
                                            const std::string &value)
 {
-    std::map<const std::string, Script::Ref>::iterator it =
+    std::map<const std::string, VariableCallback>::iterator it =
             mMapVariableCallbacks.find(key);
     if (it == mMapVariableCallbacks.end())
         return;
-    callVariableCallback(it->second, key, value, this);
+    callVariableCallback(it->second.script, it->second.function,
+                         key, value, this);
 }
 
 void MapComposite::callWorldVariableCallback(const std::string &key,
                                              const std::string &value)
 {
-    std::map<const std::string, Script::Ref>::iterator it =
+    std::map<const std::string, VariableCallback>::iterator it =
             mWorldVariableCallbacks.find(key);
     if (it == mWorldVariableCallbacks.end())
         return;
-    callVariableCallback(it->second, key, value, this);
+    callVariableCallback(it->second.script, it->second.function,
+                         key, value, this);
 }
 
 /**
@@ -858,7 +1030,7 @@ void MapComposite::initializeContent()
 
             if (npcId && !scriptText.empty())
             {
-                Script *script = ScriptManager::currentState();
+                Script *script = getScript();
                 script->loadNPC(object->getName(), npcId,
                                 ManaServ::getGender(gender),
                                 object->getX(), object->getY(),
@@ -874,7 +1046,7 @@ void MapComposite::initializeContent()
             std::string scriptFilename = object->getProperty("FILENAME");
             std::string scriptText = object->getProperty("TEXT");
 
-            Script *script = ScriptManager::currentState();
+            Script *script = getScript();
             Script::Context context;
             context.map = this;
 
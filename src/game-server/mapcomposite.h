@@ -27,7 +27,9 @@
 #include <map>
 
 #include "scripting/script.h"
+#include "game-server/componentpool.h"
 #include "game-server/map.h"
+#include "game-server/publicidtable.h"
 
 class Actor;
 class Being;
@@ -37,6 +39,9 @@ class MapComposite;
 class Point;
 class Rectangle;
 class Entity;
+class ItemClass;
+class SpawnAreaComponent;
+class TriggerAreaComponent;
 
 struct MapContent;
 struct MapZone;
@@ -138,7 +143,8 @@ struct MapZone
     /**
      * Objects present in this zone.
      * Characters are stored first, then the remaining MovingObjects, then the
-     * remaining Objects.
+     * remaining Objects. Every actor knows its position in there, so that
+     * inserting and removing take at most three moves, one per partition.
      */
     std::vector< Actor * > objects;
 
@@ -154,24 +160,6 @@ struct MapZone
     void remove(Actor *);
 };
 
-/**
- * Pool of public IDs for MovingObjects on a map. By maintaining public ID
- * availability using bits, it can locate an available public ID fast while
- * using minimal memory access.
- */
-struct ObjectBucket
-{
-    static int const int_bitsize = sizeof(unsigned) * 8;
-    unsigned bitmap[256 / int_bitsize]; /**< Bitmap of free locations. */
-    short free;                         /**< Number of empty places. */
-    short next_object;                  /**< Next object to look at. */
-    Actor *objects[256];
-
-    ObjectBucket();
-    int allocate();
-    void deallocate(int);
-};
-
 /**
  * Entities on a map.
  */
@@ -211,17 +199,39 @@ struct MapContent
     std::vector< Entity * > entities;
 
     /**
-     * Buckets of MovingObjects located on the map, referenced by ID.
+     * Entities that are updated every tick, all of them but the sleeping
+     * beings and the ones only having pooled components.
+     */
+    std::vector< Entity * > awake;
+
+    /**
+     * Components updated by the map in one loop per type. Entities that have
+     * no other work are not in the awake list.
      */
-    ObjectBucket *buckets[256];
+    ComponentPool< SpawnAreaComponent > spawnAreas;
+    ComponentPool< TriggerAreaComponent > triggerAreas;
 
-    int last_bucket; /**< Last bucket acted upon. */
+    /**
+     * Beings that changed position or were inserted since the trigger areas
+     * were last updated.
+     */
+    std::vector< Being * > moved;
+
+    /**
+     * MovingObjects located on the map, referenced by public ID.
+     */
+    PublicIdTable publicIds;
 
     /**
      * Partition of the Objects, depending on their position on the map.
      */
     MapZone *zones;
 
+    /**
+     * Zones with destinations, which are cleared at the next zone update.
+     */
+    std::vector< unsigned > departedZones;
+
     unsigned short mapWidth;  /**< Width with respect to zones. */
     unsigned short mapHeight; /**< Height with respect to zones. */
 };
@@ -238,14 +248,34 @@ class MapComposite
         bool readMap();
 
         /**
-         * Loads the map and initializes the map content. Should only be called
-         * once!
+         * Marks the map as hosted by this server. Should only be called once!
+         * The map content is created separately by start().
          *
          * @return <code>true</code> when succesful, <code>false</code> when
-         *         an error occurred.
+         *         the map could not be read.
          */
         bool activate();
 
+        /**
+         * Initializes the map content: creates the warps and spawn areas,
+         * runs the map initialization callback and puts back the items that
+         * were left on the floor.
+         */
+        void start();
+
+        /**
+         * Removes and deletes everything on the map, and frees the map
+         * content and its script state. The items on the floor are kept for
+         * the next start.
+         */
+        void stop();
+
+        /**
+         * Returns whether the map content is initialized.
+         */
+        bool isStarted() const
+        { return mContent; }
+
         /**
          * Gets the underlying pathfinding map.
          */
@@ -285,6 +315,29 @@ class MapComposite
          */
         void update();
 
+        /**
+         * Adds a being that was asleep back to the updated entities.
+         */
+        void wakeUp(Being *);
+
+        /**
+         * Puts an item on the floor, or keeps it for the next start when the
+         * map is not started.
+         */
+        void addFloorItem(ItemClass *itemClass, int amount, int x, int y);
+
+        /**
+         * Returns the number of characters on the map.
+         */
+        unsigned getCharacterCount() const
+        { return mCharacterCount; }
+
+        /**
+         * Returns the tick since which there are no characters on the map.
+         */
+        int getEmptySince() const
+        { return mEmptySince; }
+
         /**
          * Gets the PvP rules on the map.
          */
@@ -322,6 +375,18 @@ class MapComposite
          */
         const std::vector< Entity * > &getEverything() const;
 
+        /**
+         * Gets the beings that changed position or were inserted since the
+         * trigger areas were last updated.
+         */
+        const std::vector< Being * > &getMovedBeings() const;
+
+        /**
+         * Gets the being with the given public ID, or NULL when there is no
+         * such being on the map.
+         */
+        Being *getBeing(int publicId) const;
+
         /**
          * Gets the cached value of a map-bound script variable
          */
@@ -345,22 +410,22 @@ class MapComposite
          * Sets callback for map variable
          */
         void setMapVariableCallback(const std::string &key, Script *script)
-        { script->assignCallback(mMapVariableCallbacks[key]); }
+        { setVariableCallback(mMapVariableCallbacks[key], script); }
 
         /**
          * Sets callback for global variable
          */
         void setWorldVariableCallback(const std::string &key, Script *script)
-        { script->assignCallback(mWorldVariableCallbacks[key]); }
+        { setVariableCallback(mWorldVariableCallbacks[key], script); }
 
         void callWorldVariableCallback(const std::string &key,
                                        const std::string &value);
 
-        static void setInitializeCallback(Script *script)
-        { script->assignCallback(mInitializeCallback); }
-
-        static void setUpdateCallback(Script *script)
-        { script->assignCallback(mUpdateCallback); }
+        /**
+         * Returns the script state that runs the scripts and NPCs of this
+         * map. This is the global state, unless script_perMapStates is on.
+         */
+        Script *getScript() const;
 
         const MapObject *findMapObject(const std::string &name,
                                        const std::string &type) const;
@@ -368,7 +433,48 @@ class MapComposite
     private:
         MapComposite(const MapComposite &);
 
+        /**
+         * A variable callback, with the script state it was registered by.
+         */
+        struct VariableCallback
+        {
+            VariableCallback(): script(0) {}
+
+            Script *script;
+            Script::Ref function;
+        };
+
+        static void setVariableCallback(VariableCallback &callback,
+                                        Script *script)
+        {
+            callback.script = script;
+            script->assignCallback(callback.function);
+        }
+
+        /**
+         * An item on the floor, kept while the map is not started.
+         */
+        struct FloorItem
+        {
+            ItemClass *itemClass;
+            int amount;
+            int x, y;
+        };
+
         void initializeContent();
+
+        void createFloorItem(const FloorItem &item);
+
+        /**
+         * Wakes up the sleeping beings that could see a character in the
+         * given zone.
+         */
+        void wakeBeingsAround(unsigned zone);
+
+        /**
+         * Puts the idle beings without characters around to sleep.
+         */
+        void sleepIdleBeings();
         void callMapVariableCallback(const std::string &key,
                                      const std::string &value);
 
@@ -380,11 +486,14 @@ class MapComposite
         /** Cached persistent variables */
         std::map<std::string, std::string> mScriptVariables;
         PvPRules mPvPRules;
-        std::map<const std::string, Script::Ref> mMapVariableCallbacks;
-        std::map<const std::string, Script::Ref> mWorldVariableCallbacks;
-
-        static Script::Ref mInitializeCallback;
-        static Script::Ref mUpdateCallback;
+        bool mIdleSleep;      /**< Idle beings are put to sleep. */
+        unsigned mCharacterCount;
+        int mEmptySince;      /**< Tick the last character left. */
+        std::vector<FloorItem> mFloorItems;
+        std::map<const std::string, VariableCallback> mMapVariableCallbacks;
+        std::map<const std::string, VariableCallback> mWorldVariableCallbacks;
+
+        Script *mScript;      /**< Own script state, if any. */
 };
 
 #endif
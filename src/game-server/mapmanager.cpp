@@ -21,10 +21,14 @@
 
 #include "game-server/mapmanager.h"
 
+#include "common/configuration.h"
+#include "common/defines.h"
 #include "common/resourcemanager.h"
 #include "game-server/map.h"
 #include "game-server/mapcomposite.h"
 #include "utils/logger.h"
+#include "utils/threadpool.h"
+#include "utils/timer.h"
 #include "utils/xml.h"
 
 #include <cassert>
@@ -34,6 +38,34 @@
  */
 static MapManager::Maps maps;
 
+static bool lazyActivation;     /**< Maps are started on first use. */
+static int idleTimeout;         /**< Ticks before an empty map is stopped. */
+
+/**
+ * Reads a map on one of the threads of the pool.
+ */
+class ReadMapJob : public utils::Job
+{
+    public:
+        ReadMapJob(MapComposite *map):
+            mMap(map),
+            mResult(false)
+        {}
+
+        void run()
+        { mResult = mMap->readMap(); }
+
+        MapComposite *getMap() const
+        { return mMap; }
+
+        bool getResult() const
+        { return mResult; }
+
+    private:
+        MapComposite *mMap;
+        bool mResult;
+};
+
 const MapManager::Maps &MapManager::getMaps()
 {
     return maps;
@@ -44,6 +76,10 @@ int MapManager::initialize(const std::string &mapReferenceFile)
     // Indicates the number of maps loaded successfully
     int loadedMaps = 0;
 
+    lazyActivation = Configuration::getBoolValue("game_lazyMaps", false);
+    idleTimeout = Configuration::getValue("game_mapIdleTimeout", 300)
+                  * 1000 / WORLD_TICK_MS;
+
     XML::Document doc(mapReferenceFile);
     xmlNodePtr rootNode = doc.rootNode();
 
@@ -55,6 +91,13 @@ int MapManager::initialize(const std::string &mapReferenceFile)
     }
 
     LOG_INFO("Loading map reference: " << mapReferenceFile);
+
+    // The maps are read in parallel, libxml2 has to be set up beforehand
+    xmlInitParser();
+    const uint64_t start = utils::getTimeInMicrosec();
+    utils::ThreadPool pool(Configuration::getValue("game_mapLoadThreads", 0));
+    std::vector<ReadMapJob *> jobs;
+
     for_each_xml_child_node(node, rootNode)
     {
         if (!xmlStrEqual(node->name, BAD_CAST "map"))
@@ -80,10 +123,8 @@ int MapManager::initialize(const std::string &mapReferenceFile)
             if (mapFileExists)
             {
                 maps[id] = new MapComposite(id, name);
-                if (!maps[id]->readMap())
-                    LOG_FATAL("Failed to load map \"" << name << "\"!");
-
-                ++loadedMaps;
+                jobs.push_back(new ReadMapJob(maps[id]));
+                pool.add(jobs.back());
             }
         }
         else
@@ -100,8 +141,27 @@ int MapManager::initialize(const std::string &mapReferenceFile)
         }
     }
 
+    pool.wait();
+    for (std::vector<ReadMapJob *>::const_iterator it = jobs.begin(),
+         it_end = jobs.end(); it != it_end; ++it)
+    {
+        ReadMapJob *job = *it;
+        if (!job->getResult())
+        {
+            LOG_FATAL("Failed to load map \"" << job->getMap()->getName()
+                      << "\"!");
+        }
+
+        ++loadedMaps;
+        delete job;
+    }
+
     if (loadedMaps > 0)
-        LOG_INFO(loadedMaps << " valid map file references were loaded.");
+    {
+        LOG_INFO(loadedMaps << " valid map file references were loaded in "
+                 << (utils::getTimeInMicrosec() - start) / 1000 << " ms using "
+                 << pool.size() << " threads.");
+    }
 
     return loadedMaps;
 }
@@ -143,6 +203,9 @@ bool MapManager::activateMap(int mapId)
     {
         LOG_INFO("Activated map \"" << composite->getName()
                  << "\" (id " << mapId << ")");
+
+        if (!lazyActivation)
+            composite->start();
         return true;
     }
     else
@@ -152,3 +215,30 @@ bool MapManager::activateMap(int mapId)
         return false;
     }
 }
+
+void MapManager::startMap(MapComposite *map)
+{
+    assert(map->isActive() && !map->isStarted());
+
+    LOG_INFO("Starting map \"" << map->getName()
+             << "\" (id " << map->getID() << ")");
+    map->start();
+}
+
+void MapManager::stopIdleMaps(int tick)
+{
+    if (!lazyActivation || idleTimeout <= 0)
+        return;
+
+    for (Maps::iterator i = maps.begin(), i_end = maps.end(); i != i_end; ++i)
+    {
+        MapComposite *map = i->second;
+        if (!map->isStarted() || map->getCharacterCount() ||
+                tick - map->getEmptySince() < idleTimeout)
+            continue;
+
+        LOG_INFO("Stopping idle map \"" << map->getName()
+                 << "\" (id " << map->getID() << ")");
+        map->stop();
+    }
+}
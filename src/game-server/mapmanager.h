@@ -32,7 +32,8 @@ namespace MapManager
     typedef std::map< int, MapComposite * > Maps;
 
     /**
-     * Loads map reference file and prepares maps.
+     * Loads map reference file and prepares maps. The maps are read in
+     * parallel, on game_mapLoadThreads threads.
      * @return the number of maps loaded succesfully
      */
     int initialize(const std::string &mapReferenceFile);
@@ -60,10 +61,23 @@ namespace MapManager
     const Maps &getMaps();
 
     /**
-     * Sets the activity status of the map.
+     * Sets the activity status of the map. Unless game_lazyMaps is on, the
+     * map is started right away.
      * @return true if the activation was successful.
      */
     bool activateMap(int mapId);
+
+    /**
+     * Starts an active map that was not started yet, when something is
+     * about to happen on it.
+     */
+    void startMap(MapComposite *map);
+
+    /**
+     * Stops the started maps that have been without characters for
+     * game_mapIdleTimeout seconds, when game_lazyMaps is on.
+     */
+    void stopIdleMaps(int tick);
 }
 
 #endif // MAPMANAGER_H
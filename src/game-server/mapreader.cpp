@@ -22,6 +22,8 @@
 #include "game-server/mapreader.h"
 
 #include "common/defines.h"
+#include "common/resourcemanager.h"
+#include "game-server/compiledmap.h"
 #include "game-server/map.h"
 #include "utils/base64.h"
 #include "utils/logger.h"
@@ -31,11 +33,35 @@
 
 #include <cstring>
 
-static std::vector<unsigned> tilesetFirstGids;
-
 Map *MapReader::readMap(const std::string &filename)
 {
-    XML::Document doc(filename);
+    // Maps inside of an archive are not compiled
+    const std::string path = ResourceManager::resolve(filename);
+    CompiledMap::SourceStamp stamp;
+    if (path.empty() || !CompiledMap::getStamp(path, stamp))
+    {
+        XML::Document doc(filename);
+        return readMap(doc, filename);
+    }
+
+    const std::string compiledPath = CompiledMap::getPath(path);
+    if (Map *map = CompiledMap::read(compiledPath, stamp))
+    {
+        LOG_DEBUG("Using compiled map " << compiledPath);
+        return map;
+    }
+
+    return readTmxFile(path);
+}
+
+Map *MapReader::readTmxFile(const std::string &path)
+{
+    XML::Document doc(path, false);
+    return readMap(doc, path);
+}
+
+Map *MapReader::readMap(XML::Document &doc, const std::string &filename)
+{
     xmlNodePtr rootNode = doc.rootNode();
 
     // Parse the inflated map data.
@@ -50,6 +76,9 @@ Map *MapReader::readMap(const std::string &filename)
 
 Map *MapReader::readMap(xmlNodePtr node)
 {
+    // Local to the map being read, since maps may be read in parallel
+    std::vector<unsigned> tilesetFirstGids;
+
     int w = XML::getProperty(node, "width", 0);
     int h = XML::getProperty(node, "height", 0);
     int tileW = XML::getProperty(node, "tilewidth", DEFAULT_TILE_LENGTH);
@@ -66,8 +95,8 @@ Map *MapReader::readMap(xmlNodePtr node)
             }
             else
             {
-                ::tilesetFirstGids.push_back(XML::getProperty(node, "firstgid",
-                                                              0));
+                tilesetFirstGids.push_back(XML::getProperty(node, "firstgid",
+                                                            0));
             }
         }
         else if (xmlStrEqual(node->name, BAD_CAST "properties"))
@@ -90,7 +119,7 @@ Map *MapReader::readMap(xmlNodePtr node)
             if (utils::compareStrI(XML::getProperty(node, "name", "unnamed"),
                                    "collision") == 0)
             {
-                readLayer(node, map);
+                readLayer(node, map, tilesetFirstGids);
             }
         }
         else if (xmlStrEqual(node->name, BAD_CAST "objectgroup"))
@@ -141,13 +170,11 @@ Map *MapReader::readMap(xmlNodePtr node)
         }
     }
 
-    // Clean up tilesets
-    ::tilesetFirstGids.clear();
-
     return map;
 }
 
-void MapReader::readLayer(xmlNodePtr node, Map *map)
+void MapReader::readLayer(xmlNodePtr node, Map *map,
+                          const std::vector<unsigned> &tilesetFirstGids)
 {
     node = node->xmlChildrenNode;
     int h = map->getHeight();
@@ -235,7 +262,7 @@ void MapReader::readLayer(xmlNodePtr node, Map *map)
                     (binData[i + 2] << 16) |
                     (binData[i + 3] << 24);
 
-            setTileWithGid(map, x, y, gid);
+            setTileWithGid(map, x, y, gid, tilesetFirstGids);
 
             if (++x == w)
             {
@@ -263,7 +290,7 @@ void MapReader::readLayer(xmlNodePtr node, Map *map)
             pos = csv.find_first_of(",", oldPos);
 
             unsigned gid = atol(csv.substr(oldPos, pos - oldPos).c_str());
-            setTileWithGid(map, x, y, gid);
+            setTileWithGid(map, x, y, gid, tilesetFirstGids);
 
             x++;
             if (x == w)
@@ -290,7 +317,7 @@ void MapReader::readLayer(xmlNodePtr node, Map *map)
             if (xmlStrEqual(node->name, BAD_CAST "tile") && y < h)
             {
                 unsigned gid = XML::getProperty(node, "gid", 0);
-                setTileWithGid(map, x, y, gid);
+                setTileWithGid(map, x, y, gid, tilesetFirstGids);
 
                 if (++x == w)
                 {
@@ -332,7 +359,8 @@ int MapReader::getObjectProperty(xmlNodePtr node, int def)
     return val;
 }
 
-void MapReader::setTileWithGid(Map *map, int x, int y, unsigned gid)
+void MapReader::setTileWithGid(Map *map, int x, int y, unsigned gid,
+                               const std::vector<unsigned> &tilesetFirstGids)
 {
     // Bits on the far end of the 32-bit global tile ID are used for tile flags
     const int FlippedHorizontallyFlag   = 0x80000000;
@@ -346,8 +374,8 @@ void MapReader::setTileWithGid(Map *map, int x, int y, unsigned gid)
 
     // Find the tileset with the highest firstGid below/eq to gid
     unsigned set = gid;
-    for (std::vector<unsigned>::const_iterator i = ::tilesetFirstGids.begin(),
-         i_end = ::tilesetFirstGids.end(); i != i_end; ++i)
+    for (std::vector<unsigned>::const_iterator i = tilesetFirstGids.begin(),
+         i_end = tilesetFirstGids.end(); i != i_end; ++i)
     {
         if (gid < *i)
             break;
@@ -29,6 +29,8 @@
 
 class Map;
 
+namespace XML { class Document; }
+
 /**
  * Reader for XML map files (*.tmx)
  */
@@ -36,12 +38,25 @@ class MapReader
 {
     public:
         /**
-         * Read an XML map from a file.
+         * Read a map from the data directory. The compiled form of the map
+         * is used when it is up to date with the XML map file.
          * @return the map when successful, 0 otherwise.
+         * @see CompiledMap
          */
         static Map *readMap(const std::string &filename);
 
+        /**
+         * Read an XML map from a file outside of the data directory.
+         * @return the map when successful, 0 otherwise.
+         */
+        static Map *readTmxFile(const std::string &path);
+
     private:
+        /**
+         * Read an XML map from a parsed XML document.
+         */
+        static Map *readMap(XML::Document &doc, const std::string &filename);
+
         /**
          * Read an XML map from a parsed XML tree.
          */
@@ -50,7 +65,8 @@ class MapReader
         /**
          * Reads a map layer and adds it to the given map.
          */
-        static void readLayer(xmlNodePtr node, Map *map);
+        static void readLayer(xmlNodePtr node, Map *map,
+                              const std::vector<unsigned> &tilesetFirstGids);
 
         /**
          * Get the string value from the given object property node.
@@ -63,7 +79,9 @@ class MapReader
          */
         static int getObjectProperty(xmlNodePtr node, int def);
 
-        static void setTileWithGid(Map *map, int x, int y, unsigned gid);
+        static void setTileWithGid(
+                Map *map, int x, int y, unsigned gid,
+                const std::vector<unsigned> &tilesetFirstGids);
 };
 
 #endif
@@ -29,12 +29,19 @@
 #include "game-server/map.h"
 #include "game-server/mapcomposite.h"
 #include "game-server/state.h"
+#include "game-server/tickprofiler.h"
+#include "game-server/tickscheduler.h"
 #include "scripting/scriptmanager.h"
 #include "utils/logger.h"
 #include "utils/speedconv.h"
 
 #include <cmath>
 
+typedef std::map<MonsterClass *, std::vector<Entity *> > BatchedUpdates;
+
+/** Monsters updated on the current map, by class with a batched callback. */
+static BatchedUpdates batchedUpdates;
+
 MonsterClass::~MonsterClass()
 {
     for (std::vector<AttackInfo *>::iterator it = mAttacks.begin(),
@@ -65,15 +72,7 @@ Monster::Monster(MonsterClass *specy):
     /*
      * Initialise the attribute structures.
      */
-    const AttributeManager::AttributeScope &mobAttr =
-        attributeManager->getAttributeScope(MonsterScope);
-
-    for (AttributeManager::AttributeScope::const_iterator it = mobAttr.begin(),
-         it_end = mobAttr.end(); it != it_end; ++it)
-    {
-        mAttributes.insert(std::pair< unsigned, Attribute >
-                           (it->first, Attribute(*it->second)));
-    }
+    initializeAttributes(MonsterScope);
 
     /*
      * Set the attributes to the values defined by the associated monster
@@ -82,16 +81,16 @@ Monster::Monster(MonsterClass *specy):
 
     int mutation = specy->getMutation();
 
-    for (AttributeMap::iterator it2 = mAttributes.begin(),
-         it2_end = mAttributes.end(); it2 != it2_end; ++it2)
+    for (unsigned i = 0; i < mAttributes.size(); ++i)
     {
+        const int id = mAttributeLayout->ids[i];
         double attr = 0.0f;
 
-        if (specy->hasAttribute(it2->first))
+        if (specy->hasAttribute(id))
         {
-            attr = specy->getAttribute(it2->first);
+            attr = specy->getAttribute(id);
 
-            setAttribute(it2->first,
+            setAttribute(id,
                   mutation ?
                   attr * (100 + (rand() % (mutation * 2)) - mutation) / 100.0 :
                   attr);
@@ -142,10 +141,20 @@ void Monster::update()
 
     if (mSpecy->getUpdateCallback().isValid())
     {
-        Script *script = ScriptManager::currentState();
-        script->prepare(mSpecy->getUpdateCallback());
-        script->push(this);
-        script->execute(getMap());
+        if (mSpecy->isUpdateBatched())
+        {
+            batchedUpdates[mSpecy].push_back(this);
+        }
+        else
+        {
+            const uint64_t start = utils::getTimeInMicrosec();
+            Script *script = ScriptManager::currentState();
+            script->prepare(mSpecy->getUpdateCallback());
+            script->push(this);
+            script->execute(getMap());
+            TickProfiler::recordMonsterUpdates(1, 1,
+                    utils::getTimeInMicrosec() - start);
+        }
     }
 
     refreshTarget();
@@ -155,7 +164,8 @@ void Monster::update()
         return;
 
     // We have no target - let's wander around
-    if (mStrollTimeout.expired() && getPosition() == getDestination())
+    if (mStrollTimeout.expired() && getPosition() == getDestination() &&
+        !TickScheduler::defer(TickScheduler::WORK_STROLL))
     {
         if (mKillStealProtectedTimeout.expired())
         {
@@ -176,6 +186,47 @@ void Monster::update()
     }
 }
 
+bool Monster::isIdle() const
+{
+    // Monsters with an update callback are left to their script
+    return mAction == STAND && !mTarget && !mOwner && mStatus.empty() &&
+           getPosition() == getDestination() &&
+           !mSpecy->getUpdateCallback().isValid();
+}
+
+void Monster::dispatchBatchedUpdates(MapComposite *map)
+{
+    Script *script = ScriptManager::currentState();
+    const uint64_t dispatchStart = utils::getTimeInMicrosec();
+    bool dispatched = false;
+
+    for (BatchedUpdates::iterator it = batchedUpdates.begin(),
+         it_end = batchedUpdates.end(); it != it_end; ++it)
+    {
+        std::vector<Entity *> &monsters = it->second;
+        if (monsters.empty())
+            continue;
+
+        dispatched = true;
+        const uint64_t start = utils::getTimeInMicrosec();
+        script->prepare(it->first->getUpdateCallback());
+        script->push(monsters);
+        script->execute(map);
+        TickProfiler::recordMonsterUpdates(1, monsters.size(),
+                utils::getTimeInMicrosec() - start);
+
+        // Keep the vector around, the class is likely updated again
+        monsters.clear();
+    }
+
+    // Maps without batched monsters would only add empty samples
+    if (dispatched)
+    {
+        TickProfiler::record(TickProfiler::PHASE_SCRIPT, map->getID(),
+                             utils::getTimeInMicrosec() - dispatchStart);
+    }
+}
+
 void Monster::refreshTarget()
 {
     // We are dead and sadly not possible to keep attacking :(
@@ -342,6 +393,7 @@ void Monster::changeAnger(Actor *target, int amount)
         return;
 
     Being *being = static_cast< Being * >(target);
+    wakeUp();
 
     if (mAnger.find(being) != mAnger.end())
     {
@@ -85,7 +85,8 @@ class MonsterClass
             mStrollRange(0),
             mMutation(0),
             mAttackDistance(0),
-            mOptimalLevel(0)
+            mOptimalLevel(0),
+            mUpdateBatched(false)
         {}
 
         ~MonsterClass();
@@ -203,8 +204,16 @@ class MonsterClass
 
         double getVulnerability(Element element) const;
 
-        void setUpdateCallback(Script *script)
-        { script->assignCallback(mUpdateCallback); }
+        /**
+         * Sets the update callback. A batched callback is called once per
+         * map and tick with all the monsters of this class on the map,
+         * after they have been updated.
+         */
+        void setUpdateCallback(Script *script, bool batched = false)
+        {
+            script->assignCallback(mUpdateCallback);
+            mUpdateBatched = batched;
+        }
 
         void setDamageCallback(Script *script)
         { script->assignCallback(mDamageCallback); }
@@ -212,9 +221,23 @@ class MonsterClass
         Script::Ref getUpdateCallback() const
         { return mUpdateCallback; }
 
+        bool isUpdateBatched() const
+        { return mUpdateBatched; }
+
         Script::Ref getDamageCallback() const
         { return mDamageCallback; }
 
+        /**
+         * Takes over the script callbacks of the definition this one
+         * replaces.
+         */
+        void copyCallbacks(const MonsterClass &other)
+        {
+            mUpdateCallback = other.mUpdateCallback;
+            mUpdateBatched = other.mUpdateBatched;
+            mDamageCallback = other.mDamageCallback;
+        }
+
     private:
         unsigned short mId;
         std::string mName;
@@ -239,6 +262,7 @@ class MonsterClass
          * A reference to the script function that is called each update.
          */
         Script::Ref mUpdateCallback;
+        bool mUpdateBatched;
 
         /**
          * A reference to the script that is called when a mob takes damage.
@@ -289,8 +313,21 @@ class Monster : public Being
          */
         void update();
 
+        /**
+         * Returns whether the monster stands around without a target, an
+         * owner, status effects or an update callback.
+         */
+        bool isIdle() const;
+
         void refreshTarget();
 
+        /**
+         * Calls the batched update callbacks of the monster classes with
+         * the monsters of the given map that were updated since the last
+         * call.
+         */
+        static void dispatchBatchedUpdates(MapComposite *map);
+
         /**
          * Performs an attack
          */
@@ -41,8 +41,11 @@ void MonsterManager::reload()
 void MonsterManager::initialize()
 {
     XML::Document doc(mMonsterReferenceFile);
-    xmlNodePtr rootNode = doc.rootNode();
+    initialize(doc.rootNode());
+}
 
+void MonsterManager::initialize(xmlNodePtr rootNode)
+{
     if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "monsters"))
     {
         LOG_ERROR("Monster Manager: Error while parsing monster database ("
@@ -310,6 +313,16 @@ MonsterClass *MonsterManager::getMonsterByName(const std::string &name) const
     return mMonsterClassesByName.value(name);
 }
 
+void MonsterManager::copyCallbacks(const MonsterManager &previous)
+{
+    for (MonsterClasses::iterator i = mMonsterClasses.begin(),
+         i_end = mMonsterClasses.end(); i != i_end; ++i)
+    {
+        if (MonsterClass *monster = previous.getMonster(i->first))
+            i->second->copyCallbacks(*monster);
+    }
+}
+
 MonsterClass *MonsterManager::getMonster(int id) const
 {
     MonsterClasses::const_iterator i = mMonsterClasses.find(id);
@@ -24,6 +24,7 @@
 #include <string>
 #include <map>
 #include "utils/string.h"
+#include "utils/xml.h"
 
 class MonsterClass;
 
@@ -42,6 +43,12 @@ class MonsterManager
          */
         void initialize();
 
+        /**
+         * Loads the monsters from the root node of an already parsed
+         * reference file.
+         */
+        void initialize(xmlNodePtr rootNode);
+
         /**
          * Reloads monster reference file.
          */
@@ -52,6 +59,12 @@ class MonsterManager
          */
         void deinitialize();
 
+        /**
+         * Gives the monster classes the script callbacks of the monsters
+         * with the same id in a previously loaded database.
+         */
+        void copyCallbacks(const MonsterManager &previous);
+
         /**
          * Gets the MonsterClass having the given ID.
          */
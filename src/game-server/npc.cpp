@@ -30,17 +30,17 @@
 
 const ComponentType NpcComponent::type;
 
-NpcComponent::NpcComponent(int npcId):
+NpcComponent::NpcComponent(int npcId, Script *script):
     mNpcId(npcId),
-    mEnabled(true)
+    mEnabled(true),
+    mScript(script)
 {
 }
 
 NpcComponent::~NpcComponent()
 {
-    Script *script = ScriptManager::currentState();
-    script->unref(mTalkCallback);
-    script->unref(mUpdateCallback);
+    mScript->unref(mTalkCallback);
+    mScript->unref(mUpdateCallback);
 }
 
 void NpcComponent::setEnabled(bool enabled)
@@ -53,21 +53,20 @@ void NpcComponent::update(Entity &entity)
     if (!mEnabled || !mUpdateCallback.isValid())
         return;
 
-    Script *script = ScriptManager::currentState();
-    script->prepare(mUpdateCallback);
-    script->push(&entity);
-    script->execute(entity.getMap());
+    mScript->prepare(mUpdateCallback);
+    mScript->push(&entity);
+    mScript->execute(entity.getMap());
 }
 
 void NpcComponent::setTalkCallback(Script::Ref function)
 {
-    ScriptManager::currentState()->unref(mTalkCallback);
+    mScript->unref(mTalkCallback);
     mTalkCallback = function;
 }
 
 void NpcComponent::setUpdateCallback(Script::Ref function)
 {
-    ScriptManager::currentState()->unref(mUpdateCallback);
+    mScript->unref(mUpdateCallback);
     mUpdateCallback = function;
 }
 
@@ -79,7 +78,7 @@ static Script *prepareResume(Character *ch, Script::ThreadState expectedState)
     if (!thread || thread->mState != expectedState)
         return 0;
 
-    Script *script = ScriptManager::currentState();
+    Script *script = thread->mScript;
     script->prepareResume(thread);
     return script;
 }
@@ -88,7 +87,7 @@ void Npc::start(Being *npc, Character *ch)
 {
     NpcComponent *npcComponent = npc->getComponent<NpcComponent>();
 
-    Script *script = ScriptManager::currentState();
+    Script *script = npcComponent->getScript();
     Script::Ref talkCallback = npcComponent->getTalkCallback();
 
     if (npcComponent->isEnabled() && talkCallback.isValid())
@@ -35,7 +35,10 @@ class NpcComponent : public Component
     public:
         static const ComponentType type = CT_Npc;
 
-        NpcComponent(int npcId);
+        /**
+         * @param script the script state the callbacks belong to
+         */
+        NpcComponent(int npcId, Script *script);
 
         ~NpcComponent();
 
@@ -74,9 +77,13 @@ class NpcComponent : public Component
         int getNpcId() const
         { return mNpcId; }
 
+        Script *getScript() const
+        { return mScript; }
+
     private:
         int mNpcId;
         bool mEnabled;
+        Script *mScript;
 
         Script::Ref mTalkCallback;
         Script::Ref mUpdateCallback;
@@ -0,0 +1,65 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "game-server/publicidtable.h"
+
+#include <cassert>
+
+/* Public IDs are sent as 16 bits, and 65535 means no ID. */
+static unsigned const maxPublicIds = 65535;
+
+/* Number of deallocated IDs waiting before the oldest one is handed out
+   again. Until then, new IDs are used. */
+static unsigned const minFreeIds = 1024;
+
+PublicIdTable::PublicIdTable():
+    mActors(1, (Actor *) 0) // Skip ID 0
+{
+}
+
+int PublicIdTable::allocate(Actor *actor)
+{
+    unsigned id;
+    if (mFreeIds.size() < minFreeIds && mActors.size() < maxPublicIds)
+    {
+        id = mActors.size();
+        mActors.push_back(actor);
+    }
+    else if (!mFreeIds.empty())
+    {
+        id = mFreeIds.front();
+        mFreeIds.pop_front();
+        mActors[id] = actor;
+    }
+    else
+    {
+        return -1;
+    }
+
+    return id;
+}
+
+void PublicIdTable::deallocate(int id)
+{
+    assert(get(id));
+    mActors[id] = 0;
+    mFreeIds.push_back(id);
+}
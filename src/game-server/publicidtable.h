@@ -0,0 +1,72 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PUBLICIDTABLE_H
+#define PUBLICIDTABLE_H
+
+#include <deque>
+#include <vector>
+
+class Actor;
+
+/**
+ * Hands out the public IDs of the actors on a map, and finds the actors by
+ * their ID.
+ *
+ * Deallocated IDs are handed out again oldest first, and only once enough
+ * of them are waiting. Until then new IDs are used, so that an ID a client
+ * still refers to is rarely given to another actor.
+ */
+class PublicIdTable
+{
+    public:
+        PublicIdTable();
+
+        /**
+         * Allocates an ID for the actor. Returns -1 when all the IDs are in
+         * use.
+         */
+        int allocate(Actor *actor);
+
+        /**
+         * Frees an allocated ID.
+         */
+        void deallocate(int id);
+
+        /**
+         * Gets the actor with the given ID, or NULL when the ID is not in
+         * use.
+         */
+        Actor *get(int id) const
+        {
+            return id > 0 && (unsigned) id < mActors.size() ? mActors[id]
+                                                             : 0;
+        }
+
+    private:
+        /** Actors by ID. Only grows, up to the largest ID handed out. */
+        std::vector< Actor * > mActors;
+
+        /** Deallocated IDs, oldest first. */
+        std::deque< unsigned short > mFreeIds;
+};
+
+#endif // PUBLICIDTABLE_H
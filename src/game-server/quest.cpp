@@ -50,7 +50,15 @@ bool getQuestVar(Character *ch, const std::string &name, std::string &value)
 {
     std::map< std::string, std::string >::iterator
         i = ch->questCache.find(name);
-    if (i == ch->questCache.end()) return false;
+    if (i == ch->questCache.end())
+    {
+        if (!ch->questCacheComplete)
+            return false;
+
+        // Variables that were never set are not sent by the account server
+        value.clear();
+        return true;
+    }
     value = i->second;
     return true;
 }
@@ -81,7 +89,7 @@ void QuestRefCallback::triggerCallback(Character *ch,
     if (!mRef.isValid())
         return;
 
-    Script *s = ScriptManager::currentState();
+    Script *s = mScript;
     s->prepare(mRef);
     s->push(ch);
     s->push(mQuestName);
@@ -179,3 +187,30 @@ void recoveredQuestVar(int id,
         pendingQuests.erase(i);
     }
 }
+
+void forgetQuestCallbacks(Script *script)
+{
+    for (PendingQuests::iterator i = pendingQuests.begin(),
+         i_end = pendingQuests.end(); i != i_end; ++i)
+    {
+        PendingVariables &variables = i->second.variables;
+        for (PendingVariables::iterator j = variables.begin(),
+             j_end = variables.end(); j != j_end; ++j)
+        {
+            QuestCallbacks &callbacks = j->second;
+            for (QuestCallbacks::iterator k = callbacks.begin();
+                 k != callbacks.end();)
+            {
+                if ((*k)->getScript() == script)
+                {
+                    delete *k;
+                    k = callbacks.erase(k);
+                }
+                else
+                {
+                    ++k;
+                }
+            }
+        }
+    }
+}
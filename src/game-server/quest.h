@@ -32,11 +32,24 @@ class Script;
 class QuestCallback
 {
     public:
+        QuestCallback(Script *script) :
+            mScript(script)
+        { }
+
         virtual ~QuestCallback()
         { }
 
         virtual void triggerCallback(Character *ch,
                                      const std::string &value) const = 0;
+
+        /**
+         * Gets the script state the callback runs in.
+         */
+        Script *getScript() const
+        { return mScript; }
+
+    protected:
+        Script *mScript;
 };
 
 class QuestThreadCallback : public QuestCallback
@@ -48,8 +61,8 @@ class QuestThreadCallback : public QuestCallback
 
         QuestThreadCallback(Handler handler,
                             Script *script) :
-            mHandler(handler),
-            mScript(script)
+            QuestCallback(script),
+            mHandler(handler)
         { }
 
         void triggerCallback(Character *ch, const std::string &value) const
@@ -57,13 +70,13 @@ class QuestThreadCallback : public QuestCallback
 
     private:
         Handler mHandler;
-        Script *mScript;
 };
 
 class QuestRefCallback : public QuestCallback
 {
     public:
         QuestRefCallback(Script *script, const std::string &questName) :
+            QuestCallback(script),
             mQuestName(questName)
         { script->assignCallback(mRef); }
 
@@ -75,7 +88,8 @@ class QuestRefCallback : public QuestCallback
 };
 
 /**
- * Gets the value associated to a quest variable.
+ * Gets the value associated to a quest variable. Once the account server sent
+ * all the variables of the character, this always succeeds.
  * @return false if no value was in cache.
  */
 bool getQuestVar(Character *, const std::string &name, std::string &value);
@@ -98,4 +112,10 @@ void recoverQuestVar(Character *, const std::string &name, QuestCallback *);
 void recoveredQuestVar(int id, const std::string &name,
                        const std::string &value);
 
+/**
+ * Deletes the pending callbacks that run in the given script state. Called
+ * before the state is destroyed.
+ */
+void forgetQuestCallbacks(Script *script);
+
 #endif
@@ -22,7 +22,9 @@
 
 #include "game-server/mapcomposite.h"
 #include "game-server/monster.h"
+#include "game-server/monstermanager.h"
 #include "game-server/state.h"
+#include "game-server/tickscheduler.h"
 #include "utils/logger.h"
 
 const ComponentType SpawnAreaComponent::type;
@@ -45,7 +47,8 @@ void SpawnAreaComponent::update(Entity &entity)
     if (mNextSpawn > 0)
         mNextSpawn--;
 
-    if (mNextSpawn == 0 && mNumBeings < mMaxBeings && mSpawnRate > 0)
+    if (mNextSpawn == 0 && mNumBeings < mMaxBeings && mSpawnRate > 0 &&
+        !TickScheduler::defer(TickScheduler::WORK_SPAWN))
     {
         MapComposite *map = entity.getMap();
         const Map *realMap = map->getMap();
@@ -67,6 +70,10 @@ void SpawnAreaComponent::update(Entity &entity)
         const int width = mZone.w;
         const int height = mZone.h;
 
+        // Spawn the current definition when the monsters were reloaded
+        if (MonsterClass *specy = monsterManager->getMonster(mSpecy->getId()))
+            mSpecy = specy;
+
         Being *being = new Monster(mSpecy);
 
         if (being->getModifiedAttribute(ATTR_MAX_HP) <= 0)
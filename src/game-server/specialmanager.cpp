@@ -93,10 +93,13 @@ void SpecialManager::readSpecialNode(xmlNodePtr specialNode,
 
 void SpecialManager::initialize()
 {
-    clear();
-
     XML::Document doc(mSpecialFile);
-    xmlNodePtr rootNode = doc.rootNode();
+    initialize(doc.rootNode());
+}
+
+void SpecialManager::initialize(xmlNodePtr rootNode)
+{
+    clear();
 
     if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "specials"))
     {
@@ -170,6 +173,26 @@ const std::string SpecialManager::getSetName(int id) const
     return it != mSpecialsInfo.end() ? it->second->setName : "";
 }
 
+void SpecialManager::reload()
+{
+    initialize();
+}
+
+void SpecialManager::copyCallbacks(const SpecialManager &previous)
+{
+    for (SpecialsInfo::iterator it = mSpecialsInfo.begin(),
+         it_end = mSpecialsInfo.end(); it != it_end; ++it)
+    {
+        SpecialsInfo::const_iterator old =
+                previous.mSpecialsInfo.find(it->first);
+        if (old == previous.mSpecialsInfo.end())
+            continue;
+
+        it->second->rechargedCallback = old->second->rechargedCallback;
+        it->second->useCallback = old->second->useCallback;
+    }
+}
+
 SpecialManager::SpecialInfo *SpecialManager::getSpecialInfo(int id)
 {
     SpecialsInfo::const_iterator it = mSpecialsInfo.find(id);
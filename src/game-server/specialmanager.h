@@ -71,11 +71,23 @@ public:
      */
     void initialize();
 
+    /**
+     * Loads the specials from the root node of an already parsed reference
+     * file.
+     */
+    void initialize(xmlNodePtr rootNode);
+
     /**
      * Reloads special reference file.
      */
     void reload();
 
+    /**
+     * Gives the specials the script callbacks of the specials with the
+     * same id in a previously loaded database.
+     */
+    void copyCallbacks(const SpecialManager &previous);
+
     /**
      * Gets the specials Id from a set and a special string.
      */
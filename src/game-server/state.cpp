@@ -32,6 +32,9 @@
 #include "game-server/mapmanager.h"
 #include "game-server/monster.h"
 #include "game-server/npc.h"
+#include "game-server/tickprofiler.h"
+#include "game-server/tickscheduler.h"
+#include "game-server/timerwheel.h"
 #include "game-server/trade.h"
 #include "net/messageout.h"
 #include "scripting/script.h"
@@ -64,6 +67,11 @@ typedef std::map< Actor *, DelayedEvent > DelayedEvents;
  */
 static int currentTick;
 
+/**
+ * Timers of the game world, such as the expiry of attribute modifiers.
+ */
+static TimerWheel timerWheel;
+
 /**
  * List of delayed events.
  */
@@ -124,6 +132,16 @@ static void serializeLooks(Character *ch, MessageOut &msg)
     }
 }
 
+/**
+ * Writes a position relative to the previous one, as compact clients expect.
+ */
+static void writePositionDelta(MessageOut &msg, Point &ref, const Point &pos)
+{
+    msg.writeVarInt(pos.x - ref.x);
+    msg.writeVarInt(pos.y - ref.y);
+    ref = pos;
+}
+
 /**
  * Informs a player of what happened around the character.
  */
@@ -135,6 +153,10 @@ static void informPlayer(MapComposite *map, Character *p)
     int pid = p->getPublicID(), pflags = p->getUpdateFlags();
     int visualRange = Configuration::getValue("game_visualRange", 448);
 
+    GameClient *client = p->getClient();
+    const bool compact = client->encoding & ENCODING_COMPACT;
+    int lastMoveId = 0, lastDamageId = 0;
+
     // Inform client about activities of other beings near its character
     for (BeingIterator it(map->getAroundBeingIterator(p, visualRange));
          it; ++it)
@@ -222,8 +244,17 @@ static void informPlayer(MapComposite *map, Character *p)
                 for (Hits::const_iterator j = hits.begin(),
                      j_end = hits.end(); j != j_end; ++j)
                 {
-                    damageMsg.writeInt16(oid);
-                    damageMsg.writeInt16(*j);
+                    if (compact)
+                    {
+                        damageMsg.writeVarInt(oid - lastDamageId);
+                        damageMsg.writeVarInt(*j);
+                        lastDamageId = oid;
+                    }
+                    else
+                    {
+                        damageMsg.writeInt16(oid);
+                        damageMsg.writeInt16(*j);
+                    }
                 }
             }
 
@@ -240,6 +271,7 @@ static void informPlayer(MapComposite *map, Character *p)
             MessageOut leaveMsg(GPMSG_BEING_LEAVE);
             leaveMsg.writeInt16(oid);
             gameHandler->sendTo(p, leaveMsg);
+            client->sentPositions.erase(oid);
             continue;
         }
 
@@ -284,6 +316,7 @@ static void informPlayer(MapComposite *map, Character *p)
                     break;
             }
             gameHandler->sendTo(p, enterMsg);
+            client->sentPositions[oid] = opos;
         }
 
         if (opos != oold)
@@ -296,18 +329,37 @@ static void informPlayer(MapComposite *map, Character *p)
         }
 
         // Send move messages.
-        moveMsg.writeInt16(oid);
-        moveMsg.writeInt8(flags);
-        if (flags & MOVING_POSITION)
+        if (compact)
         {
-            moveMsg.writeInt16(oold.x);
-            moveMsg.writeInt16(oold.y);
+            moveMsg.writeVarInt(oid - lastMoveId);
+            moveMsg.writeInt8(flags);
+            lastMoveId = oid;
+
+            Point &ref = client->sentPositions[oid];
+            if (flags & MOVING_POSITION)
+                writePositionDelta(moveMsg, ref, oold);
+            if (flags & MOVING_DESTINATION)
+                writePositionDelta(moveMsg, ref, opos);
+        }
+        else
+        {
+            moveMsg.writeInt16(oid);
+            moveMsg.writeInt8(flags);
+            if (flags & MOVING_POSITION)
+            {
+                moveMsg.writeInt16(oold.x);
+                moveMsg.writeInt16(oold.y);
+            }
+
+            if (flags & MOVING_DESTINATION)
+            {
+                moveMsg.writeInt16(opos.x);
+                moveMsg.writeInt16(opos.y);
+            }
         }
 
         if (flags & MOVING_DESTINATION)
         {
-            moveMsg.writeInt16(opos.x);
-            moveMsg.writeInt16(opos.y);
             // We multiply the sent speed (in tiles per second) by ten
             // to get it within a byte with decimal precision.
             // For instance, a value of 4.5 will be sent as 45.
@@ -352,6 +404,7 @@ static void informPlayer(MapComposite *map, Character *p)
 
     // Inform client about items on the ground around its character
     MessageOut itemMsg(GPMSG_ITEMS);
+    Point lastItemPos(0, 0);
     for (FixedActorIterator it(map->getAroundBeingIterator(p, visualRange));
          it; ++it)
     {
@@ -387,9 +440,19 @@ static void informPlayer(MapComposite *map, Character *p)
                     }
                     else
                     {
-                        itemMsg.writeInt16(willBeInRange ? itemClass->getDatabaseID() : 0);
-                        itemMsg.writeInt16(opos.x);
-                        itemMsg.writeInt16(opos.y);
+                        int itemId = willBeInRange ?
+                                itemClass->getDatabaseID() : 0;
+                        if (compact)
+                        {
+                            itemMsg.writeVarInt(itemId);
+                            writePositionDelta(itemMsg, lastItemPos, opos);
+                        }
+                        else
+                        {
+                            itemMsg.writeInt16(itemId);
+                            itemMsg.writeInt16(opos.x);
+                            itemMsg.writeInt16(opos.y);
+                        }
                     }
                 }
                 break;
@@ -438,7 +501,16 @@ void GameState::update(int tick)
     dbgLockObjects = true;
 #endif
 
-    ScriptManager::currentState()->update();
+    {
+        TickProfiler::ScopedTimer timer(TickProfiler::PHASE_SCRIPT);
+        ScriptManager::currentState()->update();
+        ScriptManager::deliverMapMessages();
+    }
+
+    {
+        TickProfiler::ScopedTimer timer(TickProfiler::PHASE_ENTITIES);
+        timerWheel.advance(tick);
+    }
 
     // Update game state (update AI, etc.)
     const MapManager::Maps &maps = MapManager::getMaps();
@@ -446,16 +518,27 @@ void GameState::update(int tick)
          m_end = maps.end(); m != m_end; ++m)
     {
         MapComposite *map = m->second;
-        if (!map->isActive())
+        if (!map->isStarted())
             continue;
 
-        map->update();
+        {
+            TickProfiler::ScopedTimer timer(TickProfiler::PHASE_MAP,
+                                            map->getID());
+            map->update();
+        }
 
-        for (CharacterIterator p(map->getWholeMapIterator()); p; ++p)
         {
-            informPlayer(map, *p);
+            TickProfiler::ScopedTimer timer(TickProfiler::PHASE_INFORM,
+                                            map->getID());
+            for (CharacterIterator p(map->getWholeMapIterator()); p; ++p)
+            {
+                informPlayer(map, *p);
+            }
         }
 
+        // Start deferring work on the next maps once a budget is exceeded
+        TickScheduler::checkBudgets();
+
         for (ActorIterator it(map->getWholeMapIterator()); it; ++it)
         {
             Actor *a = *it;
@@ -472,6 +555,7 @@ void GameState::update(int tick)
 #   endif
 
     // Take care of events that were delayed because of their side effects.
+    TickProfiler::ScopedTimer timer(TickProfiler::PHASE_DELAYED);
     for (DelayedEvents::iterator it = delayedEvents.begin(),
          it_end = delayedEvents.end(); it != it_end; ++it)
     {
@@ -501,6 +585,8 @@ void GameState::update(int tick)
         }
     }
     delayedEvents.clear();
+
+    MapManager::stopIdleMaps(tick);
 }
 
 bool GameState::insert(Entity *ptr)
@@ -509,6 +595,9 @@ bool GameState::insert(Entity *ptr)
     MapComposite *map = ptr->getMap();
     assert(map && map->isActive());
 
+    if (!map->isStarted())
+        MapManager::startMap(map);
+
     /* Non-visible objects have neither position nor public ID, so their
        insertion cannot fail. Take care of them first. */
     if (!ptr->isVisible())
@@ -600,6 +689,11 @@ int GameState::getCurrentTick()
     return currentTick;
 }
 
+TimerWheel &GameState::getTimerWheel()
+{
+    return timerWheel;
+}
+
 bool GameState::insertOrDelete(Entity *ptr)
 {
     if (insert(ptr)) return true;
@@ -653,16 +747,22 @@ void GameState::remove(Entity *ptr)
     {
         if (ptr->getType() == OBJECT_CHARACTER)
         {
-            static_cast< Character * >(ptr)->cancelTransaction();
+            Character *character = static_cast< Character * >(ptr);
+            character->cancelTransaction();
+
+            // The beings around it will be entered again on the next map
+            if (GameClient *client = character->getClient())
+                client->sentPositions.clear();
 
             // remove characters online status
-            accountHandler->updateOnlineStatus(
-                static_cast< Character * >(ptr)->getDatabaseID(), false);
+            accountHandler->updateOnlineStatus(character->getDatabaseID(),
+                                               false);
         }
 
         Actor *obj = static_cast< Actor * >(ptr);
+        const int publicId = obj->getPublicID();
         MessageOut msg(GPMSG_BEING_LEAVE);
-        msg.writeInt16(obj->getPublicID());
+        msg.writeInt16(publicId);
         Point objectPos = obj->getPosition();
 
         for (CharacterIterator p(map->getAroundActorIterator(obj, visualRange));
@@ -673,6 +773,10 @@ void GameState::remove(Entity *ptr)
             {
                 gameHandler->sendTo(*p, msg);
             }
+
+            // The ID may be handed out again to another being
+            if (GameClient *client = (*p)->getClient())
+                client->sentPositions.erase(publicId);
         }
     }
     else if (ptr->getType() == OBJECT_ITEM)
@@ -30,6 +30,7 @@ class Character;
 class Entity;
 class ItemClass;
 class MapComposite;
+class TimerWheel;
 
 namespace GameState
 {
@@ -40,6 +41,12 @@ namespace GameState
 
     int getCurrentTick();
 
+    /**
+     * Returns the wheel of the timers that run at the start of a tick, after
+     * the script update and before the maps are updated.
+     */
+    TimerWheel &getTimerWheel();
+
     /**
      * Inserts an entity in the game world.
      * @return false if the insertion failed and the entity is in limbo.
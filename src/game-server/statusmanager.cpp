@@ -28,12 +28,16 @@
 #include <map>
 #include <set>
 #include <sstream>
+#include <vector>
 
 typedef std::map< int, StatusEffect * > StatusEffectsMap;
 static StatusEffectsMap statusEffects;
 static utils::NameMap<StatusEffect*> statusEffectsByName;
 static std::string statusReferenceFile;
 
+/** Status effects removed by a reload, which beings may still refer to. */
+static std::vector<StatusEffect *> retiredEffects;
+
 void StatusManager::initialize(const std::string &file)
 {
     statusReferenceFile = file;
@@ -43,8 +47,11 @@ void StatusManager::initialize(const std::string &file)
 void StatusManager::reload()
 {
     XML::Document doc(statusReferenceFile);
-    xmlNodePtr rootNode = doc.rootNode();
+    reload(doc.rootNode());
+}
 
+void StatusManager::reload(xmlNodePtr rootNode)
+{
     if (!rootNode || !xmlStrEqual(rootNode->name, BAD_CAST "status-effects"))
     {
         LOG_ERROR("Status Manager: Error while parsing status database ("
@@ -53,6 +60,13 @@ void StatusManager::reload()
     }
 
     LOG_INFO("Loading status reference: " << statusReferenceFile);
+
+    // Existing status effects are kept, so that the beings affected by them
+    // and their script callbacks stay valid
+    StatusEffectsMap previousEffects;
+    previousEffects.swap(statusEffects);
+    statusEffectsByName.clear();
+
     for_each_xml_child_node(node, rootNode)
     {
         if (!xmlStrEqual(node->name, BAD_CAST "status-effect"))
@@ -67,7 +81,17 @@ void StatusManager::reload()
             continue;
         }
 
-        StatusEffect *statusEffect = new StatusEffect(id);
+        StatusEffect *statusEffect;
+        StatusEffectsMap::iterator previous = previousEffects.find(id);
+        if (previous != previousEffects.end())
+        {
+            statusEffect = previous->second;
+            previousEffects.erase(previous);
+        }
+        else
+        {
+            statusEffect = new StatusEffect(id);
+        }
 
         const std::string name = XML::getProperty(node, "name",
                                                   std::string());
@@ -100,6 +124,12 @@ void StatusManager::reload()
 
         statusEffects[id] = statusEffect;
     }
+
+    for (StatusEffectsMap::iterator i = previousEffects.begin(),
+         i_end = previousEffects.end(); i != i_end; ++i)
+    {
+        retiredEffects.push_back(i->second);
+    }
 }
 
 void StatusManager::deinitialize()
@@ -111,6 +141,13 @@ void StatusManager::deinitialize()
     }
     statusEffects.clear();
     statusEffectsByName.clear();
+
+    for (std::vector<StatusEffect *>::iterator i = retiredEffects.begin(),
+         i_end = retiredEffects.end(); i != i_end; ++i)
+    {
+        delete *i;
+    }
+    retiredEffects.clear();
 }
 
 StatusEffect *StatusManager::getStatus(int statusId)
@@ -23,6 +23,8 @@
 
 #include <string>
 
+#include "utils/xml.h"
+
 class StatusEffect;
 
 namespace StatusManager
@@ -37,6 +39,12 @@ namespace StatusManager
      */
     void reload();
 
+    /**
+     * Reloads the status effects from the root node of an already parsed
+     * reference file.
+     */
+    void reload(xmlNodePtr rootNode);
+
     /**
      * Destroy status classes.
      */
@@ -0,0 +1,237 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/tickprofiler.h"
+
+#include "common/configuration.h"
+#include "game-server/mapcomposite.h"
+#include "game-server/mapmanager.h"
+#include "game-server/tickscheduler.h"
+#include "utils/logger.h"
+#include "utils/percentiles.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <vector>
+
+/** Number of ticks kept in the rolling windows, one minute. */
+static const unsigned WINDOW = 600;
+
+static const char *phaseNames[TickProfiler::PHASE_COUNT] =
+{
+    "tick",
+    "account",
+    "network",
+    "script",
+    "map",
+    "entities",
+    "inform",
+    "delayed",
+    "flush"
+};
+
+typedef std::vector<utils::RollingPercentiles> PhaseTimes;
+
+/** Durations of the whole server, a total per tick. */
+static PhaseTimes serverTimes(TickProfiler::PHASE_COUNT,
+                              utils::RollingPercentiles(WINDOW));
+
+/** Durations of every map. */
+static std::map<int, PhaseTimes> mapTimes;
+
+/** Totals of the current tick. */
+static int tickTotals[TickProfiler::PHASE_COUNT];
+
+/** Monster update callbacks since the start. */
+static uint64_t monsterUpdateCalls;
+static uint64_t monsterUpdateMonsters;
+static uint64_t monsterUpdateTime;
+
+struct SlowScript
+{
+    SlowScript(): calls(0), time(0), max(0) {}
+
+    unsigned calls;
+    uint64_t time;
+    int max;
+};
+
+/** Slow script calls since the start, by source location. */
+static std::map<std::string, SlowScript> slowScripts;
+
+static std::string dumpFile;
+static int dumpInterval;                    /**< In ticks. */
+
+void TickProfiler::initialize()
+{
+    dumpFile = Configuration::getValue("log_profileFile", std::string());
+    dumpInterval = 10 * Configuration::getValue("log_profileInterval", 60);
+
+    if (!dumpFile.empty())
+        LOG_INFO("Using profile file: " << dumpFile);
+}
+
+void TickProfiler::record(Phase phase, int mapId, int time)
+{
+    tickTotals[phase] += time;
+
+    if (mapId)
+    {
+        std::map<int, PhaseTimes>::iterator it = mapTimes.find(mapId);
+        if (it == mapTimes.end())
+        {
+            it = mapTimes.insert(std::make_pair(mapId,
+                    PhaseTimes(PHASE_COUNT,
+                               utils::RollingPercentiles(WINDOW)))).first;
+        }
+        it->second[phase].add(time);
+    }
+}
+
+int TickProfiler::getTickTotal(Phase phase)
+{
+    return tickTotals[phase];
+}
+
+void TickProfiler::endTick(int tick)
+{
+    for (int i = 0; i < PHASE_COUNT; ++i)
+    {
+        serverTimes[i].add(tickTotals[i]);
+        tickTotals[i] = 0;
+    }
+
+    if (!dumpFile.empty() && dumpInterval > 0 && tick % dumpInterval == 0)
+    {
+        std::ofstream os(dumpFile.c_str());
+        dump(os);
+    }
+}
+
+const utils::RollingPercentiles *TickProfiler::getTimes(Phase phase,
+                                                        int mapId)
+{
+    if (!mapId)
+        return &serverTimes[phase];
+
+    std::map<int, PhaseTimes>::const_iterator it = mapTimes.find(mapId);
+    return it != mapTimes.end() ? &it->second[phase] : 0;
+}
+
+const char *TickProfiler::getPhaseName(Phase phase)
+{
+    return phaseNames[phase];
+}
+
+void TickProfiler::recordMonsterUpdates(int calls, int monsters, int time)
+{
+    monsterUpdateCalls += calls;
+    monsterUpdateMonsters += monsters;
+    monsterUpdateTime += time;
+}
+
+void TickProfiler::getMonsterUpdateAverages(double &time, double &monsters)
+{
+    if (!monsterUpdateCalls)
+    {
+        time = monsters = 0;
+        return;
+    }
+
+    time = double(monsterUpdateTime) / monsterUpdateCalls;
+    monsters = double(monsterUpdateMonsters) / monsterUpdateCalls;
+}
+
+void TickProfiler::recordSlowScript(const std::string &source, int time)
+{
+    SlowScript &slowScript = slowScripts[source];
+    ++slowScript.calls;
+    slowScript.time += time;
+    slowScript.max = std::max(slowScript.max, time);
+}
+
+/**
+ * Escapes a string for an attribute value of the dump.
+ */
+static std::string escape(const std::string &s)
+{
+    std::string escaped;
+    escaped.reserve(s.size());
+    for (std::string::const_iterator it = s.begin(), it_end = s.end();
+         it != it_end; ++it)
+    {
+        switch (*it)
+        {
+            case '&': escaped += "&amp;"; break;
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '"': escaped += "&quot;"; break;
+            default: escaped += *it; break;
+        }
+    }
+    return escaped;
+}
+
+static void dumpPhases(std::ostream &os, const PhaseTimes &times)
+{
+    for (int i = 0; i < TickProfiler::PHASE_COUNT; ++i)
+    {
+        const utils::RollingPercentiles &t = times[i];
+        if (t.size() == 0)
+            continue;
+
+        os << "<phase name=\"" << phaseNames[i]
+           << "\" p50=\"" << t.percentile(50)
+           << "\" p99=\"" << t.percentile(99)
+           << "\" max=\"" << t.max() << "\"/>\n";
+    }
+}
+
+void TickProfiler::dump(std::ostream &os)
+{
+    os << "<profile>\n";
+    dumpPhases(os, serverTimes);
+
+    for (std::map<int, PhaseTimes>::const_iterator it = mapTimes.begin(),
+         it_end = mapTimes.end(); it != it_end; ++it)
+    {
+        os << "<map id=\"" << it->first << "\"";
+        if (MapComposite *map = MapManager::getMap(it->first))
+            os << " name=\"" << escape(map->getName()) << "\"";
+        os << ">\n";
+        dumpPhases(os, it->second);
+        os << "</map>\n";
+    }
+    os << "<monsterupdates calls=\"" << monsterUpdateCalls
+       << "\" monsters=\"" << monsterUpdateMonsters
+       << "\" time=\"" << monsterUpdateTime << "\"/>\n";
+    for (std::map<std::string, SlowScript>::const_iterator
+         it = slowScripts.begin(), it_end = slowScripts.end();
+         it != it_end; ++it)
+    {
+        os << "<slowscript source=\"" << escape(it->first)
+           << "\" calls=\"" << it->second.calls
+           << "\" time=\"" << it->second.time
+           << "\" max=\"" << it->second.max << "\"/>\n";
+    }
+    TickScheduler::dump(os);
+    os << "</profile>\n";
+}
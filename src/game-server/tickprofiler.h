@@ -0,0 +1,130 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TICKPROFILER_H
+#define TICKPROFILER_H
+
+#include <iosfwd>
+#include <string>
+
+#include "utils/timer.h"
+
+namespace utils { class RollingPercentiles; }
+
+/**
+ * Measures how long the phases of the world tick take, over the last
+ * minute, for the whole server and for every map.
+ *
+ * The phases of a map nest: its map update includes its entity updates and
+ * its script callback. The server wide value of a phase is the sum of that
+ * phase over all maps during a tick.
+ */
+namespace TickProfiler
+{
+    enum Phase
+    {
+        PHASE_TICK,         /**< The whole tick. */
+        PHASE_ACCOUNT,      /**< Messages from the account server. */
+        PHASE_NETWORK,      /**< Messages from the clients. */
+        PHASE_SCRIPT,       /**< Script update and map callbacks. */
+        PHASE_MAP,          /**< MapComposite::update(). */
+        PHASE_ENTITIES,     /**< Entity::update() of every entity. */
+        PHASE_INFORM,       /**< Informing the characters of changes. */
+        PHASE_DELAYED,      /**< Delayed insertions, removals and warps. */
+        PHASE_FLUSH,        /**< Sending the queued messages. */
+        PHASE_COUNT
+    };
+
+    /**
+     * Reads the dump file and interval from the configuration.
+     */
+    void initialize();
+
+    /**
+     * Adds the given duration, in microseconds, to a phase of the current
+     * tick. A map id of 0 means the phase is not specific to a map.
+     */
+    void record(Phase phase, int mapId, int time);
+
+    /**
+     * Returns the time spent so far in a phase during the current tick.
+     */
+    int getTickTotal(Phase phase);
+
+    /**
+     * Adds the totals of the current tick to the rolling windows, and
+     * writes the dump file when it is due.
+     */
+    void endTick(int tick);
+
+    /**
+     * Returns the durations of a phase, server wide or for the given map.
+     * Returns NULL when nothing was recorded yet for that map.
+     */
+    const utils::RollingPercentiles *getTimes(Phase phase, int mapId = 0);
+
+    const char *getPhaseName(Phase phase);
+
+    /**
+     * Counts the calls made to monster update callbacks, the number of
+     * monsters they were given and the time they took, in microseconds.
+     */
+    void recordMonsterUpdates(int calls, int monsters, int time);
+
+    /**
+     * Returns the average duration of a monster update callback and the
+     * average number of monsters per call.
+     */
+    void getMonsterUpdateAverages(double &time, double &monsters);
+
+    /**
+     * Counts a script call that ran longer than the slow call threshold,
+     * with the source location where it was found to be slow.
+     */
+    void recordSlowScript(const std::string &source, int time);
+
+    /**
+     * Writes the p50, p99 and max of all the phases, in microseconds.
+     */
+    void dump(std::ostream &os);
+
+    /**
+     * Records the time spent between its construction and destruction.
+     */
+    class ScopedTimer
+    {
+        public:
+            ScopedTimer(Phase phase, int mapId = 0):
+                mPhase(phase),
+                mMapId(mapId),
+                mStart(utils::getTimeInMicrosec())
+            {}
+
+            ~ScopedTimer()
+            { record(mPhase, mMapId, utils::getTimeInMicrosec() - mStart); }
+
+        private:
+            Phase mPhase;
+            int mMapId;
+            uint64_t mStart;
+    };
+}
+
+#endif // TICKPROFILER_H
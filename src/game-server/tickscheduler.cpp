@@ -0,0 +1,195 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/tickscheduler.h"
+
+#include "common/configuration.h"
+#include "common/defines.h"
+#include "game-server/tickprofiler.h"
+#include "utils/logger.h"
+#include "utils/timer.h"
+
+#include <algorithm>
+#include <ostream>
+#include <sstream>
+
+static const char *workNames[TickScheduler::WORK_COUNT] =
+{
+    "spawn",
+    "trigger",
+    "stroll",
+    "sync"
+};
+
+static int maxCatchUp;          /**< Ticks run back to back at most. */
+static int maxDeferTicks;       /**< Ticks work is deferred in a row at most. */
+static int idleShare;           /**< Percentage of the idle time handed out. */
+
+/** Time budget of every phase in microseconds, 0 for none. */
+static int budgets[TickProfiler::PHASE_COUNT];
+
+static int currentTick;
+static uint64_t tickStart;
+static bool shedding;           /**< Deferring work in the current tick. */
+static bool overBudget;         /**< The previous tick exceeded its budget. */
+static bool idleUsed;           /**< The idle budget was handed out. */
+
+/** First tick of the current run of deferrals of every work. */
+static int deferredSince[TickScheduler::WORK_COUNT];
+static bool deferring[TickScheduler::WORK_COUNT];
+
+static unsigned deferredCount[TickScheduler::WORK_COUNT];
+static unsigned overruns;       /**< Ticks that took longer than a tick. */
+static unsigned caughtUp;       /**< Ticks run late, back to back. */
+static unsigned skipped;        /**< Ticks dropped beyond the catch-up. */
+
+void TickScheduler::initialize()
+{
+    maxCatchUp = std::max(1, Configuration::getValue("game_maxCatchUpTicks",
+                                                     10));
+    maxDeferTicks = Configuration::getValue("game_maxDeferTicks", 20);
+    idleShare = Configuration::getValue("game_idleShare", 50);
+
+    for (int i = 0; i < TickProfiler::PHASE_COUNT; ++i)
+    {
+        TickProfiler::Phase phase = static_cast<TickProfiler::Phase>(i);
+        budgets[i] = Configuration::getValue(
+                std::string("game_budget_") + TickProfiler::getPhaseName(phase),
+                0);
+    }
+
+    // Leave some room for the network when no tick budget is given
+    if (!budgets[TickProfiler::PHASE_TICK])
+        budgets[TickProfiler::PHASE_TICK] = WORLD_TICK_MS * 800;
+}
+
+int TickScheduler::ticksToRun(int elapsedTicks)
+{
+    if (elapsedTicks > maxCatchUp)
+    {
+        LOG_WARN("Skipping " << elapsedTicks - maxCatchUp << " ticks.");
+        skipped += elapsedTicks - maxCatchUp;
+        elapsedTicks = maxCatchUp;
+    }
+
+    caughtUp += elapsedTicks - 1;
+    return elapsedTicks;
+}
+
+void TickScheduler::beginTick(int tick, bool catchingUp)
+{
+    currentTick = tick;
+    tickStart = utils::getTimeInMicrosec();
+    shedding = catchingUp || overBudget;
+    idleUsed = false;
+}
+
+void TickScheduler::endTick(int duration)
+{
+    if (duration > WORLD_TICK_MS * 1000)
+        ++overruns;
+
+    overBudget = duration > budgets[TickProfiler::PHASE_TICK];
+}
+
+int TickScheduler::getIdleBudget()
+{
+    if (idleUsed)
+        return 0;
+
+    idleUsed = true;
+    const int elapsed = utils::getTimeInMicrosec() - tickStart;
+    const int idle = std::max(0, WORLD_TICK_MS * 1000 - elapsed);
+    return idle / 100 * idleShare;
+}
+
+void TickScheduler::checkBudgets()
+{
+    if (shedding)
+        return;
+
+    const int elapsed = utils::getTimeInMicrosec() - tickStart;
+    if (elapsed > budgets[TickProfiler::PHASE_TICK])
+    {
+        shedding = true;
+        return;
+    }
+
+    for (int i = TickProfiler::PHASE_TICK + 1; i < TickProfiler::PHASE_COUNT;
+         ++i)
+    {
+        TickProfiler::Phase phase = static_cast<TickProfiler::Phase>(i);
+        if (budgets[i] && TickProfiler::getTickTotal(phase) > budgets[i])
+        {
+            shedding = true;
+            return;
+        }
+    }
+}
+
+bool TickScheduler::defer(Work work)
+{
+    if (!shedding)
+    {
+        deferring[work] = false;
+        return false;
+    }
+
+    if (!deferring[work] || currentTick - deferredSince[work] > maxDeferTicks)
+    {
+        deferring[work] = true;
+        deferredSince[work] = currentTick;
+    }
+
+    // Let the work through for a whole tick once in a while
+    if (currentTick - deferredSince[work] >= maxDeferTicks)
+        return false;
+
+    ++deferredCount[work];
+    return true;
+}
+
+const char *TickScheduler::getWorkName(Work work)
+{
+    return workNames[work];
+}
+
+void TickScheduler::dump(std::ostream &os)
+{
+    os << "<scheduler overruns=\"" << overruns
+       << "\" caughtup=\"" << caughtUp
+       << "\" skipped=\"" << skipped << "\">\n";
+    for (int i = 0; i < WORK_COUNT; ++i)
+    {
+        os << "<deferred work=\"" << workNames[i]
+           << "\" count=\"" << deferredCount[i] << "\"/>\n";
+    }
+    os << "</scheduler>\n";
+}
+
+std::string TickScheduler::summary()
+{
+    std::ostringstream os;
+    os << "overruns: " << overruns << ", caught up: " << caughtUp
+       << ", skipped: " << skipped << ", deferred:";
+    for (int i = 0; i < WORK_COUNT; ++i)
+        os << " " << workNames[i] << " " << deferredCount[i];
+    return os.str();
+}
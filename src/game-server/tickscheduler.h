@@ -0,0 +1,105 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TICKSCHEDULER_H
+#define TICKSCHEDULER_H
+
+#include <iosfwd>
+#include <string>
+
+/**
+ * Keeps the world simulation at a fixed step when the server falls behind.
+ *
+ * Instead of dropping the ticks that were missed, a bounded number of them
+ * is run back to back. While catching up, or once a tick exceeds one of its
+ * time budgets, work that can wait a little is deferred to a later tick.
+ * Work is never deferred for more than a configured number of ticks in a
+ * row, so that it still makes progress under sustained load.
+ */
+namespace TickScheduler
+{
+    /**
+     * Work that may be deferred to a later tick.
+     */
+    enum Work
+    {
+        WORK_SPAWN,         /**< Spawning monsters in spawn areas. */
+        WORK_TRIGGER,       /**< Checking the beings inside trigger areas. */
+        WORK_STROLL,        /**< Picking a stroll destination for monsters. */
+        WORK_SYNC,          /**< Periodic sync with the account server. */
+        WORK_COUNT
+    };
+
+    /**
+     * Reads the budgets and catch-up limits from the configuration.
+     */
+    void initialize();
+
+    /**
+     * Returns how many of the elapsed ticks are to be run now. Ticks beyond
+     * the catch-up limit are dropped.
+     */
+    int ticksToRun(int elapsedTicks);
+
+    /**
+     * Called at the start of every tick.
+     *
+     * @param tick       the tick about to be run
+     * @param catchingUp whether more ticks are waiting to be run after it
+     */
+    void beginTick(int tick, bool catchingUp);
+
+    /**
+     * Called at the end of every tick with its duration in microseconds.
+     */
+    void endTick(int duration);
+
+    /**
+     * Returns the time that may be spent on background work before the
+     * next tick, in microseconds. The idle time is handed out once per tick.
+     */
+    int getIdleBudget();
+
+    /**
+     * Checks the time spent in the current tick against the budgets, and
+     * starts deferring work when one of them is exceeded.
+     */
+    void checkBudgets();
+
+    /**
+     * Returns whether the given work should be left for a later tick, and
+     * counts it when it is.
+     */
+    bool defer(Work work);
+
+    const char *getWorkName(Work work);
+
+    /**
+     * Writes the overrun, catch-up and deferral counters.
+     */
+    void dump(std::ostream &os);
+
+    /**
+     * Returns a one line summary of the counters.
+     */
+    std::string summary();
+}
+
+#endif // TICKSCHEDULER_H
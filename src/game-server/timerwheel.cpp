@@ -0,0 +1,170 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "game-server/timerwheel.h"
+
+#include <cassert>
+
+Timer::Timer():
+    mWheel(0),
+    mPrev(0),
+    mNext(0),
+    mDue(0)
+{
+}
+
+Timer::~Timer()
+{
+    cancel();
+}
+
+void Timer::cancel()
+{
+    if (!mWheel)
+        return;
+
+    unlink();
+    --mWheel->mCount;
+    mWheel = 0;
+}
+
+void Timer::link(Timer *head)
+{
+    mPrev = head->mPrev;
+    mNext = head;
+    mPrev->mNext = this;
+    head->mPrev = this;
+}
+
+void Timer::unlink()
+{
+    mPrev->mNext = mNext;
+    mNext->mPrev = mPrev;
+    mPrev = mNext = 0;
+}
+
+
+TimerWheel::Slot::Slot()
+{
+    mPrev = mNext = this;
+}
+
+void TimerWheel::Slot::take(Slot &other)
+{
+    assert(isEmpty());
+    if (other.isEmpty())
+        return;
+
+    mNext = other.mNext;
+    mPrev = other.mPrev;
+    mNext->mPrev = this;
+    mPrev->mNext = this;
+    other.mPrev = other.mNext = &other;
+}
+
+
+TimerWheel::TimerWheel():
+    mTick(0),
+    mCount(0)
+{
+}
+
+TimerWheel::~TimerWheel()
+{
+    for (int level = 0; level < LEVELS; ++level)
+    {
+        for (int index = 0; index < SLOTS; ++index)
+        {
+            Slot &slot = mSlots[level][index];
+            while (!slot.isEmpty())
+                slot.first()->cancel();
+        }
+    }
+}
+
+void TimerWheel::schedule(Timer *timer, int due)
+{
+    timer->cancel();
+
+    timer->mDue = due > mTick ? due : mTick + 1;
+    timer->mWheel = this;
+    ++mCount;
+    insert(timer);
+}
+
+void TimerWheel::insert(Timer *timer)
+{
+    const int delta = timer->mDue - mTick;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >> (LEVEL_BITS * (level + 1)))
+        ++level;
+
+    // Timers beyond the range of the wheel wait in the last slot of the
+    // highest level, and are moved along until they are due
+    int slotTick = timer->mDue;
+    if (delta >> (LEVEL_BITS * LEVELS))
+        slotTick = mTick + (1 << (LEVEL_BITS * LEVELS)) - 1;
+
+    const int index = (slotTick >> (LEVEL_BITS * level)) & (SLOTS - 1);
+    timer->link(&mSlots[level][index]);
+}
+
+void TimerWheel::cascade(int level)
+{
+    const int index = (mTick >> (LEVEL_BITS * level)) & (SLOTS - 1);
+
+    Slot timers;
+    timers.take(mSlots[level][index]);
+    while (!timers.isEmpty())
+    {
+        Timer *timer = timers.first();
+        timer->unlink();
+        insert(timer);
+    }
+
+    if (index == 0 && level + 1 < LEVELS)
+        cascade(level + 1);
+}
+
+void TimerWheel::advance(int tick)
+{
+    while (mTick < tick)
+    {
+        ++mTick;
+
+        const int index = mTick & (SLOTS - 1);
+        if (index == 0)
+            cascade(1);
+
+        // Timers may schedule or cancel any timer while they run
+        Slot due;
+        due.take(mSlots[0][index]);
+        while (!due.isEmpty())
+        {
+            Timer *timer = due.first();
+            timer->cancel();
+
+            if (timer->mDue > mTick)
+                schedule(timer, timer->mDue);
+            else
+                timer->expired(mTick);
+        }
+    }
+}
@@ -0,0 +1,187 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+class TimerWheel;
+
+/**
+ * A point in world time at which something has to happen. Meant to be
+ * embedded in the object it belongs to, so that scheduling and cancelling
+ * a timer does not allocate. A timer is cancelled when it is destroyed.
+ */
+class Timer
+{
+    public:
+        Timer();
+
+        virtual ~Timer();
+
+        /**
+         * Returns whether the timer is waiting in a wheel.
+         */
+        bool isScheduled() const
+        { return mWheel != 0; }
+
+        /**
+         * Returns the tick the timer is due at. Only meaningful while it is
+         * scheduled.
+         */
+        int getDue() const
+        { return mDue; }
+
+        /**
+         * Removes the timer from its wheel, if any.
+         */
+        void cancel();
+
+    protected:
+        /**
+         * Called by the wheel in the tick the timer is due at. The timer is
+         * no longer scheduled at that point, and may be scheduled again.
+         */
+        virtual void expired(int tick) = 0;
+
+    private:
+        Timer(const Timer &);
+        Timer &operator=(const Timer &);
+
+        void link(Timer *head);
+        void unlink();
+
+        TimerWheel *mWheel;
+        Timer *mPrev;
+        Timer *mNext;
+        int mDue;
+
+        friend class TimerWheel;
+};
+
+/**
+ * A timer calling a member function of the object it is embedded in.
+ */
+template <class T>
+class MemberTimer : public Timer
+{
+    public:
+        typedef void (T::*Handler)(int tick);
+
+        MemberTimer(T *object, Handler handler):
+            mObject(object),
+            mHandler(handler)
+        {}
+
+    protected:
+        void expired(int tick)
+        { (mObject->*mHandler)(tick); }
+
+    private:
+        T *mObject;
+        Handler mHandler;
+};
+
+/**
+ * A hierarchical timing wheel keyed on world ticks.
+ *
+ * The first level has a slot per tick for the next 64 ticks, and every
+ * further level a slot per 64 slots of the level below. Advancing the wheel
+ * only looks at the timers that are due, and every 64 ticks moves the
+ * timers of one slot of a higher level down. Scheduling and cancelling take
+ * constant time.
+ */
+class TimerWheel
+{
+    public:
+        TimerWheel();
+
+        /**
+         * Cancels the timers still in the wheel.
+         */
+        ~TimerWheel();
+
+        /**
+         * Schedules the timer at the given tick, or in the next tick when
+         * that one has passed. A scheduled timer is moved.
+         */
+        void schedule(Timer *timer, int due);
+
+        /**
+         * Runs all the timers due up to and including the given tick.
+         */
+        void advance(int tick);
+
+        /**
+         * Returns the number of scheduled timers.
+         */
+        unsigned getCount() const
+        { return mCount; }
+
+    private:
+        enum {
+            LEVEL_BITS = 6,
+            SLOTS = 1 << LEVEL_BITS,
+            LEVELS = 4
+        };
+
+        TimerWheel(const TimerWheel &);
+        TimerWheel &operator=(const TimerWheel &);
+
+        /**
+         * Puts the timer in the slot matching its due tick.
+         */
+        void insert(Timer *timer);
+
+        /**
+         * Moves the timers of a slot of a higher level to the levels below.
+         */
+        void cascade(int level);
+
+        /**
+         * Head of the circular list of timers of a slot.
+         */
+        class Slot : public Timer
+        {
+            public:
+                Slot();
+
+                bool isEmpty() const
+                { return mNext == this; }
+
+                /**
+                 * Moves the timers of the other slot to this one.
+                 */
+                void take(Slot &other);
+
+                Timer *first() const
+                { return mNext; }
+
+            protected:
+                void expired(int) {}
+        };
+
+        Slot mSlots[LEVELS][SLOTS];
+        int mTick;                  /**< The last tick that was run. */
+        unsigned mCount;
+
+        friend class Timer;
+};
+
+#endif // TIMERWHEEL_H
@@ -25,9 +25,11 @@
 #include "game-server/mapcomposite.h"
 #include "game-server/actor.h"
 #include "game-server/state.h"
+#include "game-server/tickscheduler.h"
 
 #include "utils/logger.h"
 
+#include <algorithm>
 #include <cassert>
 
 void WarpAction::process(Actor *obj)
@@ -62,27 +64,76 @@ const ComponentType TriggerAreaComponent::type;
 void TriggerAreaComponent::update(Entity &entity)
 {
     MapComposite *map = entity.getMap();
-    std::set<Actor*> insideNow;
 
-    for (BeingIterator i(map->getInsideRectangleIterator(mZone)); i; ++i)
+    if (!mScanned)
     {
-        // Don't deal with uninitialized actors
-        if (!(*i) || !(*i)->isPublicIdValid())
-            continue;
-
         // The BeingIterator returns the mapZones in touch with the rectangle
         // area. On the other hand, the beings contained in the map zones
         // may not be within the rectangle area. Hence, this additional
         // contains() condition.
-        if (mZone.contains((*i)->getPosition()))
+        mScanned = true;
+        for (BeingIterator i(map->getInsideRectangleIterator(mZone)); i; ++i)
         {
-            insideNow.insert(*i);
+            Being *being = *i;
+            if (being->isPublicIdValid() &&
+                mZone.contains(being->getPosition()))
+            {
+                enter(std::lower_bound(mInside.begin(), mInside.end(), being),
+                      being);
+            }
+        }
+    }
+    else
+    {
+        const std::vector<Being *> &moved = map->getMovedBeings();
+        for (unsigned i = 0; i < moved.size(); ++i)
+        {
+            Being *being = moved[i];
+
+            // Don't deal with uninitialized actors
+            if (!being->isPublicIdValid())
+                continue;
+
+            std::vector<Being *>::iterator it =
+                    std::lower_bound(mInside.begin(), mInside.end(), being);
+            const bool wasInside = it != mInside.end() && *it == being;
 
-            if (!mOnce || mInside.find(*i) == mInside.end())
+            if (mZone.contains(being->getPosition()))
+            {
+                if (!wasInside)
+                    enter(it, being);
+            }
+            else if (wasInside)
             {
-                mAction->process(*i);
+                mInside.erase(it);
             }
         }
     }
-    mInside.swap(insideNow); //swapping is faster than assigning
+
+    if (mOnce)
+        return;
+
+    // Beings that stay inside are still found when running later
+    if (TickScheduler::defer(TickScheduler::WORK_TRIGGER))
+        return;
+
+    for (unsigned i = 0; i < mInside.size(); ++i)
+        mAction->process(mInside[i]);
+}
+
+void TriggerAreaComponent::remove(Being *being)
+{
+    std::vector<Being *>::iterator it =
+            std::lower_bound(mInside.begin(), mInside.end(), being);
+    if (it != mInside.end() && *it == being)
+        mInside.erase(it);
+}
+
+void TriggerAreaComponent::enter(std::vector<Being *>::iterator pos,
+                                 Being *being)
+{
+    mInside.insert(pos, being);
+
+    if (mOnce)
+        mAction->process(being);
 }
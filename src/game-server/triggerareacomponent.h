@@ -26,9 +26,10 @@
 #include "scripting/script.h"
 #include "utils/point.h"
 
-#include <set>
+#include <vector>
 
 class Actor;
+class Being;
 
 class TriggerAction
 {
@@ -63,6 +64,13 @@ class ScriptAction : public TriggerAction
         int mArg;               // Argument passed to script function (meaning is function-specific)
 };
 
+/**
+ * A rectangular area that runs an action for the beings inside it, every
+ * tick or only when they enter.
+ *
+ * Which beings are inside is kept up to date from the beings that moved or
+ * were inserted on the map, so beings standing still are not looked at.
+ */
 class TriggerAreaComponent : public Component
 {
     public:
@@ -76,16 +84,29 @@ class TriggerAreaComponent : public Component
                              bool once) :
             mZone(r),
             mAction(ptr),
-            mOnce(once)
+            mOnce(once),
+            mScanned(false)
         {}
 
         void update(Entity &entity);
 
+        /**
+         * Forgets a being that is removed from the map.
+         */
+        void remove(Being *being);
+
     private:
+        /**
+         * Adds a being that entered the area, and runs the action when
+         * the trigger only acts on entering.
+         */
+        void enter(std::vector<Being *>::iterator pos, Being *being);
+
         Rectangle mZone;
         TriggerAction *mAction;
         bool mOnce;
-        std::set<Actor *> mInside;
+        bool mScanned;      /**< The beings inside were looked up. */
+        std::vector<Being *> mInside;   /**< Sorted by address. */
 };
 
 #endif // TRIGGERAREACOMPONENT_H
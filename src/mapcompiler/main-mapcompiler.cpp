@@ -0,0 +1,240 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "common/defines.h"
+#include "game-server/compiledmap.h"
+#include "game-server/map.h"
+#include "game-server/mapreader.h"
+#include "game-server/publicidtable.h"
+#include "utils/logger.h"
+#include "utils/timer.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/**
+ * Show command line arguments
+ */
+static void printHelp()
+{
+    std::cout << "manaserv-mapcompiler [options] <map.tmx>..." << std::endl
+              << std::endl
+              << "Writes the compiled form of every map next to it, to be"
+              << " loaded by the game" << std::endl
+              << "server instead of the XML map file." << std::endl
+              << std::endl
+              << "Options: " << std::endl
+              << "  -h --help          : Display this help" << std::endl
+              << "  -f --force         : Compile maps that are up to date"
+              << std::endl
+              << "  -b --benchmark <n> : Time <n> random path searches on"
+              << " every map" << std::endl
+              << "  -i --benchmark-ids <n> : Time <n> public ID"
+              << " reallocations and lookups" << std::endl;
+    exit(EXIT_NORMAL);
+}
+
+/**
+ * Times path searches and walkability checks between random walkable tiles,
+ * the way monsters and characters use them on the game server.
+ */
+static void benchmark(const std::string &name, const Map *map, int searches)
+{
+    const int width = map->getWidth();
+    const int height = map->getHeight();
+
+    std::vector<Point> walkable;
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            if (map->getWalk(x, y))
+                walkable.push_back(Point(x, y));
+
+    if (walkable.empty())
+        return;
+
+    std::srand(1);
+
+    uint64_t start = utils::getTimeInMicrosec();
+    unsigned found = 0, steps = 0;
+    for (int i = 0; i < searches; ++i)
+    {
+        const Point &from = walkable[std::rand() % walkable.size()];
+        const Point &to = walkable[std::rand() % walkable.size()];
+        Path path = map->findPath(from.x, from.y, to.x, to.y,
+                                  Map::BLOCKMASK_WALL, width + height);
+        if (!path.empty())
+        {
+            ++found;
+            steps += path.size();
+        }
+    }
+    const uint64_t pathTime = utils::getTimeInMicrosec() - start;
+
+    start = utils::getTimeInMicrosec();
+    unsigned walls = 0;
+    for (int y = 0; y < height; ++y)
+        for (int x = 0; x < width; ++x)
+            walls += !map->getWalk(x, y);
+    const uint64_t walkTime = utils::getTimeInMicrosec() - start;
+
+    LOG_INFO(name << ": " << width << "x" << height << " tiles, "
+             << walls << " walls, " << found << "/" << searches
+             << " paths found, " << steps << " steps, "
+             << pathTime / searches << " us per search, "
+             << walkTime * 1000 / (width * height) << " ns per tile check");
+}
+
+/**
+ * Times the reallocation of public IDs and the lookup of actors by ID, with
+ * as many live actors as a quiet map up to a full one holds.
+ */
+static void benchmarkIds(int reallocations)
+{
+    static const int liveCounts[] = { 100, 2000, 30000, 60000 };
+    static const int countCount = sizeof(liveCounts) / sizeof(liveCounts[0]);
+
+    // The table never dereferences the actors, any distinct address will do
+    std::vector<char> addresses(liveCounts[countCount - 1]);
+    std::vector<Actor *> actors(addresses.size());
+    for (unsigned i = 0; i < addresses.size(); ++i)
+        actors[i] = reinterpret_cast<Actor *>(&addresses[i]);
+
+    for (int c = 0; c < countCount; ++c)
+    {
+        const int live = liveCounts[c];
+        PublicIdTable table;
+        std::vector<int> ids(live);
+        for (int i = 0; i < live; ++i)
+            ids[i] = table.allocate(actors[i]);
+
+        std::srand(1);
+
+        uint64_t start = utils::getTimeInMicrosec();
+        for (int i = 0; i < reallocations; ++i)
+        {
+            int &id = ids[std::rand() % live];
+            table.deallocate(id);
+            id = table.allocate(actors[i % live]);
+        }
+        const uint64_t allocTime = utils::getTimeInMicrosec() - start;
+
+        start = utils::getTimeInMicrosec();
+        unsigned found = 0;
+        for (int i = 0; i < reallocations; ++i)
+            found += table.get(ids[std::rand() % live]) != 0;
+        const uint64_t getTime = utils::getTimeInMicrosec() - start;
+
+        LOG_INFO(live << " live IDs: "
+                 << allocTime * 1000 / reallocations << " ns per reallocation, "
+                 << getTime * 1000 / reallocations << " ns per lookup ("
+                 << found << " found)");
+    }
+}
+
+/**
+ * Compiles a single map.
+ * @return whether the compiled map is up to date.
+ */
+static bool compile(const std::string &tmxPath, bool force, int searches)
+{
+    CompiledMap::SourceStamp stamp;
+    if (!CompiledMap::getStamp(tmxPath, stamp))
+    {
+        LOG_ERROR("Map file not found: " << tmxPath);
+        return false;
+    }
+
+    const std::string path = CompiledMap::getPath(tmxPath);
+    if (!force)
+    {
+        if (Map *map = CompiledMap::read(path, stamp))
+        {
+            LOG_INFO("Up to date: " << path);
+            if (searches > 0)
+                benchmark(path, map, searches);
+            delete map;
+            return true;
+        }
+    }
+
+    Map *map = MapReader::readTmxFile(tmxPath);
+    if (!map)
+        return false;
+
+    const bool written = CompiledMap::write(map, path, stamp);
+    if (written)
+        LOG_INFO("Compiled " << tmxPath << " to " << path);
+    if (searches > 0)
+        benchmark(tmxPath, map, searches);
+
+    delete map;
+    return written;
+}
+
+int main(int argc, char *argv[])
+{
+    bool force = false;
+    int searches = 0;
+    int idReallocations = 0;
+    std::vector<const char *> files;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "-h") || !std::strcmp(argv[i], "--help"))
+            printHelp();
+        else if (!std::strcmp(argv[i], "-f") ||
+                 !std::strcmp(argv[i], "--force"))
+            force = true;
+        else if (!std::strcmp(argv[i], "-b") ||
+                 !std::strcmp(argv[i], "--benchmark"))
+        {
+            if (++i == argc)
+                printHelp();
+            searches = std::atoi(argv[i]);
+        }
+        else if (!std::strcmp(argv[i], "-i") ||
+                 !std::strcmp(argv[i], "--benchmark-ids"))
+        {
+            if (++i == argc)
+                printHelp();
+            idReallocations = std::atoi(argv[i]);
+        }
+        else
+            files.push_back(argv[i]);
+    }
+
+    int failures = 0;
+    const int maps = files.size();
+    for (int i = 0; i < maps; ++i)
+    {
+        if (!compile(files[i], force, searches))
+            ++failures;
+    }
+
+    if (idReallocations > 0)
+        benchmarkIds(idReallocations);
+    else if (!maps)
+        printHelp();
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -26,7 +26,12 @@ BandwidthMonitor::BandwidthMonitor():
     mAmountServerOutput(0),
     mAmountServerInput(0),
     mAmountClientOutput(0),
-    mAmountClientInput(0)
+    mAmountClientInput(0),
+    mAmountCompressedRaw(0),
+    mAmountCompressed(0),
+    mAmountDecompressedRaw(0),
+    mAmountDecompressed(0),
+    mCompressionTime(0)
 {
 }
 
@@ -76,3 +81,18 @@ void BandwidthMonitor::increaseClientInput(NetComputer *nc, int size)
     itr->second.second += size;
 }
 
+void BandwidthMonitor::increaseCompressed(int rawSize, int compressedSize,
+                                          int time)
+{
+    mAmountCompressedRaw += rawSize;
+    mAmountCompressed += compressedSize;
+    mCompressionTime += time;
+}
+
+void BandwidthMonitor::increaseDecompressed(int rawSize, int compressedSize,
+                                            int time)
+{
+    mAmountDecompressedRaw += rawSize;
+    mAmountDecompressed += compressedSize;
+    mCompressionTime += time;
+}
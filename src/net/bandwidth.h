@@ -33,16 +33,29 @@ public:
     void increaseInterServerInput(int size);
     void increaseClientOutput(NetComputer *nc, int size);
     void increaseClientInput(NetComputer *nc, int size);
+    void increaseCompressed(int rawSize, int compressedSize, int time);
+    void increaseDecompressed(int rawSize, int compressedSize, int time);
     int totalInterServerOut() const { return mAmountServerOutput; }
     int totalInterServerIn() const { return mAmountServerInput; }
     int totalClientOut() const { return mAmountClientOutput; }
     int totalClientIn() const { return mAmountClientInput; }
+    int totalCompressedRaw() const { return mAmountCompressedRaw; }
+    int totalCompressed() const { return mAmountCompressed; }
+    int totalDecompressedRaw() const { return mAmountDecompressedRaw; }
+    int totalDecompressed() const { return mAmountDecompressed; }
+    /** Time spent on (de)compression, in microseconds. */
+    int totalCompressionTime() const { return mCompressionTime; }
 
 private:
     int mAmountServerOutput;
     int mAmountServerInput;
     int mAmountClientOutput;
     int mAmountClientInput;
+    int mAmountCompressedRaw;
+    int mAmountCompressed;
+    int mAmountDecompressedRaw;
+    int mAmountDecompressed;
+    int mCompressionTime;
     // map of client to output and input
     typedef std::map<NetComputer*, std::pair<int, int> > ClientBandwidth;
     ClientBandwidth mClientBandwidth;
@@ -20,6 +20,7 @@
 
 #include "net/connection.h"
 #include "net/bandwidth.h"
+#include "net/messagecompressor.h"
 #include "net/messagein.h"
 #include "net/messageout.h"
 #include "utils/logger.h"
@@ -32,10 +33,17 @@
 
 Connection::Connection():
     mRemote(0),
-    mLocal(0)
+    mLocal(0),
+    mCompressor(0),
+    mCompressionEnabled(false)
 {
 }
 
+Connection::~Connection()
+{
+    delete mCompressor;
+}
+
 bool Connection::start(const std::string &address, int port)
 {
     ENetAddress enetAddress;
@@ -58,6 +66,10 @@ bool Connection::start(const std::string &address, int port)
     if (!mLocal)
         return false;
 
+    // Start with a fresh compression history
+    delete mCompressor;
+    mCompressor = new MessageCompressor(true);
+
     // Initiate the connection, allocating channel 0.
 #if defined(ENET_VERSION) && ENET_VERSION >= ENET_CUTOFF
     mRemote = enet_host_connect(mLocal, &enetAddress, 1, 0);
@@ -102,11 +114,22 @@ void Connection::send(const MessageOut &msg, bool reliable, unsigned channel)
         return;
     }
 
-    gBandwidth->increaseInterServerOutput(msg.getLength());
+    const char *data = msg.getData();
+    unsigned length = msg.getLength();
+
+    std::string compressed;
+    if (mCompressionEnabled && mCompressor->canCompress(reliable, channel) &&
+        msg.compress(*mCompressor, compressed))
+    {
+        data = compressed.data();
+        length = compressed.size();
+    }
+
+    gBandwidth->increaseInterServerOutput(length);
 
     ENetPacket *packet;
-    packet = enet_packet_create(msg.getData(),
-                                msg.getLength(),
+    packet = enet_packet_create(data,
+                                length,
                                 reliable ? ENET_PACKET_FLAG_RELIABLE : 0);
 
     if (packet)
@@ -127,7 +150,7 @@ void Connection::process()
                 if (event.packet->dataLength >= 2)
                 {
                     MessageIn msg((char *)event.packet->data,
-                                  event.packet->dataLength);
+                                  event.packet->dataLength, mCompressor);
                     gBandwidth->increaseInterServerInput(event.packet->dataLength);
                     processMessage(msg);
                 }
@@ -24,6 +24,7 @@
 #include <string>
 #include <enet/enet.h>
 
+class MessageCompressor;
 class MessageIn;
 class MessageOut;
 
@@ -35,7 +36,7 @@ class Connection
 {
     public:
         Connection();
-        virtual ~Connection() {}
+        virtual ~Connection();
 
         /**
          * Connects to the given host/port and waits until the connection is
@@ -64,6 +65,15 @@ class Connection
          */
         void process();
 
+        /**
+         * Sets whether large messages sent over this connection get
+         * compressed. Compressed messages from the remote host are always
+         * accepted. The compression history is kept for as long as the
+         * connection lasts.
+         */
+        void setCompressionEnabled(bool enabled)
+        { mCompressionEnabled = enabled; }
+
     protected:
         /**
          * Processes a single message from the remote host.
@@ -73,6 +83,8 @@ class Connection
     private:
         ENetPeer *mRemote;
         ENetHost *mLocal;
+        MessageCompressor *mCompressor;
+        bool mCompressionEnabled;
 };
 
 #endif
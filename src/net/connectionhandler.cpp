@@ -120,7 +120,8 @@ void ConnectionHandler::process(enet_uint32 timeout)
                 // Make sure that the packet is big enough (> short)
                 if (event.packet->dataLength >= 2) {
                     MessageIn msg((char *)event.packet->data,
-                                  event.packet->dataLength);
+                                  event.packet->dataLength,
+                                  comp->getCompressor());
                     LOG_DEBUG("Received message " << msg << " from "
                               << *comp);
 
@@ -0,0 +1,188 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "net/messagecompressor.h"
+
+#include "net/bandwidth.h"
+#include "utils/logger.h"
+#include "utils/timer.h"
+
+#include <zlib.h>
+
+/** Size of the chunks in which (de)compressed data is produced. */
+static const unsigned CHUNK_SIZE = 4096;
+
+MessageCompressor::MessageCompressor(bool persistent):
+    mDeflateStream(0),
+    mInflateStream(0),
+    mPersistent(persistent),
+    mBroken(false)
+{
+}
+
+MessageCompressor::~MessageCompressor()
+{
+    if (mDeflateStream)
+    {
+        deflateEnd(mDeflateStream);
+        delete mDeflateStream;
+    }
+    if (mInflateStream)
+    {
+        inflateEnd(mInflateStream);
+        delete mInflateStream;
+    }
+}
+
+bool MessageCompressor::canCompress(bool reliable, unsigned channel) const
+{
+    if (mBroken)
+        return false;
+
+    // The history of a persistent stream would get out of sync when a
+    // message is lost or overtaken by one on another channel.
+    return !mPersistent || (reliable && channel == 0);
+}
+
+bool MessageCompressor::deflate(const char *in, unsigned inLength,
+                                std::string &out)
+{
+    if (mBroken)
+        return false;
+
+    uint64_t start = utils::getTimeInMicrosec();
+
+    if (!mDeflateStream)
+    {
+        mDeflateStream = new z_stream;
+        mDeflateStream->zalloc = Z_NULL;
+        mDeflateStream->zfree = Z_NULL;
+        mDeflateStream->opaque = Z_NULL;
+
+        // Raw deflate, the message id already tells the data is compressed
+        if (deflateInit2(mDeflateStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                         -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            LOG_ERROR("Unable to initialize message compression!");
+            delete mDeflateStream;
+            mDeflateStream = 0;
+            mBroken = true;
+            return false;
+        }
+    }
+    else if (!mPersistent)
+    {
+        deflateReset(mDeflateStream);
+    }
+
+    char buffer[CHUNK_SIZE];
+    mDeflateStream->next_in = (Bytef *) in;
+    mDeflateStream->avail_in = inLength;
+    out.clear();
+
+    do
+    {
+        mDeflateStream->next_out = (Bytef *) buffer;
+        mDeflateStream->avail_out = CHUNK_SIZE;
+
+        if (::deflate(mDeflateStream, Z_SYNC_FLUSH) == Z_STREAM_ERROR)
+        {
+            LOG_ERROR("Error while compressing message!");
+            mBroken = true;
+            return false;
+        }
+
+        out.append(buffer, CHUNK_SIZE - mDeflateStream->avail_out);
+    }
+    while (mDeflateStream->avail_out == 0);
+
+    gBandwidth->increaseCompressed(inLength, out.size(),
+                                   utils::getTimeInMicrosec() - start);
+    return true;
+}
+
+bool MessageCompressor::inflate(const char *in, unsigned inLength,
+                                unsigned maxLength, std::string &out)
+{
+    uint64_t start = utils::getTimeInMicrosec();
+
+    if (!mInflateStream)
+    {
+        mInflateStream = new z_stream;
+        mInflateStream->zalloc = Z_NULL;
+        mInflateStream->zfree = Z_NULL;
+        mInflateStream->opaque = Z_NULL;
+        mInflateStream->next_in = Z_NULL;
+        mInflateStream->avail_in = 0;
+
+        if (inflateInit2(mInflateStream, -15) != Z_OK)
+        {
+            LOG_ERROR("Unable to initialize message decompression!");
+            delete mInflateStream;
+            mInflateStream = 0;
+            return false;
+        }
+    }
+    else if (!mPersistent)
+    {
+        inflateReset(mInflateStream);
+    }
+
+    char buffer[CHUNK_SIZE];
+    mInflateStream->next_in = (Bytef *) in;
+    mInflateStream->avail_in = inLength;
+    out.clear();
+
+    do
+    {
+        mInflateStream->next_out = (Bytef *) buffer;
+        mInflateStream->avail_out = CHUNK_SIZE;
+
+        switch (::inflate(mInflateStream, Z_SYNC_FLUSH))
+        {
+            case Z_NEED_DICT:
+            case Z_STREAM_ERROR:
+            case Z_DATA_ERROR:
+            case Z_MEM_ERROR:
+                LOG_DEBUG("Incorrect compressed message data!");
+                return false;
+        }
+
+        out.append(buffer, CHUNK_SIZE - mInflateStream->avail_out);
+
+        // Stop before a small message expands into a huge one
+        if (out.size() > maxLength)
+        {
+            LOG_DEBUG("Decompressed message data is too large!");
+            return false;
+        }
+    }
+    while (mInflateStream->avail_out == 0);
+
+    if (mInflateStream->avail_in != 0)
+    {
+        LOG_DEBUG("Incomplete decompression of message data!");
+        return false;
+    }
+
+    gBandwidth->increaseDecompressed(out.size(), inLength,
+                                     utils::getTimeInMicrosec() - start);
+    return true;
+}
@@ -0,0 +1,76 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MESSAGECOMPRESSOR_H
+#define MESSAGECOMPRESSOR_H
+
+#include <string>
+
+struct z_stream_s;
+
+/**
+ * Holds the deflate and inflate streams of a single connection.
+ *
+ * A persistent compressor keeps the compression history between messages,
+ * so that a message can refer back to data from earlier ones. This gives a
+ * much better ratio for the similar messages exchanged between servers, but
+ * requires the messages to arrive reliably and in order. A non-persistent
+ * compressor handles every message on its own.
+ */
+class MessageCompressor
+{
+    public:
+        MessageCompressor(bool persistent);
+
+        ~MessageCompressor();
+
+        /**
+         * Returns whether a message sent with the given reliability and
+         * channel may be compressed by this compressor.
+         */
+        bool canCompress(bool reliable, unsigned channel) const;
+
+        /**
+         * Deflates the given data into out. Returns false on failure, after
+         * which the compressor refuses to compress any more messages.
+         */
+        bool deflate(const char *in, unsigned inLength, std::string &out);
+
+        /**
+         * Inflates the given data into out. Returns false when the data is
+         * invalid or inflates to more than maxLength bytes.
+         */
+        bool inflate(const char *in, unsigned inLength, unsigned maxLength,
+                     std::string &out);
+
+        bool isPersistent() const
+        { return mPersistent; }
+
+    private:
+        MessageCompressor(const MessageCompressor &);
+        MessageCompressor &operator=(const MessageCompressor &);
+
+        z_stream_s *mDeflateStream;     /**< Created on first use. */
+        z_stream_s *mInflateStream;     /**< Created on first use. */
+        bool mPersistent;
+        bool mBroken;                   /**< Deflate stream failed. */
+};
+
+#endif // MESSAGECOMPRESSOR_H
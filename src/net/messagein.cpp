@@ -30,6 +30,7 @@
 #include <stdint.h>
 
 #include "net/messagein.h"
+#include "net/messagecompressor.h"
 #include "utils/logger.h"
 
 // Not enabled by default since this will cause assertions on message errors,
@@ -43,7 +44,8 @@
 #define ASSERT_IF(x) if (x)
 #endif
 
-MessageIn::MessageIn(const char *data, unsigned short length):
+MessageIn::MessageIn(const char *data, unsigned short length,
+                     MessageCompressor *compressor):
     mData(data),
     mLength(length),
     mDebugMode(false),
@@ -52,11 +54,47 @@ MessageIn::MessageIn(const char *data, unsigned short length):
     // Read the message ID
     mId = readInt16();
 
+    if ((mId & ManaServ::XXMSG_COMPRESSED_FLAG) &&
+        (mId & ~ManaServ::XXMSG_DEBUG_FLAG) != ManaServ::XXMSG_INVALID)
+    {
+        mId &= ~ManaServ::XXMSG_COMPRESSED_FLAG;
+        inflate(compressor);
+    }
+
     // Read and clear the debug flag
     mDebugMode = mId & ManaServ::XXMSG_DEBUG_FLAG;
     mId &= ~ManaServ::XXMSG_DEBUG_FLAG;
 }
 
+void MessageIn::inflate(MessageCompressor *compressor)
+{
+    std::string payload;
+    if (!compressor)
+    {
+        LOG_DEBUG("Unexpected compressed message " << (mId &
+                  ~ManaServ::XXMSG_DEBUG_FLAG) << "!");
+    }
+    else if (!compressor->inflate(mData + mPos, mLength - mPos,
+                                  0xFFFF - mPos, payload))
+    {
+        LOG_DEBUG("Unable to inflate message " << (mId &
+                  ~ManaServ::XXMSG_DEBUG_FLAG) << "!");
+    }
+    else
+    {
+        // Keep the id in front so that the message can be printed again
+        uint16_t id = ENET_HOST_TO_NET_16(mId);
+        mInflated.assign((const char *) &id, 2);
+        mInflated.append(payload);
+        mData = mInflated.data();
+        mLength = mInflated.size();
+        return;
+    }
+
+    // Make the rest of the message unreadable
+    mPos = mLength + 1;
+}
+
 int MessageIn::readInt8()
 {
     int value = -1;
@@ -121,6 +159,44 @@ int MessageIn::readInt32()
     return value;
 }
 
+int MessageIn::readVarInt()
+{
+    int value = -1;
+
+    if (!readValueType(ManaServ::VarInt))
+        return value;
+
+    uint32_t t = 0;
+    int shift = 0;
+    ASSERT_IF (mPos < mLength)
+    {
+        unsigned char byte;
+        do
+        {
+            byte = mData[mPos++];
+            t |= (uint32_t) (byte & 0x7F) << shift;
+            shift += 7;
+        }
+        while ((byte & 0x80) && mPos < mLength && shift < 35);
+
+        if (byte & 0x80)
+        {
+            LOG_DEBUG("Unterminated varint in " << mId << "!");
+            mPos = mLength + 1;
+            return value;
+        }
+
+        value = (int) (t >> 1) ^ -(int) (t & 1);
+    }
+    else
+    {
+        LOG_DEBUG("Unable to read varint in " << mId << "!");
+        mPos += 1;
+    }
+
+    return value;
+}
+
 double MessageIn::readDouble()
 {
     double value = -1;
@@ -259,6 +335,9 @@ operator <<(std::ostream &os, const MessageIn &msg)
             case ManaServ::Double:
                 os << "d " << m.readDouble();
                 break;
+            case ManaServ::VarInt:
+                os << "V " << m.readVarInt();
+                break;
             default:
                 os << "??? }";
                 return os; // Stop after error
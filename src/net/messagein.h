@@ -24,6 +24,9 @@
 #include "common/manaserv_protocol.h"
 
 #include <iosfwd>
+#include <string>
+
+class MessageCompressor;
 
 /**
  * Used for parsing an incoming message.
@@ -34,10 +37,13 @@ class MessageIn
         /**
          * Constructor.
          *
-         * @param data   the message data
-         * @param length the length of the data
+         * @param data       the message data
+         * @param length     the length of the data
+         * @param compressor used to inflate the message when it has been
+         *                   sent compressed
          */
-        MessageIn(const char *data, unsigned short length);
+        MessageIn(const char *data, unsigned short length,
+                  MessageCompressor *compressor = 0);
 
         /**
          * Returns the message ID.
@@ -52,6 +58,7 @@ class MessageIn
         int readInt8();             /**< Reads a byte. */
         int readInt16();            /**< Reads a short. */
         int readInt32();            /**< Reads a long. */
+        int readVarInt();           /**< Reads a zigzag varint. */
 
         /**
          * Reads a double. HACKY and should *not* be used for client
@@ -72,12 +79,18 @@ class MessageIn
         int getUnreadLength() const { return mLength - mPos; }
 
     private:
+        MessageIn(const MessageIn &);
+        MessageIn &operator=(const MessageIn &);
+
         bool readValueType(ManaServ::ValueType type);
 
+        void inflate(MessageCompressor *compressor);
+
         const char *mData;            /**< Packet data */
         unsigned short mLength;       /**< Length of data in bytes */
         unsigned short mId;           /**< The message ID. */
         bool mDebugMode;              /**< Includes debugging information. */
+        std::string mInflated;        /**< Data of a compressed message. */
 
         /**
          * Actual position in the packet. From 0 to packet->length. A value
@@ -20,6 +20,7 @@
 
 #include "net/messageout.h"
 #include "net/messagein.h"
+#include "net/messagecompressor.h"
 
 #include <cstring>
 #include <iomanip>
@@ -39,6 +40,7 @@ const unsigned INITIAL_DATA_CAPACITY = 16;
 const unsigned CAPACITY_GROW_FACTOR = 2;
 
 static bool debugModeEnabled = false;
+static unsigned compressionThreshold = 0;
 
 MessageOut::MessageOut(int id):
     mPos(0),
@@ -105,6 +107,23 @@ void MessageOut::writeInt32(int value)
     mPos += 4;
 }
 
+void MessageOut::writeVarInt(int value)
+{
+    if (mDebugMode)
+        writeValueType(ManaServ::VarInt);
+
+    // Zigzag maps small negative values to small positive ones
+    uint32_t t = ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+
+    expand(mPos + 5);
+    while (t >= 0x80)
+    {
+        mData[mPos++] = (t & 0x7F) | 0x80;
+        t >>= 7;
+    }
+    mData[mPos++] = t;
+}
+
 void MessageOut::writeDouble(double value)
 {
     if (mDebugMode)
@@ -160,6 +179,27 @@ void MessageOut::writeString(const std::string &string, int length)
     mPos += length;
 }
 
+bool MessageOut::compress(MessageCompressor &compressor,
+                          std::string &out) const
+{
+    if (compressionThreshold == 0 || mPos < compressionThreshold)
+        return false;
+
+    std::string payload;
+    if (!compressor.deflate(mData + 2, mPos - 2, payload))
+        return false;
+
+    uint16_t id;
+    memcpy(&id, mData, 2);
+    id = ENET_HOST_TO_NET_16(ENET_NET_TO_HOST_16(id) |
+                             ManaServ::XXMSG_COMPRESSED_FLAG);
+
+    out.reserve(2 + payload.size());
+    out.assign((const char *) &id, 2);
+    out.append(payload);
+    return true;
+}
+
 void MessageOut::writeValueType(ManaServ::ValueType type)
 {
     expand(mPos + 1);
@@ -183,6 +223,11 @@ operator <<(std::ostream &os, const MessageOut &msg)
     return os;
 }
 
+void MessageOut::setCompressionThreshold(unsigned threshold)
+{
+    compressionThreshold = threshold;
+}
+
 void MessageOut::setDebugModeEnabled(bool enabled)
 {
     debugModeEnabled = enabled;
@@ -24,6 +24,9 @@
 #include "common/manaserv_protocol.h"
 
 #include <iosfwd>
+#include <string>
+
+class MessageCompressor;
 
 /**
  * Used for building an outgoing message.
@@ -55,6 +58,12 @@ class MessageOut
          */
         void writeInt32(int value);
 
+        /**
+         * Writes a signed integer as a zigzag encoded varint. Small values,
+         * positive or negative, take a single byte.
+         */
+        void writeVarInt(int value);
+
         /**
          * Writes a double. HACKY and should *not* be used for client
          * communication!
@@ -77,6 +86,20 @@ class MessageOut
          */
         unsigned getLength() const { return mPos; }
 
+        /**
+         * Compresses the message into out, marking it with
+         * XXMSG_COMPRESSED_FLAG. Returns false and leaves out untouched when
+         * the message is below the compression threshold or compression
+         * failed, in which case the message should be sent as is.
+         */
+        bool compress(MessageCompressor &compressor, std::string &out) const;
+
+        /**
+         * Sets the minimum size in bytes a message needs to have before it
+         * gets compressed. A threshold of 0 disables compression.
+         */
+        static void setCompressionThreshold(unsigned threshold);
+
         /**
          * Sets whether the debug mode is enabled. In debug mode, the internal
          * data of the message is annotated so that the message contents can
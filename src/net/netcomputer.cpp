@@ -23,6 +23,7 @@
 #include <enet/enet.h>
 
 #include "bandwidth.h"
+#include "messagecompressor.h"
 #include "messageout.h"
 #include "netcomputer.h"
 
@@ -30,10 +31,24 @@
 #include "../utils/processorutils.h"
 
 NetComputer::NetComputer(ENetPeer *peer):
-    mPeer(peer)
+    mPeer(peer),
+    mCompressor(0),
+    mCompressOutput(false)
 {
 }
 
+NetComputer::~NetComputer()
+{
+    delete mCompressor;
+}
+
+void NetComputer::enableCompression(bool persistent, bool compressOutput)
+{
+    if (!mCompressor)
+        mCompressor = new MessageCompressor(persistent);
+    mCompressOutput = compressOutput;
+}
+
 bool NetComputer::isConnected()
 {
     return (mPeer->state == ENET_PEER_STATE_CONNECTED);
@@ -61,11 +76,22 @@ void NetComputer::send(const MessageOut &msg, bool reliable,
 {
     LOG_DEBUG("Sending message " << msg << " to " << *this);
 
-    gBandwidth->increaseClientOutput(this, msg.getLength());
+    const char *data = msg.getData();
+    unsigned length = msg.getLength();
+
+    std::string compressed;
+    if (mCompressOutput && mCompressor->canCompress(reliable, channel) &&
+        msg.compress(*mCompressor, compressed))
+    {
+        data = compressed.data();
+        length = compressed.size();
+    }
+
+    gBandwidth->increaseClientOutput(this, length);
 
     ENetPacket *packet;
-    packet = enet_packet_create(msg.getData(),
-                                msg.getLength(),
+    packet = enet_packet_create(data,
+                                length,
                                 reliable ? ENET_PACKET_FLAG_RELIABLE : 0);
 
     if (packet)
@@ -24,6 +24,7 @@
 #include <iostream>
 #include <enet/enet.h>
 
+class MessageCompressor;
 class MessageOut;
 
 /**
@@ -35,7 +36,7 @@ class NetComputer
     public:
         NetComputer(ENetPeer *peer);
 
-        virtual ~NetComputer() {}
+        virtual ~NetComputer();
 
         /**
          * Returns <code>true</code> if this computer is connected.
@@ -75,8 +76,27 @@ class NetComputer
          */
         int getIP() const;
 
+        /**
+         * Enables the decompression of incoming messages and optionally the
+         * compression of large outgoing messages.
+         *
+         * @param persistent     keep the compression history between
+         *                       messages, see MessageCompressor
+         * @param compressOutput whether to compress outgoing messages
+         */
+        void enableCompression(bool persistent, bool compressOutput = true);
+
+        /**
+         * Returns the compressor of this connection, or NULL when
+         * compression has not been enabled.
+         */
+        MessageCompressor *getCompressor() const
+        { return mCompressor; }
+
     private:
         ENetPeer *mPeer;              /**< Client peer */
+        MessageCompressor *mCompressor;
+        bool mCompressOutput;
 
         /**
          * Converts the ip-address of the peer to a stringstream.
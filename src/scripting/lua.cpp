@@ -27,6 +27,7 @@ extern "C" {
 #include <lauxlib.h>
 }
 
+#include "common/configuration.h"
 #include "common/defines.h"
 #include "common/resourcemanager.h"
 #include "game-server/accountconnection.h"
@@ -51,12 +52,15 @@ extern "C" {
 #include "game-server/statusmanager.h"
 #include "game-server/triggerareacomponent.h"
 #include "net/messageout.h"
+#include "scripting/luabytecodecache.h"
 #include "scripting/luautil.h"
 #include "scripting/luascript.h"
 #include "scripting/scriptmanager.h"
+#include "scripting/scriptscheduler.h"
 #include "utils/logger.h"
 #include "utils/speedconv.h"
 
+#include <new>
 #include <string.h>
 #include <math.h>
 
@@ -211,7 +215,7 @@ static int on_create_npc_delayed(lua_State *s)
 static int on_map_initialize(lua_State *s)
 {
     luaL_checktype(s, 1, LUA_TFUNCTION);
-    MapComposite::setInitializeCallback(getScript(s));
+    Script::setMapInitializeCallback(getScript(s));
     return 0;
 }
 
@@ -238,7 +242,22 @@ static int on_craft(lua_State *s)
 static int on_mapupdate(lua_State *s)
 {
     luaL_checktype(s, 1, LUA_TFUNCTION);
-    MapComposite::setUpdateCallback(getScript(s));
+    Script::setMapUpdateCallback(getScript(s));
+    return 0;
+}
+
+/** LUA on_map_message (callbacks)
+ * on_map_message(function ref)
+ **
+ * Will make sure that the function ''ref'' gets called with the subject, the
+ * body and the id of the sending map, or 0, of every message sent to the map
+ * with map_send_message. The messages are delivered at the start of the tick
+ * after they were sent.
+ */
+static int on_map_message(lua_State *s)
+{
+    luaL_checktype(s, 1, LUA_TFUNCTION);
+    Script::setMapMessageCallback(getScript(s));
     return 0;
 }
 
@@ -280,7 +299,7 @@ static int npc_create(lua_State *s)
 
     MapComposite *m = checkCurrentMap(s);
 
-    NpcComponent *npcComponent = new NpcComponent(id);
+    NpcComponent *npcComponent = new NpcComponent(id, getScript(s));
 
     Being *npc = new Being(OBJECT_NPC);
     npc->addComponent(npcComponent);
@@ -1216,6 +1235,43 @@ static int chr_get_quest(lua_State *s)
     return lua_yield(s, 0);
 }
 
+/** LUA chr_get_quests (being)
+ * chr_get_quests(handle character, table names)
+ **
+ * **Return value:** A table with the value of each of the quest variables
+ * named in ''names'', indexed by name.
+ *
+ * The quest variables of a character are sent along when it enters the
+ * server, so unlike chr_get_quest this does not have to wait and may be
+ * called from anywhere. A variable that is not known yet is left out.
+ */
+static int chr_get_quests(lua_State *s)
+{
+    Character *q = checkCharacter(s, 1);
+    luaL_checktype(s, 2, LUA_TTABLE);
+
+    lua_newtable(s);
+    lua_pushnil(s);
+    while (lua_next(s, 2))
+    {
+        luaL_argcheck(s, lua_type(s, -1) == LUA_TSTRING, 2,
+                      "invalid variable name");
+        const char *name = lua_tostring(s, -1);
+
+        std::string value;
+        if (name[0] != 0 && getQuestVar(q, name, value))
+        {
+            push(s, value);
+            lua_rawset(s, 3);
+        }
+        else
+        {
+            lua_pop(s, 1);
+        }
+    }
+    return 1;
+}
+
 /** LUA chr_set_quest (being)
  * chr_set_quest(handle character, string name, string value)
  **
@@ -2598,6 +2654,143 @@ static int setvar_world(lua_State *s)
 }
 
 
+/** LUA_CATEGORY Scheduling (scheduling)
+ * Script functions may suspend the thread they run in until some time
+ * passed or something happened, instead of registering a callback. The
+ * thread is resumed at the start of the tick in which its wait ended.
+ */
+
+/** LUA wait (scheduling)
+ * wait(int ticks)
+ **
+ * **Warning:** May only be called from a script thread, like an NPC talk
+ * function or a function started with spawn_thread.
+ *
+ * Suspends the current thread for the given number of ticks. A tick lasts
+ * 100 milliseconds.
+ */
+static int wait(lua_State *s)
+{
+    const int ticks = luaL_checkint(s, 1);
+    luaL_argcheck(s, ticks >= 0, 1, "negative number of ticks");
+
+    Script::Thread *thread = checkCurrentThread(s);
+    getScript(s)->getScheduler()->waitTicks(thread, ticks);
+    return lua_yield(s, 0);
+}
+
+/** LUA wait_for_event (scheduling)
+ * wait_for_event(string event)
+ **
+ * **Warning:** May only be called from a script thread.
+ *
+ * Suspends the current thread until the event is fired with fire_event.
+ */
+static int wait_for_event(lua_State *s)
+{
+    const char *event = luaL_checkstring(s, 1);
+
+    Script::Thread *thread = checkCurrentThread(s);
+    getScript(s)->getScheduler()->waitForEvent(thread, event);
+    return lua_yield(s, 0);
+}
+
+/** LUA fire_event (scheduling)
+ * fire_event(string event)
+ **
+ * Resumes all the threads waiting for the event at the start of the next
+ * tick.
+ */
+static int fire_event(lua_State *s)
+{
+    const char *event = luaL_checkstring(s, 1);
+    getScript(s)->getScheduler()->fireEvent(event);
+    return 0;
+}
+
+/** LUA wait_until_arrived (scheduling)
+ * wait_until_arrived(handle being)
+ **
+ * **Return value:** The being, or nil when it was removed from the map
+ * before it arrived.
+ *
+ * **Warning:** May only be called from a script thread.
+ *
+ * Suspends the current thread until the being reached its destination.
+ */
+static int wait_until_arrived(lua_State *s)
+{
+    Being *being = checkBeing(s, 1);
+
+    Script::Thread *thread = checkCurrentThread(s);
+    getScript(s)->getScheduler()->waitUntilArrived(thread, being);
+    return lua_yield(s, 0);
+}
+
+/** LUA spawn_thread (scheduling)
+ * spawn_thread(function f)
+ **
+ * Calls the function in a new script thread at the start of the next tick,
+ * so that it may use the functions above. The thread runs on the current
+ * map, if any.
+ */
+static int spawn_thread(lua_State *s)
+{
+    luaL_checktype(s, 1, LUA_TFUNCTION);
+    lua_settop(s, 1);
+
+    Script *script = getScript(s);
+    const Script::Context *context = script->getContext();
+    MapComposite *map = context ? context->map : 0;
+
+    Script::Ref function(luaL_ref(s, LUA_REGISTRYINDEX));
+    script->getScheduler()->start(function, map);
+    return 0;
+}
+
+
+/** LUA_CATEGORY Map states (mapstates)
+ * With the ''script_perMapStates'' option every active map runs its scripts
+ * in a state of its own, next to the state of the world scripts. The map
+ * state loads libmana.lua and then the scripts of the map and its NPCs.
+ *
+ * Local to the state of the map are its NPCs and map scripts, atinit and
+ * schedule functions, the on_death and on_remove callbacks, the listeners of
+ * map and world variables, on_update, on_mapupdate, on_map_message and the
+ * scheduling functions.
+ *
+ * Only the world state assigns on_craft, the attribute callbacks, the global
+ * character and being callbacks and the callbacks of the item, monster,
+ * special and status effect classes.
+ *
+ * Values can not be shared between the states. The maps use world variables
+ * (getvar_world and setvar_world) or messages for that.
+ */
+
+/** LUA map_send_message (mapstates)
+ * map_send_message(int map_id, string subject, string body)
+ **
+ * Sends a message to the scripts of the given map. It is passed to the
+ * on_map_message callback of that map at the start of the next tick.
+ * Messages to inactive maps are dropped.
+ */
+static int map_send_message(lua_State *s)
+{
+    const int mapId = luaL_checkint(s, 1);
+    const char *subject = luaL_checkstring(s, 2);
+    const char *body = luaL_checkstring(s, 3);
+
+    MapComposite *map = MapManager::getMap(mapId);
+    luaL_argcheck(s, map, 1, "invalid map id");
+
+    const Script::Context *context = getScript(s)->getContext();
+    const int senderId = context && context->map ? context->map->getID() : 0;
+
+    ScriptManager::postMapMessage(senderId, map, subject, body);
+    return 0;
+}
+
+
 /** LUA_CATEGORY Logging (logging)
  */
 
@@ -2633,91 +2826,349 @@ static int log(lua_State *s)
  * the following functions are available:
  */
 
-/** LUA get_beings_in_circle (area)
- * get_beings_in_circle(int x, int y, int radius)
- * get_beings_in_circle(handle being, int radius)
- **
- * **Return value:** This function returns a lua table of all beings in a
- * circle of radius (in pixels) ''radius'' centered either at the pixel at
- * (''x'', ''y'') or at the position of ''being''.
+/**
+ * Selects the beings returned by the area functions.
  */
-static int get_beings_in_circle(lua_State *s)
+struct BeingFilter
+{
+    BeingFilter():
+        type(-1),
+        party(0),
+        alive(-1)
+    {}
+
+    int type;           /**< Entity type, -1 for NPCs, characters and monsters. */
+    int party;          /**< Party of the characters, 0 for any. */
+    int alive;          /**< 1 for living beings, 0 for dead ones, -1 for any. */
+
+    bool accepts(Being *b) const
+    {
+        const int t = b->getType();
+        if (type == -1)
+        {
+            if (t != OBJECT_NPC && t != OBJECT_CHARACTER && t != OBJECT_MONSTER)
+                return false;
+        }
+        else if (t != type)
+        {
+            return false;
+        }
+
+        if (party && (t != OBJECT_CHARACTER ||
+                      static_cast<Character *>(b)->getParty() != party))
+            return false;
+
+        if (alive != -1 && (b->getAction() != DEAD) != (alive == 1))
+            return false;
+
+        return true;
+    }
+};
+
+/**
+ * Reads an optional filter table with the fields type, party and alive.
+ */
+static BeingFilter checkBeingFilter(lua_State *s, int p)
+{
+    BeingFilter filter;
+    if (lua_isnoneornil(s, p))
+        return filter;
+
+    luaL_checktype(s, p, LUA_TTABLE);
+
+    lua_getfield(s, p, "type");
+    if (!lua_isnil(s, -1))
+        filter.type = luaL_checkint(s, -1);
+    lua_getfield(s, p, "party");
+    if (!lua_isnil(s, -1))
+        filter.party = luaL_checkint(s, -1);
+    lua_getfield(s, p, "alive");
+    if (!lua_isnil(s, -1))
+        filter.alive = lua_toboolean(s, -1);
+    lua_pop(s, 3);
+
+    return filter;
+}
+
+/**
+ * A circle or rectangle on the map, with the filter of an area function.
+ */
+struct BeingArea
+{
+    BeingArea():
+        circle(true),
+        radius(0),
+        rect()
+    {}
+
+    bool contains(Being *b) const
+    {
+        if (!filter.accepts(b))
+            return false;
+        if (circle)
+            return Collision::circleWithCircle(b->getPosition(), b->getSize(),
+                                               center, radius);
+        return rect.contains(b->getPosition());
+    }
+
+    ZoneIterator getIterator(MapComposite *map) const
+    {
+        if (circle)
+            return map->getAroundPointIterator(center, radius);
+        return map->getInsideRectangleIterator(rect);
+    }
+
+    bool circle;
+    Point center;
+    int radius;
+    Rectangle rect;
+    BeingFilter filter;
+};
+
+/**
+ * Reads the arguments of a circle function, either (x, y, radius, filter)
+ * or (being, radius, filter).
+ */
+static BeingArea checkCircle(lua_State *s)
 {
-    int x, y, r;
+    BeingArea area;
+    int filterIndex;
     if (lua_islightuserdata(s, 1))
     {
         Being *b = checkBeing(s, 1);
-        const Point &pos = b->getPosition();
-        x = pos.x;
-        y = pos.y;
-        r = luaL_checkint(s, 2);
+        area.center = b->getPosition();
+        area.radius = luaL_checkint(s, 2);
+        filterIndex = 3;
     }
     else
     {
-        x = luaL_checkint(s, 1);
-        y = luaL_checkint(s, 2);
-        r = luaL_checkint(s, 3);
+        area.center.x = luaL_checkint(s, 1);
+        area.center.y = luaL_checkint(s, 2);
+        area.radius = luaL_checkint(s, 3);
+        filterIndex = 4;
     }
+    area.filter = checkBeingFilter(s, filterIndex);
+    return area;
+}
+
+/**
+ * Reads the arguments of a rectangle function: (x, y, width, height, filter).
+ */
+static BeingArea checkRectangle(lua_State *s)
+{
+    BeingArea area;
+    area.circle = false;
+    area.rect.x = luaL_checkint(s, 1);
+    area.rect.y = luaL_checkint(s, 2);
+    area.rect.w = luaL_checkint(s, 3);
+    area.rect.h = luaL_checkint(s, 4);
+    area.filter = checkBeingFilter(s, 5);
+    return area;
+}
 
+/**
+ * Pushes a table of the beings in the area.
+ */
+static int pushBeingsInArea(lua_State *s, const BeingArea &area)
+{
     MapComposite *m = checkCurrentMap(s);
 
-    //create a lua table with the beings in the given area.
     lua_newtable(s);
     int tableStackPosition = lua_gettop(s);
     int tableIndex = 1;
-    for (BeingIterator i(m->getAroundPointIterator(Point(x, y), r)); i; ++i)
+    for (BeingIterator i(area.getIterator(m)); i; ++i)
     {
         Being *b = *i;
-        char t = b->getType();
-        if (t == OBJECT_NPC || t == OBJECT_CHARACTER || t == OBJECT_MONSTER)
+        if (area.contains(b))
         {
-            if (Collision::circleWithCircle(b->getPosition(), b->getSize(),
-                                            Point(x, y), r))
-            {
-                lua_pushlightuserdata(s, b);
-                lua_rawseti(s, tableStackPosition, tableIndex);
-                tableIndex++;
-            }
+            lua_pushlightuserdata(s, b);
+            lua_rawseti(s, tableStackPosition, tableIndex);
+            tableIndex++;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * State of the iterator returned by beings_in_circle and beings_in_rectangle,
+ * kept in a userdata.
+ *
+ * The beings in the area are found up front, since the loop body may add
+ * beings to the zones or move them between zones. They are kept by public
+ * ID, so that beings removed in the meantime are skipped.
+ */
+struct BeingAreaQuery
+{
+    BeingAreaQuery(const BeingArea &area, MapComposite *map):
+        map(map),
+        next(0),
+        tick(GameState::getCurrentTick())
+    {
+        for (BeingIterator i(area.getIterator(map)); i; ++i)
+        {
+            if (area.contains(*i))
+                ids.push_back((*i)->getPublicID());
+        }
+    }
+
+    MapComposite *map;
+    std::vector<int> ids;
+    unsigned next;      /**< Index of the next ID in ids. */
+    int tick;           /**< The IDs may be reused after this tick. */
+};
+
+static int being_area_query_gc(lua_State *s)
+{
+    static_cast<BeingAreaQuery *>(lua_touserdata(s, 1))->~BeingAreaQuery();
+    return 0;
+}
+
+static int being_area_query_next(lua_State *s)
+{
+    BeingAreaQuery *query =
+            static_cast<BeingAreaQuery *>(lua_touserdata(s, lua_upvalueindex(1)));
+
+    if (query->tick != GameState::getCurrentTick())
+        luaL_error(s, "area iterator used after the tick it was created in");
+
+    while (query->next < query->ids.size())
+    {
+        if (Being *b = query->map->getBeing(query->ids[query->next++]))
+        {
+            lua_pushlightuserdata(s, b);
+            return 1;
         }
     }
 
+    return 0;
+}
+
+/**
+ * Pushes a function returning the next being in the area on every call.
+ */
+static int pushBeingAreaIterator(lua_State *s, const BeingArea &area)
+{
+    MapComposite *m = checkCurrentMap(s);
+
+    void *userData = lua_newuserdata(s, sizeof(BeingAreaQuery));
+    new (userData) BeingAreaQuery(area, m);
+
+    if (luaL_newmetatable(s, "BeingAreaQuery"))
+    {
+        lua_pushcfunction(s, &being_area_query_gc);
+        lua_setfield(s, -2, "__gc");
+    }
+    lua_setmetatable(s, -2);
+
+    lua_pushcclosure(s, &being_area_query_next, 1);
     return 1;
 }
 
+/** LUA get_beings_in_circle (area)
+ * get_beings_in_circle(int x, int y, int radius [, table filter])
+ * get_beings_in_circle(handle being, int radius [, table filter])
+ **
+ * **Return value:** This function returns a lua table of all beings in a
+ * circle of radius (in pixels) ''radius'' centered either at the pixel at
+ * (''x'', ''y'') or at the position of ''being''.
+ *
+ * The optional ''filter'' table selects the beings by their ''type''
+ * (one of the TYPE_* constants, NPCs, characters and monsters by default),
+ * their ''party'' (only characters of that party) and whether they are
+ * ''alive'' (true for living beings only, false for dead ones only).
+ *
+ * **Note:** When the table is only iterated, prefer
+ * [[scripting#beings_in_circle|beings_in_circle]], which does not create a
+ * table.
+ */
+static int get_beings_in_circle(lua_State *s)
+{
+    return pushBeingsInArea(s, checkCircle(s));
+}
+
 /** LUA get_beings_in_rectangle (area)
- * get_beings_in_rectangle(int x, int y, int width, int height)
+ * get_beings_in_rectangle(int x, int y, int width, int height
+ *                         [, table filter])
  **
  * **Return value:** An table of being objects within the rectangle.
- * All parameters have to be passed as pixels.
+ * All parameters have to be passed as pixels. See
+ * [[scripting#get_beings_in_circle|get_beings_in_circle]] for the
+ * ''filter''.
  */
 static int get_beings_in_rectangle(lua_State *s)
 {
-    const int x = luaL_checkint(s, 1);
-    const int y = luaL_checkint(s, 2);
-    const int w = luaL_checkint(s, 3);
-    const int h = luaL_checkint(s, 4);
+    return pushBeingsInArea(s, checkRectangle(s));
+}
+
+/** LUA beings_in_circle (area)
+ * beings_in_circle(int x, int y, int radius [, table filter])
+ * beings_in_circle(handle being, int radius [, table filter])
+ **
+ * **Return value:** An iterator over the beings that
+ * [[scripting#get_beings_in_circle|get_beings_in_circle]] would return,
+ * for use in a for loop, without creating a table. Beings removed from the
+ * map during the loop are skipped. The iterator can only be used during the
+ * tick it was created in.
+ *
+ * **Example:**
+ * <code lua>
+ * for monster in beings_in_circle(ch, 200, { type = TYPE_MONSTER,
+ *                                            alive = true }) do
+ *     being_damage(monster, 10, 5, 100, DAMAGE_PHYSICAL, ELEMENT_NEUTRAL)
+ * end
+ * </code>
+ */
+static int beings_in_circle(lua_State *s)
+{
+    return pushBeingAreaIterator(s, checkCircle(s));
+}
 
+/** LUA beings_in_rectangle (area)
+ * beings_in_rectangle(int x, int y, int width, int height [, table filter])
+ **
+ * **Return value:** An iterator over the beings that
+ * [[scripting#get_beings_in_rectangle|get_beings_in_rectangle]] would
+ * return. See [[scripting#beings_in_circle|beings_in_circle]].
+ */
+static int beings_in_rectangle(lua_State *s)
+{
+    return pushBeingAreaIterator(s, checkRectangle(s));
+}
+
+/** LUA count_beings_in_circle (area)
+ * count_beings_in_circle(int x, int y, int radius [, table filter])
+ * count_beings_in_circle(handle being, int radius [, table filter])
+ **
+ * **Return value:** The number of beings that
+ * [[scripting#get_beings_in_circle|get_beings_in_circle]] would return.
+ */
+static int count_beings_in_circle(lua_State *s)
+{
+    const BeingArea area = checkCircle(s);
     MapComposite *m = checkCurrentMap(s);
 
-    //create a lua table with the beings in the given area.
-    lua_newtable(s);
-    int tableStackPosition = lua_gettop(s);
-    int tableIndex = 1;
-    Rectangle rect = {x, y ,w, h};
-    for (BeingIterator i(m->getInsideRectangleIterator(rect)); i; ++i)
+    int count = 0;
+    for (BeingIterator i(area.getIterator(m)); i; ++i)
     {
-        Being *b = *i;
-        char t = b->getType();
-        if ((t == OBJECT_NPC || t == OBJECT_CHARACTER || t == OBJECT_MONSTER) &&
-            rect.contains(b->getPosition()))
-        {
-            lua_pushlightuserdata(s, b);
-            lua_rawseti(s, tableStackPosition, tableIndex);
-            tableIndex++;
-        }
+        if (area.contains(*i))
+            ++count;
     }
-     return 1;
- }
+
+    lua_pushinteger(s, count);
+    return 1;
+}
+
+/**
+ * Returns the distance between two points in pixels.
+ */
+static int distance(int x1, int y1, int x2, int y2)
+{
+    const int dx = x1 - x2;
+    const int dy = y1 - y2;
+    const float dist = sqrt((dx * dx) + (dy * dy));
+    return dist;
+}
 
 /** LUA get_distance (area)
  * get_distance(handle being1, handle being2)
@@ -2746,14 +3197,73 @@ static int get_distance(lua_State *s)
         x2 = luaL_checkint(s, 3);
         y2 = luaL_checkint(s, 4);
     }
-    const int dx = x1 - x2;
-    const int dy = y1 - y2;
-    const float dist = sqrt((dx * dx) + (dy * dy));
-    lua_pushinteger(s, dist);
+    lua_pushinteger(s, distance(x1, y1, x2, y2));
 
     return 1;
 }
 
+#ifdef BUILD_LUAJIT
+/**
+ * Fast paths of hot bindings, called through the LuaJIT FFI by
+ * scripts/lua/libmana-ffi.lua. The script checks the arguments, and falls
+ * back to the C API functions above for anything that is not a being.
+ */
+extern "C" {
+
+static int ffi_posX(void *being)
+{
+    return static_cast<Being *>(being)->getPosition().x;
+}
+
+static int ffi_posY(void *being)
+{
+    return static_cast<Being *>(being)->getPosition().y;
+}
+
+static int ffi_being_type(void *being)
+{
+    return static_cast<Being *>(being)->getType();
+}
+
+static double ffi_being_get_modified_attribute(void *being, int attr)
+{
+    // Truncated like the value pushed by being_get_modified_attribute
+    return lua_Integer(static_cast<Being *>(being)->getModifiedAttribute(attr));
+}
+
+static int ffi_get_distance(void *being1, void *being2)
+{
+    const Point &p1 = static_cast<Being *>(being1)->getPosition();
+    const Point &p2 = static_cast<Being *>(being2)->getPosition();
+    return distance(p1.x, p1.y, p2.x, p2.y);
+}
+
+} // extern "C"
+
+static void setFfiBinding(lua_State *s, const char *name, void *function)
+{
+    lua_pushlightuserdata(s, function);
+    lua_setfield(s, -2, name);
+}
+
+/**
+ * Makes the fast paths available to libmana-ffi.lua.
+ */
+static void registerFfiBindings(lua_State *s)
+{
+    lua_createtable(s, 0, 6);
+    setFfiBinding(s, "posX", reinterpret_cast<void *>(&ffi_posX));
+    setFfiBinding(s, "posY", reinterpret_cast<void *>(&ffi_posY));
+    setFfiBinding(s, "being_type", reinterpret_cast<void *>(&ffi_being_type));
+    setFfiBinding(s, "being_get_modified_attribute",
+                  reinterpret_cast<void *>(&ffi_being_get_modified_attribute));
+    setFfiBinding(s, "get_distance",
+                  reinterpret_cast<void *>(&ffi_get_distance));
+    setFfiBinding(s, "null", 0);
+    lua_setglobal(s, "ffi_bindings");
+}
+#endif
+
 
 /** LUA_CATEGORY Special info class (specialinfo)
  * See the [[specials.xml#A script example|specials Documentation]] for a
@@ -2928,11 +3438,15 @@ static int get_monster_class(lua_State *s)
 }
 
 /** LUA monsterclass:on_update (monsterclass)
- * monsterclass:on_update(function callback)
+ * monsterclass:on_update(function callback [, bool batched])
  **
  * Assigns the ''callback'' as callback for the monster update event. This
  * callback will be called every tick for each monster of that class.
  *
+ * When ''batched'' is true, the callback is instead called once per tick and
+ * map with an array of all the monsters of that class on the map, after
+ * the monsters were updated. This saves a call into Lua per monster.
+ *
  * **Note:** See [[scripting#get_monster_class|get_monster_class]] for getting
  * a monsterclass object.
  */
@@ -2940,7 +3454,9 @@ static int monster_class_on_update(lua_State *s)
 {
     MonsterClass *monsterClass = LuaMonsterClass::check(s, 1);
     luaL_checktype(s, 2, LUA_TFUNCTION);
-    monsterClass->setUpdateCallback(getScript(s));
+    const bool batched = lua_toboolean(s, 3);
+    lua_settop(s, 2);
+    monsterClass->setUpdateCallback(getScript(s), batched);
     return 0;
 }
 
@@ -3441,7 +3957,14 @@ static int require_loader(lua_State *s)
 
     const std::string path = ResourceManager::resolve(filename);
     if (!path.empty())
+    {
+        Script *script = getScript(s);
+        const Script::Context *context = script->getContext();
+        if (!context || !context->map)
+            script->addLoadedFile(filename);
+
         luaL_loadfile(s, path.c_str());
+    }
     else
         lua_pushliteral(s, "File not found");
 
@@ -3449,13 +3972,56 @@ static int require_loader(lua_State *s)
 }
 
 
+static int panic(lua_State *s)
+{
+    LOG_FATAL("Unprotected error in call to Lua API: "
+              << lua_tostring(s, -1));
+    return 0;
+}
+
 LuaScript::LuaScript():
-    nbArgs(-1)
+    nbArgs(-1),
+    mPooled(true),
+    mGcThreshold(0)
 {
-    mRootState = luaL_newstate();
+    LuaBytecodeCache::initialize();
+
+    mRootState = lua_newstate(&LuaAllocator::allocate, &mMemoryUsage);
+    if (mRootState)
+    {
+        lua_atpanic(mRootState, &panic);
+    }
+    else
+    {
+        // LuaJIT does not accept custom allocators on some platforms
+        LOG_WARN("Could not use the pool allocator for Lua.");
+        mRootState = luaL_newstate();
+        mPooled = false;
+    }
     mCurrentState = mRootState;
     luaL_openlibs(mRootState);
 
+    // The collector runs automatically once the memory grew by
+    // script_gcPause percent, and is stepped in the idle time of the world
+    // tick once it grew by script_gcIdlePause percent.
+    lua_gc(mRootState, LUA_GCSETPAUSE,
+           Configuration::getValue("script_gcPause", 200));
+    lua_gc(mRootState, LUA_GCSETSTEPMUL,
+           Configuration::getValue("script_gcStepMul", 200));
+    mGcStepSize = Configuration::getValue("script_gcStepSize", 16);
+    mGcIdlePause = Configuration::getValue("script_gcIdlePause", 120);
+
+    // The watchdog looks at the time every script_hookInstructions
+    // instructions. Threads created later inherit the hook.
+    mCallBudget = Configuration::getValue("script_callBudget", 50000);
+    mTickBudget = Configuration::getValue("script_tickBudget", 30000);
+    mSlowCall = Configuration::getValue("script_slowCall", 5000);
+    mMaxForcedYields = Configuration::getValue("script_maxForcedYields", 50);
+    const int hookInstructions =
+            Configuration::getValue("script_hookInstructions", 1000);
+    if (hookInstructions > 0)
+        lua_sethook(mRootState, &watchdog, LUA_MASKCOUNT, hookInstructions);
+
     // Register package loader that goes through the resource manager
     // package.loaders[2] = require_loader
     lua_getglobal(mRootState, "package");
@@ -3484,6 +4050,7 @@ LuaScript::LuaScript():
         { "on_mapvar_changed",               &on_mapvar_changed               },
         { "on_worldvar_changed",             &on_worldvar_changed             },
         { "on_mapupdate",                    &on_mapupdate                    },
+        { "on_map_message",                  &on_map_message                  },
         { "get_item_class",                  &get_item_class                  },
         { "get_monster_class",               &get_monster_class               },
         { "get_status_effect",               &get_status_effect               },
@@ -3505,6 +4072,7 @@ LuaScript::LuaScript():
         { "chr_unequip_item",                &chr_unequip_item                },
         { "chr_get_level",                   &chr_get_level                   },
         { "chr_get_quest",                   &chr_get_quest                   },
+        { "chr_get_quests",                  &chr_get_quests                  },
         { "chr_set_quest",                   &chr_set_quest                   },
         { "chr_request_quest",               &chr_request_quest               },
         { "chr_try_get_quest",               &chr_try_get_quest               },
@@ -3568,6 +4136,9 @@ LuaScript::LuaScript():
         { "chat_message",                    &chat_message                    },
         { "get_beings_in_circle",            &get_beings_in_circle            },
         { "get_beings_in_rectangle",         &get_beings_in_rectangle         },
+        { "beings_in_circle",                &beings_in_circle                },
+        { "beings_in_rectangle",             &beings_in_rectangle             },
+        { "count_beings_in_circle",          &count_beings_in_circle          },
         { "get_character_by_name",           &get_character_by_name           },
         { "being_register",                  &being_register                  },
         { "effect_create",                   &effect_create                   },
@@ -3582,6 +4153,12 @@ LuaScript::LuaScript():
         { "item_get_name",                   &item_get_name                   },
         { "npc_ask_integer",                 &npc_ask_integer                 },
         { "npc_ask_string",                  &npc_ask_string                  },
+        { "wait",                            &wait                            },
+        { "wait_for_event",                  &wait_for_event                  },
+        { "fire_event",                      &fire_event                      },
+        { "wait_until_arrived",              &wait_until_arrived              },
+        { "spawn_thread",                    &spawn_thread                    },
+        { "map_send_message",                &map_send_message                },
         { "log",                             &log                             },
         { "get_distance",                    &get_distance                    },
         { "map_get_objects",                 &map_get_objects                 },
@@ -3675,5 +4252,10 @@ LuaScript::LuaScript():
     lua_getfield(mRootState, -1, "traceback");
     lua_remove(mRootState, 1);                  // remove the 'debug' table
 
+#ifdef BUILD_LUAJIT
+    if (Configuration::getBoolValue("script_ffi", true))
+        registerFfiBindings(mRootState);
+#endif
+
     loadFile("scripts/lua/libmana.lua");
 }
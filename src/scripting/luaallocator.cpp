@@ -0,0 +1,164 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "scripting/luaallocator.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/** Granularity of the size classes, in bytes. */
+static const size_t GRANULARITY = 8;
+static const size_t CLASS_COUNT = LuaAllocator::MAX_POOLED / GRANULARITY;
+
+/** Size of the chunks the blocks are carved from. */
+static const size_t CHUNK_SIZE = 16 * 1024;
+
+/** A free block, linked to the next free block of its size class. */
+struct FreeBlock
+{
+    FreeBlock *next;
+};
+
+static FreeBlock *freeLists[CLASS_COUNT];
+static std::vector<char *> chunks;
+static size_t poolFree;
+
+static size_t sizeClass(size_t size)
+{
+    return (size - 1) / GRANULARITY;
+}
+
+/**
+ * Carves a new chunk into blocks of the given size class.
+ */
+static bool refill(size_t index)
+{
+    const size_t blockSize = (index + 1) * GRANULARITY;
+    char *chunk = static_cast<char *>(std::malloc(CHUNK_SIZE));
+    if (!chunk)
+        return false;
+
+    chunks.push_back(chunk);
+
+    const size_t count = CHUNK_SIZE / blockSize;
+    for (size_t i = 0; i < count; ++i)
+    {
+        FreeBlock *block = reinterpret_cast<FreeBlock *>(chunk + i * blockSize);
+        block->next = freeLists[index];
+        freeLists[index] = block;
+    }
+    poolFree += count * blockSize;
+    return true;
+}
+
+static void *allocateBlock(size_t size)
+{
+    if (size > LuaAllocator::MAX_POOLED)
+        return std::malloc(size);
+
+    const size_t index = sizeClass(size);
+    if (!freeLists[index] && !refill(index))
+        return 0;
+
+    FreeBlock *block = freeLists[index];
+    freeLists[index] = block->next;
+    poolFree -= (index + 1) * GRANULARITY;
+    return block;
+}
+
+static void freeBlock(void *ptr, size_t size)
+{
+    if (size > LuaAllocator::MAX_POOLED)
+    {
+        std::free(ptr);
+        return;
+    }
+
+    const size_t index = sizeClass(size);
+    FreeBlock *block = static_cast<FreeBlock *>(ptr);
+    block->next = freeLists[index];
+    freeLists[index] = block;
+    poolFree += (index + 1) * GRANULARITY;
+}
+
+void *LuaAllocator::allocate(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+    Usage *usage = static_cast<Usage *>(ud);
+
+    // Since Lua 5.2, osize holds the type of the object for new blocks
+    if (!ptr)
+        osize = 0;
+
+    if (nsize == 0)
+    {
+        if (ptr)
+        {
+            freeBlock(ptr, osize);
+            usage->bytes -= osize;
+        }
+        return 0;
+    }
+
+    void *result;
+    if (!ptr)
+    {
+        result = allocateBlock(nsize);
+    }
+    else if (osize > MAX_POOLED && nsize > MAX_POOLED)
+    {
+        result = std::realloc(ptr, nsize);
+    }
+    else if (osize <= MAX_POOLED && nsize <= MAX_POOLED &&
+             sizeClass(osize) == sizeClass(nsize))
+    {
+        result = ptr;
+    }
+    else
+    {
+        // Moving between size classes, or between the pool and the system
+        result = allocateBlock(nsize);
+        if (result)
+        {
+            std::memcpy(result, ptr, osize < nsize ? osize : nsize);
+            freeBlock(ptr, osize);
+        }
+    }
+
+    // On failure Lua keeps the old block
+    if (!result)
+        return 0;
+
+    usage->bytes += nsize - osize;
+    if (usage->bytes > usage->peak)
+        usage->peak = usage->bytes;
+    return result;
+}
+
+size_t LuaAllocator::getPoolSize()
+{
+    return chunks.size() * CHUNK_SIZE;
+}
+
+size_t LuaAllocator::getPoolFree()
+{
+    return poolFree;
+}
@@ -0,0 +1,67 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef LUAALLOCATOR_H
+#define LUAALLOCATOR_H
+
+#include <cstddef>
+
+/**
+ * Memory allocator for the Lua states.
+ *
+ * Lua allocates lots of small blocks for strings, tables and closures. Blocks
+ * up to MAX_POOLED bytes are served from free lists of fixed size classes,
+ * backed by chunks that are kept for the lifetime of the process. Larger
+ * blocks go to the system allocator.
+ *
+ * Every state passes its own Usage as the userdata of the allocator, so that
+ * the memory used by each script is known.
+ */
+namespace LuaAllocator
+{
+    /** Largest block served from the pool, in bytes. */
+    const size_t MAX_POOLED = 256;
+
+    struct Usage
+    {
+        Usage(): bytes(0), peak(0) {}
+
+        size_t bytes;       /**< Bytes currently allocated. */
+        size_t peak;        /**< Highest value of bytes. */
+    };
+
+    /**
+     * The lua_Alloc function. The userdata has to point to a Usage.
+     */
+    void *allocate(void *ud, void *ptr, size_t osize, size_t nsize);
+
+    /**
+     * Returns the memory reserved by the pool, in bytes.
+     */
+    size_t getPoolSize();
+
+    /**
+     * Returns the memory of the pool that is not in use, in bytes.
+     */
+    size_t getPoolFree();
+}
+
+#endif // LUAALLOCATOR_H
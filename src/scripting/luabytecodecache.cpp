@@ -0,0 +1,259 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "scripting/luabytecodecache.h"
+
+#include "common/configuration.h"
+#include "utils/logger.h"
+#include "utils/sha256.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+extern "C" {
+#include <lauxlib.h>
+}
+
+#ifdef BUILD_LUAJIT
+extern "C" {
+#include <luajit.h>
+}
+#endif
+
+static bool initialized;
+static std::string cacheDir;    /**< Empty when the cache is disabled. */
+static unsigned hits;
+static unsigned misses;
+
+/**
+ * Hands a whole buffer to lua_load at once.
+ */
+struct Buffer
+{
+    const char *data;
+    size_t size;
+};
+
+static const char *readBuffer(lua_State *, void *data, size_t *size)
+{
+    Buffer *buffer = static_cast<Buffer*>(data);
+    *size = buffer->size;
+    buffer->size = 0;
+    return *size ? buffer->data : 0;
+}
+
+static int writeString(lua_State *, const void *p, size_t size, void *data)
+{
+    static_cast<std::string*>(data)->append(static_cast<const char*>(p), size);
+    return 0;
+}
+
+static int loadBuffer(lua_State *s, const char *data, size_t size,
+                      const char *name)
+{
+    Buffer buffer = { data, size };
+#if LUA_VERSION_NUM >= 502
+    return lua_load(s, &readBuffer, &buffer, name, 0);
+#else
+    return lua_load(s, &readBuffer, &buffer, name);
+#endif
+}
+
+static int dumpFunction(lua_State *s, std::string &bytecode)
+{
+#if LUA_VERSION_NUM >= 503
+    return lua_dump(s, &writeString, &bytecode, 0);
+#else
+    return lua_dump(s, &writeString, &bytecode);
+#endif
+}
+
+static bool makeDirectory(const std::string &path)
+{
+#ifdef _WIN32
+    return _mkdir(path.c_str()) == 0;
+#else
+    return mkdir(path.c_str(), 0755) == 0;
+#endif
+}
+
+/**
+ * Returns the file the dump of the given chunk is stored in. The dumps of
+ * one Lua version cannot be loaded by another, so the version is part of
+ * the hash.
+ */
+static std::string cachePath(const char *prog, size_t size, const char *name)
+{
+    std::string key;
+#ifdef LUAJIT_VERSION
+    key += LUAJIT_VERSION;
+#else
+    key += LUA_RELEASE;
+#endif
+    key += '\0';
+    key += name;
+    key += '\0';
+    key.append(prog, size);
+
+    return cacheDir + "/" + sha256(key) + ".luac";
+}
+
+static bool readFile(const std::string &path, std::string &contents)
+{
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+        return false;
+
+    std::ostringstream os;
+    os << file.rdbuf();
+    contents = os.str();
+    return !contents.empty();
+}
+
+/**
+ * Writes the file under a temporary name first, so that a server that is
+ * stopped halfway does not leave a truncated dump behind.
+ */
+static void writeFile(const std::string &path, const std::string &contents)
+{
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary.c_str(),
+                           std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.write(contents.data(), contents.size()))
+        {
+            LOG_WARN("Could not write Lua bytecode cache file " << temporary);
+            return;
+        }
+    }
+
+    std::remove(path.c_str());
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        LOG_WARN("Could not write Lua bytecode cache file " << path);
+        std::remove(temporary.c_str());
+    }
+}
+
+void LuaBytecodeCache::initialize()
+{
+    if (initialized)
+        return;
+
+    initialized = true;
+    cacheDir = Configuration::getValue("script_cacheDir", std::string());
+    if (cacheDir.empty())
+        return;
+
+    struct stat info;
+    if (stat(cacheDir.c_str(), &info) != 0 && !makeDirectory(cacheDir))
+    {
+        LOG_WARN("Could not create the Lua bytecode cache directory "
+                 << cacheDir << ", the cache is disabled.");
+        cacheDir.clear();
+        return;
+    }
+
+    LOG_INFO("Using Lua bytecode cache: " << cacheDir);
+}
+
+int LuaBytecodeCache::load(lua_State *s, const char *prog, size_t size,
+                           const char *name)
+{
+    if (cacheDir.empty())
+        return loadBuffer(s, prog, size, name);
+
+    const std::string path = cachePath(prog, size, name);
+
+    std::string bytecode;
+    if (readFile(path, bytecode))
+    {
+        if (loadBuffer(s, bytecode.data(), bytecode.size(), name) == 0)
+        {
+            ++hits;
+            LOG_DEBUG("Lua bytecode cache hit for " << name);
+            return 0;
+        }
+
+        // A damaged dump, compile the source and replace it
+        lua_pop(s, 1);
+    }
+
+    ++misses;
+    LOG_DEBUG("Lua bytecode cache miss for " << name);
+
+    const int result = loadBuffer(s, prog, size, name);
+    if (result != 0)
+        return result;
+
+    bytecode.clear();
+    if (dumpFunction(s, bytecode) == 0 && !bytecode.empty())
+        writeFile(path, bytecode);
+
+    return 0;
+}
+
+bool LuaBytecodeCache::compile(const char *prog, size_t size,
+                               const char *name, std::string &bytecode)
+{
+    lua_State *s = luaL_newstate();
+    if (!s)
+        return false;
+
+    bytecode.clear();
+    const bool compiled = loadBuffer(s, prog, size, name) == 0 &&
+                          dumpFunction(s, bytecode) == 0 &&
+                          !bytecode.empty();
+    lua_close(s);
+    return compiled;
+}
+
+int LuaBytecodeCache::loadCompiled(lua_State *s, const std::string &bytecode,
+                                   const char *name)
+{
+    return loadBuffer(s, bytecode.data(), bytecode.size(), name);
+}
+
+void LuaBytecodeCache::logStatistics()
+{
+    if (!cacheDir.empty())
+        LOG_INFO("Lua bytecode cache: " << hits << " hits, "
+                 << misses << " misses");
+}
+
+unsigned LuaBytecodeCache::getHits()
+{
+    return hits;
+}
+
+unsigned LuaBytecodeCache::getMisses()
+{
+    return misses;
+}
@@ -0,0 +1,80 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LUABYTECODECACHE_H
+#define LUABYTECODECACHE_H
+
+#include <cstddef>
+#include <string>
+
+extern "C" {
+#include <lua.h>
+}
+
+/**
+ * Keeps the compiled form of the loaded Lua chunks in a local directory, so
+ * that the scripts and NPCs do not need to be compiled again every time the
+ * server starts or a map is activated.
+ *
+ * The dumps are stored under the SHA-256 of the source, its chunk name and
+ * the Lua version. A changed script therefore simply misses the cache, and
+ * stale dumps are never loaded.
+ */
+namespace LuaBytecodeCache
+{
+    /**
+     * Reads the cache directory from the configuration and creates it when
+     * needed. An empty directory disables the cache. Only the first call
+     * does anything.
+     */
+    void initialize();
+
+    /**
+     * Loads a chunk like luaL_loadbuffer does, from the cache when it holds
+     * a dump of the given source, otherwise from the source itself. In the
+     * latter case the compiled chunk is added to the cache.
+     */
+    int load(lua_State *s, const char *prog, size_t size, const char *name);
+
+    /**
+     * Compiles a chunk in a Lua state of its own and dumps it, so that it
+     * can be done on any thread. The cache is not used.
+     *
+     * @return whether the chunk compiled
+     */
+    bool compile(const char *prog, size_t size, const char *name,
+                 std::string &bytecode);
+
+    /**
+     * Loads a chunk dumped by compile() like luaL_loadbuffer does.
+     */
+    int loadCompiled(lua_State *s, const std::string &bytecode,
+                     const char *name);
+
+    /**
+     * Logs the number of chunks loaded from the cache and compiled.
+     */
+    void logStatistics();
+
+    unsigned getHits();
+    unsigned getMisses();
+}
+
+#endif // LUABYTECODECACHE_H
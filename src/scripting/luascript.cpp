@@ -21,23 +21,85 @@
 
 #include "luascript.h"
 
+#include "scripting/luabytecodecache.h"
 #include "scripting/luautil.h"
 #include "scripting/scriptmanager.h"
+#include "scripting/scriptscheduler.h"
 
+#include "common/configuration.h"
 #include "game-server/character.h"
+#include "game-server/state.h"
+#include "game-server/tickprofiler.h"
 #include "utils/logger.h"
+#include "utils/timer.h"
 
 #include <cassert>
 #include <cstring>
-
-Script::Ref LuaScript::mDeathNotificationCallback;
-Script::Ref LuaScript::mRemoveNotificationCallback;
+#include <sstream>
 
 const char LuaScript::registryKey = 0;
 
+/*
+ * The script states all run on the main thread, and may call each other, so
+ * the time is measured once for the outermost call.
+ */
+static int callDepth;
+static uint64_t callStart;
+static std::string slowSource;      /**< Where the current call got slow. */
+static bool yieldForced;
+
+static int tickTime;                /**< Time spent in scripts this tick. */
+static int tickTimeTick;
+
+static int getTickTime()
+{
+    const int tick = GameState::getCurrentTick();
+    if (tick != tickTimeTick)
+    {
+        tickTimeTick = tick;
+        tickTime = 0;
+    }
+    return tickTime;
+}
+
 LuaScript::~LuaScript()
 {
+    // The waiting threads still need the Lua state
+    delete mScheduler;
+    mScheduler = 0;
+    finishThreads();
+
     lua_close(mRootState);
+
+    LuaBytecodeCache::logStatistics();
+}
+
+bool LuaScript::collectGarbage()
+{
+    if (getMemoryUsage() < mGcThreshold)
+        return false;
+
+    if (lua_gc(mRootState, LUA_GCSTEP, mGcStepSize))
+    {
+        // The cycle is finished, wait until the memory has grown again
+        mGcThreshold = getMemoryUsage() / 100 * mGcIdlePause;
+        return false;
+    }
+    return true;
+}
+
+size_t LuaScript::getMemoryUsage() const
+{
+    if (mPooled)
+        return mMemoryUsage.bytes;
+
+    return lua_gc(mRootState, LUA_GCCOUNT, 0) * 1024 +
+           lua_gc(mRootState, LUA_GCCOUNTB, 0);
+}
+
+size_t LuaScript::getPeakMemoryUsage() const
+{
+    return mPooled ? mMemoryUsage.peak : getMemoryUsage();
 }
 
 void LuaScript::prepare(Ref function)
@@ -96,6 +158,18 @@ void LuaScript::push(Entity *v)
     ++nbArgs;
 }
 
+void LuaScript::push(const std::vector<Entity*> &entities)
+{
+    assert(nbArgs >= 0);
+    lua_createtable(mCurrentState, entities.size(), 0);
+    for (unsigned i = 0; i < entities.size(); ++i)
+    {
+        lua_pushlightuserdata(mCurrentState, entities[i]);
+        lua_rawseti(mCurrentState, -2, i + 1);
+    }
+    ++nbArgs;
+}
+
 void LuaScript::push(const std::list<InventoryItem> &itemList)
 {
     assert(nbArgs >= 0);
@@ -118,6 +192,76 @@ void LuaScript::push(const std::list<InventoryItem> &itemList)
     ++nbArgs;
 }
 
+void LuaScript::beginCall()
+{
+    if (callDepth++ == 0)
+    {
+        callStart = utils::getTimeInMicrosec();
+        slowSource.clear();
+    }
+}
+
+void LuaScript::endCall()
+{
+    if (--callDepth)
+        return;
+
+    const int elapsed = utils::getTimeInMicrosec() - callStart;
+    tickTime = getTickTime() + elapsed;
+
+    if (!slowSource.empty())
+        TickProfiler::recordSlowScript(slowSource, elapsed);
+}
+
+void LuaScript::watchdog(lua_State *s, lua_Debug *ar)
+{
+    // Loading a script is not limited
+    if (!callDepth)
+        return;
+
+    LuaScript *script = static_cast<LuaScript *>(getScript(s));
+    const int elapsed = utils::getTimeInMicrosec() - callStart;
+
+    if (elapsed > script->mSlowCall && slowSource.empty())
+    {
+        lua_getinfo(s, "Sl", ar);
+        std::ostringstream source;
+        source << ar->short_src << ":" << ar->currentline;
+        slowSource = source.str();
+    }
+
+    const bool overCall = script->mCallBudget && elapsed > script->mCallBudget;
+    const bool overTick = script->mTickBudget &&
+            getTickTime() + elapsed > script->mTickBudget;
+    if (!overCall && !overTick)
+        return;
+
+    // A thread that was resumed directly can continue in a later tick
+    LuaThread *thread = static_cast<LuaThread *>(script->mCurrentThread);
+    if (thread && thread->mState == s && callDepth == 1)
+    {
+        if (++thread->mForcedYields <= script->mMaxForcedYields)
+        {
+            LOG_DEBUG("Suspending script thread over its time budget at "
+                      << slowSource);
+            script->mScheduler->waitTicks(thread, 1);
+            yieldForced = true;
+            lua_yield(s, 0);
+            return;
+        }
+
+        luaL_error(s, "script thread kept running for %d ticks",
+                   script->mMaxForcedYields);
+    }
+
+    // Callbacks can not be suspended, only aborted
+    if (overCall)
+    {
+        luaL_error(s, "script call exceeded its time budget of %d us",
+                   script->mCallBudget);
+    }
+}
+
 int LuaScript::execute(const Context &context)
 {
     assert(nbArgs >= 0);
@@ -127,7 +271,9 @@ int LuaScript::execute(const Context &context)
 
     const int tmpNbArgs = nbArgs;
     nbArgs = -1;
+    beginCall();
     int res = lua_pcall(mCurrentState, tmpNbArgs, 1, 1);
+    endCall();
 
     if (res || !(lua_isnil(mCurrentState, -1) || lua_isnumber(mCurrentState, -1)))
     {
@@ -137,6 +283,7 @@ int LuaScript::execute(const Context &context)
                  << "     Script  : " << mScriptFile << std::endl
                  << "     Error   : " << (s ? s : "") << std::endl);
         lua_pop(mCurrentState, 1);
+        mContext = previousContext;
         return 0;
     }
     res = lua_tointeger(mCurrentState, -1);
@@ -155,11 +302,16 @@ bool LuaScript::resume()
 
     const int tmpNbArgs = nbArgs;
     nbArgs = -1;
+    beginCall();
 #if LUA_VERSION_NUM < 502
     int result = lua_resume(mCurrentState, tmpNbArgs);
-#else
+#elif LUA_VERSION_NUM < 504
     int result = lua_resume(mCurrentState, NULL, tmpNbArgs);
+#else
+    int nbResults;
+    int result = lua_resume(mCurrentState, NULL, tmpNbArgs, &nbResults);
 #endif
+    endCall();
 
     if (result == 0)                // Thread is done
     {
@@ -170,6 +322,12 @@ bool LuaScript::resume()
     {
         if (lua_gettop(mCurrentState) > 0)
             LOG_WARN("Ignoring values passed to yield!");
+
+        LuaThread *thread = static_cast<LuaThread *>(mCurrentThread);
+        if (yieldForced)
+            yieldForced = false;
+        else
+            thread->mForcedYields = 0;
     }
     else                            // Thread encountered an error
     {
@@ -187,15 +345,16 @@ bool LuaScript::resume()
     mContext = previousContext;
     const bool done = result != LUA_YIELD;
 
+    Thread *thread = mCurrentThread;
+    mCurrentThread = 0;
+    mCurrentState = mRootState;
+
     if (done)
     {
-        // Clean up the current thread (not sure if this is the best place)
-        delete mCurrentThread;
+        thread->signal_finished.emit(thread);
+        delete thread;
     }
 
-    mCurrentThread = 0;
-    mCurrentState = mRootState;
-
     return done;
 }
 
@@ -221,10 +380,27 @@ void LuaScript::unref(Ref &ref)
 
 void LuaScript::load(const char *prog, const char *name,
                      const Context &context)
+{
+    run(LuaBytecodeCache::load(mRootState, prog, std::strlen(prog), name),
+        context);
+}
+
+bool LuaScript::compile(const char *prog, const char *name,
+                        std::string &compiled) const
+{
+    return LuaBytecodeCache::compile(prog, std::strlen(prog), name, compiled);
+}
+
+void LuaScript::loadCompiled(const std::string &compiled, const char *name,
+                             const Context &context)
+{
+    run(LuaBytecodeCache::loadCompiled(mRootState, compiled, name), context);
+}
+
+void LuaScript::run(int res, const Context &context)
 {
     const Context *previousContext = mContext;
     mContext = &context;
-    int res = luaL_loadbuffer(mRootState, prog, std::strlen(prog), name);
     if (res)
     {
         switch (res) {
@@ -280,7 +456,8 @@ void LuaScript::getQuestCallback(Character *q,
                                  Script *script)
 {
     Script::Thread *thread = q->getNpcThread();
-    if (!thread || thread->mState != Script::ThreadExpectingString)
+    if (!thread || thread->mScript != script ||
+        thread->mState != Script::ThreadExpectingString)
         return;
 
     script->prepareResume(thread);
@@ -297,7 +474,8 @@ void LuaScript::getPostCallback(Character *q,
                                 Script *script)
 {
     Script::Thread *thread = q->getNpcThread();
-    if (!thread || thread->mState != Script::ThreadExpectingTwoStrings)
+    if (!thread || thread->mScript != script ||
+        thread->mState != Script::ThreadExpectingTwoStrings)
         return;
 
     script->prepareResume(thread);
@@ -308,7 +486,8 @@ void LuaScript::getPostCallback(Character *q,
 
 
 LuaScript::LuaThread::LuaThread(LuaScript *script) :
-    Thread(script)
+    Thread(script),
+    mForcedYields(0)
 {
     mState = lua_newthread(script->mRootState);
     mRef = luaL_ref(script->mRootState, LUA_REGISTRYINDEX);
@@ -26,6 +26,7 @@ extern "C" {
 #include <lauxlib.h>
 }
 
+#include "scripting/luaallocator.h"
 #include "scripting/script.h"
 
 class Character;
@@ -47,6 +48,12 @@ class LuaScript : public Script
         void load(const char *prog, const char *name,
                   const Context &context = Context());
 
+        bool compile(const char *prog, const char *name,
+                     std::string &compiled) const;
+
+        void loadCompiled(const std::string &compiled, const char *name,
+                          const Context &context = Context());
+
         Thread *newThread();
 
         void prepare(Ref function);
@@ -59,6 +66,8 @@ class LuaScript : public Script
 
         void push(Entity *);
 
+        void push(const std::vector<Entity*> &entities);
+
         void push(const std::list<InventoryItem> &itemList);
 
         int execute(const Context &context = Context());
@@ -69,6 +78,12 @@ class LuaScript : public Script
 
         void unref(Ref &ref);
 
+        bool collectGarbage();
+
+        size_t getMemoryUsage() const;
+
+        size_t getPeakMemoryUsage() const;
+
         static void getQuestCallback(Character *,
                                      const std::string &value,
                                      Script *);
@@ -84,10 +99,16 @@ class LuaScript : public Script
 
 
         static void setDeathNotificationCallback(Script *script)
-        { script->assignCallback(mDeathNotificationCallback); }
+        {
+            LuaScript *luaScript = static_cast<LuaScript*>(script);
+            script->assignCallback(luaScript->mDeathNotificationCallback);
+        }
 
         static void setRemoveNotificationCallback(Script *script)
-        { script->assignCallback(mRemoveNotificationCallback); }
+        {
+            LuaScript *luaScript = static_cast<LuaScript*>(script);
+            script->assignCallback(luaScript->mRemoveNotificationCallback);
+        }
 
         static const char registryKey;
 
@@ -100,14 +121,42 @@ class LuaScript : public Script
 
                 lua_State *mState;
                 int mRef;
+                unsigned mForcedYields; /**< In a row, by the watchdog. */
         };
 
+        void beginCall();
+        void endCall();
+
+        /**
+         * Executes the chunk on top of the stack, or reports why it could
+         * not be loaded.
+         */
+        void run(int loadResult, const Context &context);
+
+        /**
+         * Called every few instructions. Suspends threads and aborts calls
+         * that run over their time budget.
+         */
+        static void watchdog(lua_State *s, lua_Debug *ar);
+
         lua_State *mRootState;
         lua_State *mCurrentState;
         int nbArgs;
 
-        static Ref mDeathNotificationCallback;
-        static Ref mRemoveNotificationCallback;
+        LuaAllocator::Usage mMemoryUsage;
+        bool mPooled;               /**< Whether the pool allocator is used. */
+
+        int mCallBudget;            /**< In microseconds, 0 for none. */
+        int mTickBudget;            /**< In microseconds, 0 for none. */
+        int mSlowCall;              /**< Calls reported as slow, in us. */
+        unsigned mMaxForcedYields;  /**< Before a thread is killed. */
+
+        int mGcStepSize;            /**< In kilobytes. */
+        int mGcIdlePause;           /**< Growth that starts idle steps. */
+        size_t mGcThreshold;        /**< Memory that starts idle steps. */
+
+        Ref mDeathNotificationCallback;
+        Ref mRemoveNotificationCallback;
 
         friend class LuaThread;
 };
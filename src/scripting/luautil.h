@@ -28,6 +28,12 @@ extern "C" {
 #include <lauxlib.h>
 }
 
+// Removed in Lua 5.3 unless built with compatibility
+#ifndef luaL_checkint
+#define luaL_checkint(L, n)     ((int) luaL_checkinteger(L, (n)))
+#define luaL_optint(L, n, d)    ((int) luaL_optinteger(L, (n), (d)))
+#endif
+
 #include <string>
 #include <list>
 #include <map>
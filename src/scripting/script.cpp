@@ -23,6 +23,8 @@
 #include "common/configuration.h"
 #include "common/resourcemanager.h"
 #include "game-server/being.h"
+#include "game-server/state.h"
+#include "scripting/scriptscheduler.h"
 #include "utils/logger.h"
 
 #include <cassert>
@@ -35,20 +37,31 @@ typedef std::map< std::string, Script::Factory > Engines;
 
 static Engines *engines = NULL;
 
-Script::Ref Script::mCreateNpcDelayedCallback;
-Script::Ref Script::mUpdateCallback;
-
 Script::Script():
     mCurrentThread(0),
-    mContext(0)
+    mContext(0),
+    mScheduler(new ScriptScheduler(this))
 {}
 
 Script::~Script()
 {
+    delete mScheduler;
+    mScheduler = 0;
+
     // There should be no remaining threads when the Script gets deleted
     assert(mThreads.empty());
 }
 
+void Script::finishThreads()
+{
+    while (!mThreads.empty())
+    {
+        Thread *thread = mThreads.back();
+        thread->signal_finished.emit(thread);
+        delete thread;
+    }
+}
+
 void Script::registerEngine(const std::string &name, Factory f)
 {
     if (!engines)
@@ -78,6 +91,8 @@ Script *Script::create(const std::string &engine)
 
 void Script::update()
 {
+    mScheduler->update(GameState::getCurrentTick());
+
     if (!mUpdateCallback.isValid())
     {
         LOG_ERROR("Could not find callback for update function!");
@@ -102,6 +117,8 @@ bool Script::loadFile(const std::string &name, const Context &context)
     if (buffer)
     {
         mScriptFile = name;
+        if (!context.map)
+            addLoadedFile(name);
         load(skipPotentialBom(buffer), name.c_str(), context);
         free(buffer);
         return true;
@@ -110,6 +127,28 @@ bool Script::loadFile(const std::string &name, const Context &context)
     }
 }
 
+bool Script::compileFile(const std::string &name,
+                         std::string &compiled) const
+{
+    int size;
+    char *buffer = ResourceManager::loadFile(name, size);
+    if (!buffer)
+        return false;
+
+    const bool result = compile(skipPotentialBom(buffer), name.c_str(),
+                                compiled);
+    free(buffer);
+    return result;
+}
+
+void Script::loadCompiledFile(const std::string &name,
+                              const std::string &compiled)
+{
+    mScriptFile = name;
+    addLoadedFile(name);
+    loadCompiled(compiled, name.c_str());
+}
+
 void Script::loadNPC(const std::string &name,
                      int id,
                      ManaServ::BeingGender gender,
@@ -170,5 +209,7 @@ Script::Thread::Thread(Script *script) :
 
 Script::Thread::~Thread()
 {
+    if (mScript->mScheduler)
+        mScript->mScheduler->cancel(this);
     fastRemoveOne(mScript->mThreads, this);
 }
@@ -25,15 +25,18 @@
 #include "common/manaserv_protocol.h"
 
 #include <list>
+#include <set>
 #include <string>
 #include <vector>
 #include <stack>
 
+#include <sigc++/signal.h>
 #include <sigc++/trackable.h>
 
 class Being;
 class MapComposite;
 class Entity;
+class ScriptScheduler;
 
 /**
  * Abstract interface for calling functions written in an external language.
@@ -84,7 +87,8 @@ class Script : public sigc::trackable
             ThreadPaused,
             ThreadExpectingNumber,
             ThreadExpectingString,
-            ThreadExpectingTwoStrings
+            ThreadExpectingTwoStrings,
+            ThreadWaiting
         };
 
         /**
@@ -103,6 +107,12 @@ class Script : public sigc::trackable
                 Script * const mScript;
                 ThreadState mState;
                 Context mContext;
+
+                /**
+                 * Emitted when the thread is done executing, right before
+                 * it gets deleted.
+                 */
+                sigc::signal<void, Thread *> signal_finished;
         };
 
         Script();
@@ -128,6 +138,52 @@ class Script : public sigc::trackable
         virtual bool loadFile(const std::string &,
                               const Context &context = Context());
 
+        /**
+         * Compiles a chunk of text without running it, into the form that
+         * loadCompiled() accepts. Does not touch the script context, so it
+         * may be called from another thread.
+         *
+         * @return whether the chunk compiled
+         */
+        virtual bool compile(const char *prog,
+                             const char *name,
+                             std::string &compiled) const = 0;
+
+        /**
+         * Loads a chunk compiled by compile() into the script context and
+         * executes its global statements.
+         */
+        virtual void loadCompiled(const std::string &compiled,
+                                  const char *name,
+                                  const Context &context = Context()) = 0;
+
+        /**
+         * Reads and compiles a text file, see compile().
+         */
+        bool compileFile(const std::string &name,
+                         std::string &compiled) const;
+
+        /**
+         * Loads a text file compiled by compileFile() outside of any map,
+         * the way loadFile() does.
+         */
+        void loadCompiledFile(const std::string &name,
+                              const std::string &compiled);
+
+        /**
+         * Remembers that a file was loaded outside of any map, so that it
+         * can be loaded again when it changes.
+         */
+        void addLoadedFile(const std::string &name)
+        { mLoadedFiles.insert(name); }
+
+        /**
+         * Returns whether the file was loaded outside of any map, either
+         * with loadFile or by a script.
+         */
+        bool isLoadedFile(const std::string &name) const
+        { return mLoadedFiles.find(name) != mLoadedFiles.end(); }
+
         /**
          * Loads a chunk of text and considers it as an NPC handler. This
          * handler will later be used to create the given NPC.
@@ -185,6 +241,11 @@ class Script : public sigc::trackable
          */
         virtual void push(Entity *) = 0;
 
+        /**
+         * Pushes an array of game entities, as with push(Entity *).
+         */
+        virtual void push(const std::vector<Entity*> &entities) = 0;
+
         /**
          * Pushes a list of items with amounts to the script engine.
          */
@@ -225,6 +286,30 @@ class Script : public sigc::trackable
          */
         virtual void unref(Ref &ref) = 0;
 
+        /**
+         * Runs a step of the incremental garbage collector, when the memory
+         * used by the script has grown enough since the last collection.
+         *
+         * @return whether there is more garbage to collect.
+         */
+        virtual bool collectGarbage() = 0;
+
+        /**
+         * Returns the memory used by the script, in bytes.
+         */
+        virtual size_t getMemoryUsage() const = 0;
+
+        /**
+         * Returns the highest memory used by the script so far, in bytes.
+         */
+        virtual size_t getPeakMemoryUsage() const = 0;
+
+        /**
+         * Returns the number of threads that did not finish yet.
+         */
+        unsigned getThreadCount() const
+        { return mThreads.size(); }
+
         /**
          * Returns the currently executing thread, or null when no thread is
          * currently executing.
@@ -232,6 +317,12 @@ class Script : public sigc::trackable
         Thread *getCurrentThread() const
         { return mCurrentThread; }
 
+        /**
+         * Returns the scheduler that suspends and resumes the threads.
+         */
+        ScriptScheduler *getScheduler() const
+        { return mScheduler; }
+
         /**
          * Returns the current context.
          */
@@ -242,22 +333,57 @@ class Script : public sigc::trackable
 
         virtual void processRemoveEvent(Entity *entity) = 0;
 
+        /*
+         * The callbacks below are registered by the engine library, which
+         * every script state loads, so each state has its own.
+         */
+
         static void setCreateNpcDelayedCallback(Script *script)
-        { script->assignCallback(mCreateNpcDelayedCallback); }
+        { script->assignCallback(script->mCreateNpcDelayedCallback); }
 
         static void setUpdateCallback(Script *script)
-        { script->assignCallback(mUpdateCallback); }
+        { script->assignCallback(script->mUpdateCallback); }
+
+        static void setMapInitializeCallback(Script *script)
+        { script->assignCallback(script->mMapInitializeCallback); }
+
+        static void setMapUpdateCallback(Script *script)
+        { script->assignCallback(script->mMapUpdateCallback); }
+
+        static void setMapMessageCallback(Script *script)
+        { script->assignCallback(script->mMapMessageCallback); }
+
+        Ref getMapInitializeCallback() const
+        { return mMapInitializeCallback; }
+
+        Ref getMapUpdateCallback() const
+        { return mMapUpdateCallback; }
+
+        Ref getMapMessageCallback() const
+        { return mMapMessageCallback; }
 
     protected:
+        /**
+         * Deletes the threads that are still alive, emitting their finished
+         * signal first so that their owners, like characters talking to an
+         * NPC, let go of them. Called by the engine before closing its state.
+         */
+        void finishThreads();
+
         std::string mScriptFile;
         Thread *mCurrentThread;
         const Context *mContext;
+        ScriptScheduler *mScheduler;
 
     private:
         std::vector<Thread*> mThreads;
+        std::set<std::string> mLoadedFiles;
 
-        static Ref mCreateNpcDelayedCallback;
-        static Ref mUpdateCallback;
+        Ref mCreateNpcDelayedCallback;
+        Ref mUpdateCallback;
+        Ref mMapInitializeCallback;
+        Ref mMapUpdateCallback;
+        Ref mMapMessageCallback;
 
     friend struct ScriptEventDispatch;
     friend class Thread;
@@ -21,20 +21,51 @@
 #include "scriptmanager.h"
 
 #include "common/configuration.h"
+#include "game-server/mapcomposite.h"
+#include "game-server/mapmanager.h"
 #include "scripting/script.h"
+#include "utils/logger.h"
+#include "utils/timer.h"
+
+#include <algorithm>
 
 static Script *_currentState;
 
 static Script::Ref _craftCallback;
 
+static std::string _engine;
+static bool _perMapStates;
+
+/** The global state followed by the states of the maps. */
+static std::vector<Script *> _states;
+static unsigned _nextCollectedState;
+
+/**
+ * A message between the scripts of two maps.
+ */
+struct MapMessage
+{
+    int senderId;
+    MapComposite *receiver;
+    std::string subject;
+    std::string body;
+};
+
+static std::vector<MapMessage> _mapMessages;
+
 void ScriptManager::initialize()
 {
-    const std::string engine = Configuration::getValue("script_engine", "lua");
-    _currentState = Script::create(engine);
+    _engine = Configuration::getValue("script_engine", "lua");
+    _perMapStates = Configuration::getBoolValue("script_perMapStates", false);
+    _currentState = Script::create(_engine);
+    _states.push_back(_currentState);
 }
 
 void ScriptManager::deinitialize()
 {
+    _mapMessages.clear();
+    _states.clear();
+
     delete _currentState;
     _currentState = 0;
 }
@@ -49,6 +80,105 @@ Script *ScriptManager::currentState()
     return _currentState;
 }
 
+bool ScriptManager::usePerMapStates()
+{
+    return _perMapStates;
+}
+
+Script *ScriptManager::createState()
+{
+    Script *script = Script::create(_engine);
+    _states.push_back(script);
+    return script;
+}
+
+void ScriptManager::destroyState(Script *script)
+{
+    if (!script)
+        return;
+
+    std::vector<Script *>::iterator it =
+            std::find(_states.begin(), _states.end(), script);
+    if (it != _states.end())
+        _states.erase(it);
+
+    delete script;
+}
+
+const std::vector<Script *> &ScriptManager::getStates()
+{
+    return _states;
+}
+
+void ScriptManager::postMapMessage(int senderId, MapComposite *receiver,
+                                   const std::string &subject,
+                                   const std::string &body)
+{
+    MapMessage message;
+    message.senderId = senderId;
+    message.receiver = receiver;
+    message.subject = subject;
+    message.body = body;
+    _mapMessages.push_back(message);
+}
+
+void ScriptManager::deliverMapMessages()
+{
+    // Messages posted while delivering wait for the next tick
+    std::vector<MapMessage> messages;
+    messages.swap(_mapMessages);
+
+    for (std::vector<MapMessage>::iterator it = messages.begin(),
+         it_end = messages.end(); it != it_end; ++it)
+    {
+        if (!it->receiver->isActive())
+            continue;
+
+        if (!it->receiver->isStarted())
+            MapManager::startMap(it->receiver);
+
+        Script *script = it->receiver->getScript();
+        Script::Ref callback = script->getMapMessageCallback();
+        if (!callback.isValid())
+        {
+            LOG_WARN("No callback for map messages on map "
+                     << it->receiver->getName() << ", dropping \""
+                     << it->subject << "\"");
+            continue;
+        }
+
+        script->prepare(callback);
+        script->push(it->subject);
+        script->push(it->body);
+        script->push(it->senderId);
+        script->execute(it->receiver);
+    }
+}
+
+void ScriptManager::collectGarbage(int budget)
+{
+    if (budget <= 0)
+        return;
+
+    // Take turns, starting where the previous budget ran out
+    const uint64_t start = utils::getTimeInMicrosec();
+    unsigned idleStates = 0;
+    while (idleStates < _states.size() &&
+           int(utils::getTimeInMicrosec() - start) < budget)
+    {
+        _nextCollectedState %= _states.size();
+        if (_states[_nextCollectedState]->collectGarbage())
+        {
+            idleStates = 0;
+        }
+        else
+        {
+            ++idleStates;
+            ++_nextCollectedState;
+        }
+    }
+}
+
 bool ScriptManager::performCraft(Being *crafter,
                                  const std::list<InventoryItem> &recipe)
 {
@@ -24,14 +24,16 @@
 #include "game-server/character.h"
 
 #include <string>
+#include <vector>
 
+class MapComposite;
 class Script;
 
 /**
- * Manages the script states. In fact at the moment it simply provides access
- * to the single global script state, but in the future it is planned to allow
- * reloading the scripts while the server is running, by keeping old script
- * states around until they are no longer in use.
+ * Manages the script states. There is a global state, which runs the main
+ * script. When script_perMapStates is enabled, every map gets its own state
+ * as well, for its NPCs and map scripts. Scripts on different maps then only
+ * share the world variables, and talk to each other through map messages.
  */
 namespace ScriptManager {
 
@@ -55,6 +57,45 @@ bool loadMainScript(const std::string &file);
  */
 Script *currentState();
 
+/**
+ * Returns whether every map gets its own script state.
+ */
+bool usePerMapStates();
+
+/**
+ * Creates a script state for a map. It loads the engine library, but not
+ * the main script.
+ */
+Script *createState();
+
+/**
+ * Deletes a state created with createState(). Accepts NULL.
+ */
+void destroyState(Script *script);
+
+/**
+ * Returns all the script states, the global one first.
+ */
+const std::vector<Script *> &getStates();
+
+/**
+ * Queues a message for the scripts of the receiving map. It is passed to
+ * their map message callback at the start of the next tick.
+ */
+void postMapMessage(int senderId, MapComposite *receiver,
+                    const std::string &subject, const std::string &body);
+
+/**
+ * Delivers the queued map messages.
+ */
+void deliverMapMessages();
+
+/**
+ * Steps the garbage collector of the script states for at most the given
+ * time, in microseconds.
+ */
+void collectGarbage(int budget);
+
 bool performCraft(Being *crafter, const std::list<InventoryItem> &recipe);
 
 void setCraftCallback(Script *script);
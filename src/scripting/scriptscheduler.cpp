@@ -0,0 +1,272 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "scripting/scriptscheduler.h"
+
+#include "game-server/being.h"
+#include "game-server/state.h"
+
+#include <algorithm>
+#include <cassert>
+
+template<typename T>
+static void removeOne(std::vector<T> &vector, T value)
+{
+    typename std::vector<T>::iterator it =
+            std::find(vector.begin(), vector.end(), value);
+    if (it != vector.end())
+    {
+        *it = vector.back();
+        vector.pop_back();
+    }
+}
+
+ScriptScheduler::ScriptScheduler(Script *script):
+    mScript(script),
+    mTick(GameState::getCurrentTick()),
+    mNextId(0)
+{}
+
+ScriptScheduler::~ScriptScheduler()
+{
+    for (std::vector<Start>::iterator it = mStarts.begin(),
+         it_end = mStarts.end(); it != it_end; ++it)
+    {
+        mScript->unref(it->function);
+    }
+
+    std::set<Script::Thread *> owned;
+    owned.swap(mOwnedThreads);
+    for (std::set<Script::Thread *>::iterator it = owned.begin(),
+         it_end = owned.end(); it != it_end; ++it)
+    {
+        delete *it;
+    }
+}
+
+void ScriptScheduler::start(Script::Ref function, MapComposite *map)
+{
+    Start start;
+    start.function = function;
+    start.map = map;
+    mStarts.push_back(start);
+}
+
+ScriptScheduler::Wait &ScriptScheduler::addWait(Script::Thread *thread,
+                                                WaitType type)
+{
+    assert(mWaits.find(thread) == mWaits.end());
+
+    thread->mState = Script::ThreadWaiting;
+
+    Wait &wait = mWaits[thread];
+    wait.id = mNextId++;
+    wait.type = type;
+    wait.due = 0;
+    wait.being = 0;
+    return wait;
+}
+
+void ScriptScheduler::waitTicks(Script::Thread *thread, int ticks)
+{
+    Wait &wait = addWait(thread, WAIT_TICKS);
+    wait.due = mTick + std::max(1, ticks);
+    mWheel[wait.due % WHEEL_SIZE].push_back(thread);
+}
+
+void ScriptScheduler::waitForEvent(Script::Thread *thread,
+                                   const std::string &event)
+{
+    Wait &wait = addWait(thread, WAIT_EVENT);
+    wait.event = event;
+    mEventWaits.insert(std::make_pair(event, thread));
+}
+
+void ScriptScheduler::fireEvent(const std::string &event)
+{
+    typedef std::multimap<std::string, Script::Thread *>::iterator Iterator;
+    std::pair<Iterator, Iterator> range = mEventWaits.equal_range(event);
+    for (Iterator it = range.first; it != range.second; ++it)
+        mFired.push_back(it->second);
+    mEventWaits.erase(range.first, range.second);
+}
+
+void ScriptScheduler::waitUntilArrived(Script::Thread *thread, Being *being)
+{
+    Wait &wait = addWait(thread, WAIT_ARRIVAL);
+    wait.being = being;
+    wait.removed = being->signal_removed.connect(
+            sigc::mem_fun(this, &ScriptScheduler::beingRemoved));
+    mArrivalWaits.push_back(thread);
+}
+
+void ScriptScheduler::cancel(Script::Thread *thread)
+{
+    mOwnedThreads.erase(thread);
+
+    std::map<Script::Thread *, Wait>::iterator it = mWaits.find(thread);
+    if (it == mWaits.end())
+        return;
+
+    Wait &wait = it->second;
+    switch (wait.type)
+    {
+    case WAIT_TICKS:
+        removeOne(mWheel[wait.due % WHEEL_SIZE], thread);
+        break;
+    case WAIT_EVENT:
+    {
+        typedef std::multimap<std::string, Script::Thread *>::iterator Iterator;
+        std::pair<Iterator, Iterator> range =
+                mEventWaits.equal_range(wait.event);
+        for (Iterator i = range.first; i != range.second; ++i)
+        {
+            if (i->second == thread)
+            {
+                mEventWaits.erase(i);
+                break;
+            }
+        }
+        removeOne(mFired, thread);
+        break;
+    }
+    case WAIT_ARRIVAL:
+        removeOne(mArrivalWaits, thread);
+        break;
+    }
+
+    wait.removed.disconnect();
+    mWaits.erase(it);
+}
+
+void ScriptScheduler::beingRemoved(Entity *entity)
+{
+    for (std::vector<Script::Thread *>::iterator it = mArrivalWaits.begin(),
+         it_end = mArrivalWaits.end(); it != it_end; ++it)
+    {
+        Wait &wait = mWaits[*it];
+        if (wait.being == entity)
+        {
+            wait.being = 0;
+            wait.removed.disconnect();
+        }
+    }
+}
+
+void ScriptScheduler::addResumption(std::vector<Resumption> &resumptions,
+                                    Script::Thread *thread)
+{
+    Resumption resumption;
+    resumption.thread = thread;
+    resumption.id = mWaits[thread].id;
+    resumptions.push_back(resumption);
+}
+
+void ScriptScheduler::update(int tick)
+{
+    std::vector<Resumption> resumptions;
+
+    // Every slot is visited at most once, which is enough to find all the
+    // threads that are due even when ticks were skipped
+    if (tick - mTick > int(WHEEL_SIZE))
+        mTick = tick - WHEEL_SIZE;
+
+    while (mTick < tick)
+    {
+        ++mTick;
+        std::vector<Script::Thread *> &slot = mWheel[mTick % WHEEL_SIZE];
+        for (size_t i = 0; i < slot.size();)
+        {
+            if (mWaits[slot[i]].due <= mTick)
+            {
+                addResumption(resumptions, slot[i]);
+                slot[i] = slot.back();
+                slot.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+
+    for (std::vector<Script::Thread *>::iterator it = mFired.begin(),
+         it_end = mFired.end(); it != it_end; ++it)
+    {
+        addResumption(resumptions, *it);
+    }
+    mFired.clear();
+
+    for (size_t i = 0; i < mArrivalWaits.size();)
+    {
+        Script::Thread *thread = mArrivalWaits[i];
+        const Wait &wait = mWaits[thread];
+        if (!wait.being ||
+            wait.being->getPosition() == wait.being->getDestination())
+        {
+            addResumption(resumptions, thread);
+            mArrivalWaits[i] = mArrivalWaits.back();
+            mArrivalWaits.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    // Resuming a thread may delete others, or make them wait again
+    for (std::vector<Resumption>::iterator it = resumptions.begin(),
+         it_end = resumptions.end(); it != it_end; ++it)
+    {
+        resume(*it);
+    }
+
+    std::vector<Start> starts;
+    starts.swap(mStarts);
+    for (std::vector<Start>::iterator it = starts.begin(),
+         it_end = starts.end(); it != it_end; ++it)
+    {
+        Script::Thread *thread = mScript->newThread();
+        thread->getContext().map = it->map;
+        mScript->prepare(it->function);
+        mScript->unref(it->function);
+        mOwnedThreads.insert(thread);
+        mScript->resume();
+    }
+}
+
+void ScriptScheduler::resume(const Resumption &resumption)
+{
+    std::map<Script::Thread *, Wait>::iterator it =
+            mWaits.find(resumption.thread);
+    if (it == mWaits.end() || it->second.id != resumption.id)
+        return;
+
+    const WaitType type = it->second.type;
+    Being *being = it->second.being;
+    it->second.removed.disconnect();
+    mWaits.erase(it);
+
+    mScript->prepareResume(resumption.thread);
+    if (type == WAIT_ARRIVAL)
+        mScript->push(being);
+    mScript->resume();
+}
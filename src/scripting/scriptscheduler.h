@@ -0,0 +1,165 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SCRIPTING_SCRIPTSCHEDULER_H
+#define SCRIPTING_SCRIPTSCHEDULER_H
+
+#include "scripting/script.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <sigc++/connection.h>
+#include <sigc++/trackable.h>
+
+class Being;
+class Entity;
+
+/**
+ * Suspends script threads until a number of ticks passed, an event was fired
+ * or a being arrived at its destination, and resumes them at the start of
+ * the tick in which that happened.
+ *
+ * Timed waits are kept in a timer wheel with a slot per tick, so that only
+ * the threads that are due are looked at every tick.
+ */
+class ScriptScheduler : public sigc::trackable
+{
+    public:
+        ScriptScheduler(Script *script);
+
+        /**
+         * Deletes the threads started by the scheduler that are still
+         * waiting.
+         */
+        ~ScriptScheduler();
+
+        /**
+         * Runs the given function in a new thread at the start of the next
+         * tick. The scheduler takes over the reference.
+         */
+        void start(Script::Ref function, MapComposite *map);
+
+        /**
+         * Suspends the thread for the given number of ticks.
+         */
+        void waitTicks(Script::Thread *thread, int ticks);
+
+        /**
+         * Suspends the thread until the event is fired.
+         */
+        void waitForEvent(Script::Thread *thread, const std::string &event);
+
+        /**
+         * Resumes the threads waiting for the event, at the start of the
+         * next tick.
+         */
+        void fireEvent(const std::string &event);
+
+        /**
+         * Suspends the thread until the being reached its destination or
+         * was removed from the map.
+         */
+        void waitUntilArrived(Script::Thread *thread, Being *being);
+
+        /**
+         * Forgets about the thread. Called when a thread is deleted.
+         */
+        void cancel(Script::Thread *thread);
+
+        /**
+         * Resumes the threads whose wait ended, and starts the new threads.
+         */
+        void update(int tick);
+
+        /**
+         * Returns the number of waiting threads.
+         */
+        unsigned getWaitingCount() const
+        { return mWaits.size(); }
+
+    private:
+        enum WaitType
+        {
+            WAIT_TICKS,
+            WAIT_EVENT,
+            WAIT_ARRIVAL
+        };
+
+        struct Wait
+        {
+            unsigned id;            /**< Tells apart waits of reused threads. */
+            WaitType type;
+            int due;                /**< Tick to resume at, for timed waits. */
+            std::string event;
+            Being *being;           /**< NULL once removed. */
+            sigc::connection removed;
+        };
+
+        struct Resumption
+        {
+            Script::Thread *thread;
+            unsigned id;
+        };
+
+        struct Start
+        {
+            Script::Ref function;
+            MapComposite *map;
+        };
+
+        /** Number of ticks covered by one turn of the wheel. */
+        static const unsigned WHEEL_SIZE = 256;
+
+        Wait &addWait(Script::Thread *thread, WaitType type);
+
+        void addResumption(std::vector<Resumption> &resumptions,
+                           Script::Thread *thread);
+
+        void resume(const Resumption &resumption);
+
+        void beingRemoved(Entity *entity);
+
+        Script *mScript;
+        int mTick;                  /**< Last tick that was processed. */
+        unsigned mNextId;
+
+        std::map<Script::Thread *, Wait> mWaits;
+
+        /** Threads with a timed wait, by their due tick modulo the size. */
+        std::vector<Script::Thread *> mWheel[WHEEL_SIZE];
+
+        std::multimap<std::string, Script::Thread *> mEventWaits;
+
+        /** Threads waiting for an event that was fired. */
+        std::vector<Script::Thread *> mFired;
+
+        std::vector<Script::Thread *> mArrivalWaits;
+
+        std::vector<Start> mStarts;
+
+        /** Threads started by the scheduler, deleted with it. */
+        std::set<Script::Thread *> mOwnedThreads;
+};
+
+#endif // SCRIPTING_SCRIPTSCHEDULER_H
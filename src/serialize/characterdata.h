@@ -43,13 +43,13 @@ void serializeCharacterData(const T &data, MessageOut &msg)
     msg.writeInt16(data.getCorrectionPoints());
 
     msg.writeInt16(data.mAttributes.size());
-    AttributeMap::const_iterator attr_it, attr_it_end;
-    for (attr_it = data.mAttributes.begin(),
-         attr_it_end = data.mAttributes.end();
+    typename T::AttributeIterator attr_it, attr_it_end;
+    for (attr_it = data.getAttributeBegin(),
+         attr_it_end = data.getAttributeEnd();
          attr_it != attr_it_end;
          ++attr_it)
     {
-        msg.writeInt16(attr_it->first);
+        msg.writeInt16(data.getAttrId(attr_it));
         msg.writeDouble(data.getAttrBase(attr_it));
         msg.writeDouble(data.getAttrMod(attr_it));
     }
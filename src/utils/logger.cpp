@@ -23,6 +23,7 @@
 #include "common/configuration.h"
 #include "common/resourcemanager.h"
 #include "utils/string.h"
+#include "utils/threadpool.h"
 #include "utils/time.h"
 
 #include <fstream>
@@ -36,6 +37,8 @@ namespace utils
 {
 /** Log file. */
 static std::ofstream mLogFile;
+/** Keeps the messages of jobs run on a thread pool apart. */
+static Mutex mOutputMutex;
 /** current log filename */
 std::string Logger::mFilename;
 /** Timestamp flag. */
@@ -155,6 +158,7 @@ void Logger::output(const std::string &msg, Level atVerbosity)
 
     if (mVerbosity >= atVerbosity)
     {
+        MutexLock lock(mOutputMutex);
         bool open = mLogFile.is_open();
 
         if (open)
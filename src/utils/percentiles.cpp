@@ -0,0 +1,70 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils/percentiles.h"
+
+#include <algorithm>
+
+namespace utils
+{
+
+RollingPercentiles::RollingPercentiles(unsigned capacity):
+    mCapacity(capacity ? capacity : 1),
+    mNext(0)
+{
+    mSamples.reserve(mCapacity);
+}
+
+void RollingPercentiles::add(int sample)
+{
+    if (mSamples.size() < mCapacity)
+        mSamples.push_back(sample);
+    else
+        mSamples[mNext] = sample;
+
+    mNext = (mNext + 1) % mCapacity;
+}
+
+int RollingPercentiles::percentile(int percent) const
+{
+    if (mSamples.empty())
+        return 0;
+
+    std::vector<int> sorted(mSamples);
+    unsigned index = (sorted.size() - 1) * percent / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index];
+}
+
+int RollingPercentiles::max() const
+{
+    if (mSamples.empty())
+        return 0;
+
+    return *std::max_element(mSamples.begin(), mSamples.end());
+}
+
+void RollingPercentiles::clear()
+{
+    mSamples.clear();
+    mNext = 0;
+}
+
+} // namespace utils
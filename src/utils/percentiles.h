@@ -0,0 +1,73 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PERCENTILES_H
+#define PERCENTILES_H
+
+#include <vector>
+
+namespace utils
+{
+
+/**
+ * Keeps the most recent samples of a measurement, so that percentiles over
+ * a rolling window can be reported. Adding a sample is cheap; computing a
+ * percentile sorts a copy of the window.
+ */
+class RollingPercentiles
+{
+    public:
+        /**
+         * Constructor.
+         *
+         * @param capacity the number of most recent samples that are kept
+         */
+        RollingPercentiles(unsigned capacity);
+
+        void add(int sample);
+
+        /**
+         * Returns the value below which the given percentage of the
+         * samples in the window fall, or 0 when there are no samples.
+         */
+        int percentile(int percent) const;
+
+        /**
+         * Returns the highest sample in the window.
+         */
+        int max() const;
+
+        /**
+         * Returns the number of samples in the window.
+         */
+        unsigned size() const
+        { return mSamples.size(); }
+
+        void clear();
+
+    private:
+        std::vector<int> mSamples;
+        unsigned mCapacity;
+        unsigned mNext;             /**< Position of the next sample. */
+};
+
+} // namespace utils
+
+#endif // PERCENTILES_H
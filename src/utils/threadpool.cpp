@@ -0,0 +1,191 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "utils/threadpool.h"
+
+#include "utils/logger.h"
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace utils
+{
+
+#ifdef _WIN32
+
+Mutex::Mutex() {}
+Mutex::~Mutex() {}
+void Mutex::lock() {}
+void Mutex::unlock() {}
+
+ThreadPool::ThreadPool(unsigned):
+    mThreadCount(1)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+}
+
+void ThreadPool::add(Job *job)
+{
+    job->run();
+}
+
+void ThreadPool::wait()
+{
+}
+
+bool ThreadPool::isDone()
+{
+    return true;
+}
+
+#else
+
+Mutex::Mutex()
+{
+    pthread_mutex_init(&mMutex, 0);
+}
+
+Mutex::~Mutex()
+{
+    pthread_mutex_destroy(&mMutex);
+}
+
+void Mutex::lock()
+{
+    pthread_mutex_lock(&mMutex);
+}
+
+void Mutex::unlock()
+{
+    pthread_mutex_unlock(&mMutex);
+}
+
+ThreadPool::ThreadPool(unsigned threads):
+    mThreadCount(threads),
+    mRunning(0),
+    mStopping(false)
+{
+    if (!mThreadCount)
+    {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        mThreadCount = processors > 0 ? processors : 1;
+    }
+
+    pthread_cond_init(&mJobAdded, 0);
+    pthread_cond_init(&mJobsDone, 0);
+
+    if (mThreadCount == 1)
+        return;
+
+    for (unsigned i = 0; i < mThreadCount; ++i)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, 0, &ThreadPool::work, this) != 0)
+        {
+            LOG_WARN("Could only start " << i << " of " << mThreadCount
+                     << " threads.");
+            break;
+        }
+        mThreads.push_back(thread);
+    }
+
+    // Jobs are run on the calling thread when no thread could be started
+    mThreadCount = std::max<unsigned>(1, mThreads.size());
+}
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+
+    mMutex.lock();
+    mStopping = true;
+    pthread_cond_broadcast(&mJobAdded);
+    mMutex.unlock();
+
+    for (unsigned i = 0; i < mThreads.size(); ++i)
+        pthread_join(mThreads[i], 0);
+
+    pthread_cond_destroy(&mJobAdded);
+    pthread_cond_destroy(&mJobsDone);
+}
+
+void ThreadPool::add(Job *job)
+{
+    if (mThreads.empty())
+    {
+        job->run();
+        return;
+    }
+
+    MutexLock lock(mMutex);
+    mJobs.push_back(job);
+    pthread_cond_signal(&mJobAdded);
+}
+
+void ThreadPool::wait()
+{
+    MutexLock lock(mMutex);
+    while (!mJobs.empty() || mRunning)
+        pthread_cond_wait(&mJobsDone, &mMutex.mMutex);
+}
+
+bool ThreadPool::isDone()
+{
+    MutexLock lock(mMutex);
+    return mJobs.empty() && !mRunning;
+}
+
+void *ThreadPool::work(void *data)
+{
+    ThreadPool *pool = static_cast<ThreadPool *>(data);
+    MutexLock lock(pool->mMutex);
+
+    for (;;)
+    {
+        while (pool->mJobs.empty() && !pool->mStopping)
+            pthread_cond_wait(&pool->mJobAdded, &pool->mMutex.mMutex);
+
+        if (pool->mJobs.empty())
+            return 0;
+
+        Job *job = pool->mJobs.front();
+        pool->mJobs.pop_front();
+        ++pool->mRunning;
+
+        pool->mMutex.unlock();
+        job->run();
+        pool->mMutex.lock();
+
+        --pool->mRunning;
+        if (pool->mJobs.empty() && !pool->mRunning)
+            pthread_cond_broadcast(&pool->mJobsDone);
+    }
+}
+
+#endif
+
+} // namespace utils
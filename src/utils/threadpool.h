@@ -0,0 +1,148 @@
+/*
+ *  The Mana Server
+ *  Copyright (C) 2012  The Mana Developers
+ *
+ *  This file is part of The Mana Server.
+ *
+ *  The Mana Server is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  any later version.
+ *
+ *  The Mana Server is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with The Mana Server.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <deque>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+namespace utils
+{
+
+/**
+ * A mutual exclusion lock. Does nothing on Windows, where the thread pool
+ * runs its jobs on the calling thread.
+ */
+class Mutex
+{
+    public:
+        Mutex();
+        ~Mutex();
+
+        void lock();
+        void unlock();
+
+    private:
+        Mutex(const Mutex &);
+        Mutex &operator=(const Mutex &);
+
+#ifndef _WIN32
+        friend class ThreadPool;
+        pthread_mutex_t mMutex;
+#endif
+};
+
+/**
+ * Holds a mutex for as long as it exists.
+ */
+class MutexLock
+{
+    public:
+        MutexLock(Mutex &mutex):
+            mMutex(mutex)
+        { mMutex.lock(); }
+
+        ~MutexLock()
+        { mMutex.unlock(); }
+
+    private:
+        Mutex &mMutex;
+};
+
+/**
+ * A piece of work to be run by a ThreadPool.
+ */
+class Job
+{
+    public:
+        virtual ~Job() {}
+
+        virtual void run() = 0;
+};
+
+/**
+ * A fixed set of threads running the jobs they are given, in the order they
+ * were added. Meant for work that can be split up, like reading the maps at
+ * startup or parsing the databases that are reloaded.
+ */
+class ThreadPool
+{
+    public:
+        /**
+         * Starts the given number of threads, 0 for one per processor. With
+         * a single thread, the jobs are run on the calling thread instead.
+         */
+        ThreadPool(unsigned threads = 0);
+
+        /**
+         * Waits for the jobs that were added and stops the threads.
+         */
+        ~ThreadPool();
+
+        /**
+         * Queues a job. The pool does not take ownership of it.
+         */
+        void add(Job *job);
+
+        /**
+         * Waits until all the jobs that were added have been run.
+         */
+        void wait();
+
+        /**
+         * Returns whether all the jobs that were added have been run,
+         * without waiting.
+         */
+        bool isDone();
+
+        /**
+         * Returns the number of threads running the jobs.
+         */
+        unsigned size() const
+        { return mThreadCount; }
+
+    private:
+        ThreadPool(const ThreadPool &);
+        ThreadPool &operator=(const ThreadPool &);
+
+        unsigned mThreadCount;
+
+#ifndef _WIN32
+        static void *work(void *pool);
+
+        Mutex mMutex;
+        pthread_cond_t mJobAdded;
+        pthread_cond_t mJobsDone;
+        std::vector<pthread_t> mThreads;
+        std::deque<Job *> mJobs;
+        unsigned mRunning;      /**< Jobs taken off the queue but not done. */
+        bool mStopping;
+#endif
+};
+
+} // namespace utils
+
+#endif // THREADPOOL_H
@@ -43,6 +43,14 @@ static uint64_t getTimeInMillisec()
 namespace utils
 {
 
+uint64_t getTimeInMicrosec()
+{
+    timeval time;
+
+    gettimeofday(&time, 0);
+    return (uint64_t)time.tv_sec * 1000000 + time.tv_usec;
+}
+
 Timer::Timer(unsigned ms)
 {
     active = false;
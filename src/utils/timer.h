@@ -31,6 +31,11 @@
 namespace utils
 {
 
+/**
+ * Returns the current time in microseconds, for measuring short durations.
+ */
+uint64_t getTimeInMicrosec();
+
 /**
  * This class is for timing purpose as a replacement for SDL_TIMER
  */